@@ -59,6 +59,8 @@ typedef unsigned long uint64_t;
 #else
 # include <stdint.h>
 #endif
+/* size_t */
+#include <stddef.h>
 
 /** a 32bit number (either float or int), useful for endianness operations */
 typedef union {
@@ -73,6 +75,9 @@ typedef union {
 /** opaque handle to an ambix file */
 typedef struct ambix_t_struct ambix_t;
 
+/** opaque handle to a segmented ambix file (see ambix_segmented_open()) */
+typedef struct ambix_segmented_t_struct ambix_segmented_t;
+
 /** error codes returned by functions */
 typedef enum
 {
@@ -105,7 +110,40 @@ typedef enum {
   /** open file for writing */
   AMBIX_WRITE = (1 << 5),
   /** open file for reading&writing */
-  AMBIX_RDRW = (AMBIX_READ|AMBIX_WRITE)
+  AMBIX_RDRW = (AMBIX_READ|AMBIX_WRITE),
+
+  /** flag for AMBIX_WRITE: store samples in the byte order of the host
+   * (rather than big-endian), so no byteswapping is needed when writing
+   * (and when reading the file on a host with the same byte order) */
+  AMBIX_NATIVEENDIAN = (1 << 6),
+
+  /** flag for AMBIX_WRITE: write a stream to a non-seekable output (e.g. a
+   * pipe; the path "-" means stdout).
+   * all header chunks (including the adaptor matrix) are emitted up front
+   * (before the first sample frame), followed by a 'data' chunk of unknown
+   * size, so the file can be written indefinitely. chunks that are only
+   * known when closing (e.g. the peaks) are not stored.
+   *
+   * flag for AMBIX_READ: read a stream from a non-seekable input (e.g. a
+   * pipe; the path "-" means stdin).
+   * sample frames are delivered as they arrive; chunks following the audio
+   * data (e.g. markers and regions written when closing) are not available */
+  AMBIX_STREAM = (1 << 7),
+
+  /** flag for AMBIX_WRITE: bypass the page cache (O_DIRECT), for long
+   * recordings that should not evict everything else from memory.
+   * the file is written in large sector-aligned blocks from a buffer of
+   * fixed size, so memory use does not grow with the length of the file.
+   * (ignored when reading, and for streams) */
+  AMBIX_DIRECT = (1 << 8),
+
+  /** flag for AMBIX_READ: read a file whose recording was interrupted before
+   * it was closed. if the header doesn't know about any sample frames (or
+   * only announces audio data of unknown size), the frames are read up to the
+   * end of the file instead (see ambix_is_recovered()).
+   * (a file written with @ref AMBIX_DIRECT might end with up to a block of
+   * silence). headers updated by ambix_checkpoint() are trusted as they are */
+  AMBIX_RECOVER = (1 << 9)
 
 } ambix_filemode_t;
 
@@ -135,6 +173,30 @@ typedef enum {
   AMBIX_SAMPLEFORMAT_FLOAT64,
 } ambix_sampleformat_t;
 
+/** dither types used when quantizing floating point data to integer sample formats */
+typedef enum {
+  /** no dither (plain rounding) */
+  AMBIX_DITHER_NONE=0,
+  /** triangular (TPDF) dither with a peak amplitude of 1 LSB */
+  AMBIX_DITHER_TPDF,
+  /** TPDF dither with 1st order noise shaping */
+  AMBIX_DITHER_SHAPED,
+} ambix_dither_t;
+
+/** expected access patterns when reading (see ambix_advise()) */
+typedef enum {
+  /** no particular access pattern (the default) */
+  AMBIX_ADVISE_NORMAL=0,
+  /** the file is read from start to end (more readahead) */
+  AMBIX_ADVISE_SEQUENTIAL,
+  /** the file is read at random positions (no readahead) */
+  AMBIX_ADVISE_RANDOM,
+  /** a range of sample frames is going to be read soon (load it now) */
+  AMBIX_ADVISE_WILLNEED,
+  /** a range of sample frames is not going to be read again (drop it from the cache) */
+  AMBIX_ADVISE_DONTNEED,
+} ambix_advice_t;
+
 /** ambix matrix types */
 typedef enum {
   /** invalid matrix format */
@@ -245,6 +307,57 @@ typedef struct ambix_region_t {
   char name[256];
 } ambix_region_t;
 
+/** callback to get the total size of a virtual file (in bytes) */
+typedef int64_t (*ambix_vio_get_filelen_t)(void *userdata);
+/** callback to seek (in bytes) in a virtual file; whence is one of SEEK_SET, SEEK_CUR, SEEK_END */
+typedef int64_t (*ambix_vio_seek_t)(int64_t offset, int whence, void *userdata);
+/** callback to read count bytes from a virtual file; returns the number of bytes read */
+typedef int64_t (*ambix_vio_read_t)(void *ptr, int64_t count, void *userdata);
+/** callback to write count bytes to a virtual file; returns the number of bytes written */
+typedef int64_t (*ambix_vio_write_t)(const void *ptr, int64_t count, void *userdata);
+/** callback to get the current position (in bytes) in a virtual file */
+typedef int64_t (*ambix_vio_tell_t)(void *userdata);
+
+/** struct holding the callbacks for virtual I/O (see ambix_open_virtual()) */
+typedef struct ambix_virtual_io_t {
+  /** get the size of the file */
+  ambix_vio_get_filelen_t get_filelen;
+  /** seek in the file */
+  ambix_vio_seek_t seek;
+  /** read from the file (only needed for reading) */
+  ambix_vio_read_t read;
+  /** write to the file (only needed for writing) */
+  ambix_vio_write_t write;
+  /** get the current position in the file */
+  ambix_vio_tell_t tell;
+} ambix_virtual_io_t;
+
+/** struct for holding a bin of a waveform overview */
+typedef struct ambix_overview_t {
+  /** minimum sample value within the bin */
+  float32_t min;
+  /** maximum sample value within the bin */
+  float32_t max;
+  /** root mean square of the samples within the bin */
+  float32_t rms;
+} ambix_overview_t;
+
+/** struct for holding the directional analysis of a block of frames */
+typedef struct ambix_direction_t {
+  /** mean energy of the omnidirectional (W) component */
+  float32_t energy;
+  /** mean (active) intensity vector (x, y, z), with the magnitude of energy for a single plane wave */
+  float32_t intensity[3];
+} ambix_direction_t;
+
+/** struct for holding a finished asynchronous read (see ambix_read_reap()) */
+typedef struct ambix_completion_t {
+  /** the userdata passed to ambix_read_submit() */
+  void *userdata;
+  /** number of sample frames read, or a negative error code */
+  int64_t frames;
+} ambix_completion_t;
+
 /*
  * @section api_main Main Interface
  */
@@ -277,6 +390,20 @@ typedef struct ambix_region_t {
  * else ambixinfo.ambichannels must be >0; if ambixinfo.ambixformat is
  * @ref AMBIX_BASIC, then ambixinfo.ambichannels must be @f$(order_{ambi}+1)^2@f$
  *
+ * @remark when writing with the @ref AMBIX_STREAM flag, the file is never seeked
+ * (so path can be a named pipe, or "-" for stdout); the adaptor matrix,
+ * markers and regions must be set before the first frame is written
+ *
+ * @remark when reading with the @ref AMBIX_STREAM flag, the file is never seeked
+ * either (so path can be a named pipe, or "-" for stdin); if the length of the
+ * stream is unknown, ambixinfo.frames is INT64_MAX and ambix_readf_float32()
+ * (and friends) return fewer frames than requested at the end of the stream
+ *
+ * @remark when writing with the @ref AMBIX_DIRECT flag, the file is written
+ * unbuffered (if the filesystem supports it); the data only reaches the file
+ * in blocks of 1MB (the remainder and the final header are written when
+ * closing)
+ *
  * @return A handle to the opened file (or NULL on failure)
  *
  * @ingroup ambix
@@ -284,6 +411,57 @@ typedef struct ambix_region_t {
 AMBIX_API
 ambix_t *ambix_open (const char *path, const ambix_filemode_t mode, ambix_info_t *ambixinfo) ;
 
+/** @brief Open an ambix file using virtual I/O
+ *
+ * Like ambix_open(), but instead of accessing a file on the filesystem, all
+ * I/O is done through user-supplied callbacks (e.g. to serve data from
+ * a memory buffer or a custom storage layer).
+ *
+ * @param vio pointer to the callbacks (the structure is copied)
+ * @param mode whether to open the file for reading or writing (@ref AMBIX_READ, @ref AMBIX_WRITE)
+ * @param ambixinfo pointer to a valid ambix_info_t structure (see ambix_open())
+ * @param userdata a pointer that is passed to all the callbacks
+ *
+ * @return A handle to the opened file (or NULL on failure, e.g. if the backend does not support virtual I/O)
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_t *ambix_open_virtual (const ambix_virtual_io_t *vio, const ambix_filemode_t mode, ambix_info_t *ambixinfo, void *userdata) ;
+
+/** @brief Open an ambix file from memory for reading
+ *
+ * Like ambix_open(), but reads the file from a buffer holding its entire content.
+ *
+ * @param buffer the content of the file (must remain valid until the handle is closed)
+ * @param size the size of the buffer in bytes
+ * @param ambixinfo pointer to a valid ambix_info_t structure (see ambix_open())
+ *
+ * @return A handle to the opened file (or NULL on failure)
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_t *ambix_open_memory (const void *buffer, size_t size, ambix_info_t *ambixinfo) ;
+
+/** @brief Open an ambix file in memory for writing
+ *
+ * Like ambix_open(), but writes the file into a (growing) memory buffer.
+ * When the handle is closed with ambix_close(), the buffer holding the entire
+ * file is returned in buffer and size.
+ *
+ * @param buffer pointer to receive the content of the file when it is closed
+ * (the caller has to free() it)
+ * @param size pointer to receive the size of the file (in bytes) when it is closed
+ * @param ambixinfo pointer to a valid ambix_info_t structure (see ambix_open())
+ *
+ * @return A handle to the opened file (or NULL on failure)
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_t *ambix_open_memory_write (void **buffer, size_t *size, ambix_info_t *ambixinfo) ;
+
 /** @brief Close an ambix handle
  *
  * Closes an ambix handle and cleans up all memory allocations associated with
@@ -368,6 +546,184 @@ int64_t ambix_readf_float32 (ambix_t *ambix, float32_t *ambidata, float32_t *oth
 AMBIX_API
 int64_t ambix_readf_float64 (ambix_t *ambix, float64_t *ambidata, float64_t *otherdata, int64_t frames) ;
 
+/** @brief Read a subset of channels from the ambix file
+ * @defgroup ambix_readf_channels ambix_readf_channels()
+ *
+ * Reads only the selected channels from an ambix file; this is cheaper than
+ * reading all channels, as only the requested rows of the adaptor matrix are
+ * computed.
+ *
+ * Channels are indexed as presented by ambix_readf(): the indices
+ * [0..ambichannels) denote the ambisonics channels (after applying the adaptor
+ * matrix, if any), the indices [ambichannels..ambichannels+extrachannels)
+ * denote the non-ambisonics channels.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param channels array of channel indices to read (may contain duplicates)
+ *
+ * @param numchannels number of elements in the channels array
+ *
+ * @param data pointer to user allocated array to retrieve the selected
+ * channels into (interleaved, in the order given by channels); must be large
+ * enough to hold at least (frames*numchannels) samples.
+ *
+ * @param frames number of sample frames you want to read
+ *
+ * @return the number of sample frames successfully read, or a negative error
+ * code (e.g. if a channel index is out of range)
+ *
+ * @ingroup ambix
+ */
+/** @brief Read selected channels (as 16bit signed integer values) from the ambix file
+ * @ingroup ambix_readf_channels
+ */
+AMBIX_API
+int64_t ambix_readf_int16_channels (ambix_t *ambix, const uint32_t *channels, uint32_t numchannels, int16_t *data, int64_t frames) ;
+/** @brief Read selected channels (as 32bit signed integer values) from the ambix file
+ * @ingroup ambix_readf_channels
+ */
+AMBIX_API
+int64_t ambix_readf_int32_channels (ambix_t *ambix, const uint32_t *channels, uint32_t numchannels, int32_t *data, int64_t frames) ;
+/** @brief Read selected channels (as single precision floating point values)
+ * from the ambix file
+ * @ingroup ambix_readf_channels
+ */
+AMBIX_API
+int64_t ambix_readf_float32_channels (ambix_t *ambix, const uint32_t *channels, uint32_t numchannels, float32_t *data, int64_t frames) ;
+/** @brief Read selected channels (as double precision floating point values)
+ * from the ambix file
+ * @ingroup ambix_readf_channels
+ */
+AMBIX_API
+int64_t ambix_readf_float64_channels (ambix_t *ambix, const uint32_t *channels, uint32_t numchannels, float64_t *data, int64_t frames) ;
+
+/** @brief Queue an asynchronous read from the ambix file
+ *
+ * Requests to read a block of sample frames (as single precision floating
+ * point values, like ambix_readf_float32()) without blocking.
+ * Several requests can be pending at the same time (currently up to 32 per
+ * handle); they are finished by ambix_read_reap().
+ * The read position is given explicitly, so pending requests neither depend
+ * on nor change the position used by ambix_readf().
+ *
+ * On Linux the requests are passed to the kernel via io_uring (if available),
+ * elsewhere they are read synchronously (so they are finished right away).
+ * Asynchronous reads are only available for CAF files opened for reading
+ * with ambix_open() (not for virtual files or streams).
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param position the sample frame to start reading at
+ *
+ * @param ambidata pointer to user allocated array to retrieve ambisonics
+ * channels into; must be large enough to hold at least
+ * (frames*ambix->info.ambichannels) samples, and must stay valid until the
+ * request has been reaped.
+ *
+ * @param otherdata pointer to user allocated array to retrieve non-ambisonics
+ * channels into; must be large enough to hold at least
+ * (frames*ambix->info.extrachannels) samples, and must stay valid until the
+ * request has been reaped.
+ *
+ * @param frames number of sample frames you want to read
+ *
+ * @param userdata arbitrary pointer to identify the request when it is reaped
+ *
+ * @return an error code indicating success; AMBIX_ERR_INVALID_FILE if the
+ * file cannot be read asynchronously, AMBIX_ERR_UNKNOWN if too many requests
+ * are pending
+ *
+ * @remark the data is only converted (and the adaptor matrix applied) when the
+ * request is reaped, so the buffers are not filled before.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_read_submit (ambix_t *ambix, uint64_t position, float32_t *ambidata, float32_t *otherdata, int64_t frames, void *userdata) ;
+
+/** @brief Finish asynchronous reads
+ *
+ * Collects requests queued with ambix_read_submit() that have completed,
+ * and fills their buffers.
+ * Requests are returned in the order they complete, which need not be the
+ * order in which they were submitted.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param completions pointer to user allocated array that receives the
+ * finished requests; must be large enough to hold count elements
+ *
+ * @param count the maximum number of requests to finish
+ *
+ * @param wait if non-zero, block until at least one request has completed
+ * (unless no request is pending)
+ *
+ * @return the number of finished requests (written to completions)
+ *
+ * @remark an ambix handle must not be used from several threads at the same
+ * time, so ambix_read_reap() must not run concurrently with ambix_readf() on
+ * the same handle.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+int64_t ambix_read_reap (ambix_t *ambix, ambix_completion_t *completions, uint32_t count, int wait) ;
+
+/** @brief Tell the system how an ambix file is going to be read
+ *
+ * The hints only affect performance (readahead and caching of the file by the
+ * operating system), never the data read.
+ * A libsndfile handle obtained with ambix_get_sndfile() stays valid; however,
+ * if it has been obtained before the first hint, the access patterns (@ref
+ * AMBIX_ADVISE_SEQUENTIAL, @ref AMBIX_ADVISE_RANDOM) might not affect reading
+ * (depending on the operating system).
+ *
+ * @ref AMBIX_ADVISE_SEQUENTIAL suits players and batch conversions that read
+ * the file from start to end, @ref AMBIX_ADVISE_RANDOM suits samplers jumping
+ * between cue points; both apply to the entire file.
+ * @ref AMBIX_ADVISE_WILLNEED starts loading a range of sample frames in the
+ * background (e.g. the frames after the next cue point), @ref
+ * AMBIX_ADVISE_DONTNEED drops a range of sample frames from the cache.
+ *
+ * @param ambix The handle to an ambix file opened for reading (by path)
+ *
+ * @param advice The expected access pattern
+ *
+ * @param offset The first sample frame of the range (ignored for access
+ * patterns that apply to the entire file)
+ *
+ * @param frames The number of sample frames in the range (0 means until the
+ * end of the file)
+ *
+ * @return an errorcode indicating success (@ref AMBIX_ERR_INVALID_FILE for
+ * streams, virtual files and files opened for writing; @ref AMBIX_ERR_UNKNOWN
+ * if the system doesn't support hints)
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_advise (ambix_t *ambix, ambix_advice_t advice, int64_t offset, int64_t frames) ;
+
+/** @brief Load sample frames into the cache ahead of reading them
+ *
+ * Starts loading the given number of sample frames from the current read
+ * position in the background, so reading them later doesn't have to wait for
+ * the disk (e.g. right after opening a file, so playback starts instantly).
+ * This is the same as calling ambix_advise() with @ref AMBIX_ADVISE_WILLNEED
+ * for the frames at the current read position.
+ *
+ * @param ambix The handle to an ambix file opened for reading (by path)
+ *
+ * @param frames The number of sample frames to load
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_preload (ambix_t *ambix, int64_t frames) ;
+
 /** @brief Write samples to the ambix file.
  * @defgroup ambix_writef ambix_writef()
  *
@@ -415,6 +771,431 @@ int64_t ambix_writef_float32 (ambix_t *ambix, const float32_t *ambidata, const f
  */
 AMBIX_API
 int64_t ambix_writef_float64 (ambix_t *ambix, const float64_t *ambidata, const float64_t *otherdata, int64_t frames) ;
+
+/** @brief Read packed 24bit samples from the ambix file
+ *
+ * Reads samples from a PCM24 file without converting them: each sample
+ * occupies 3 bytes (in host byte order), which saves memory and conversion
+ * passes when working with 24bit data.
+ *
+ * As no arithmetics can be done on the packed samples, the adaptor matrix
+ * (if any) must be a simple routing matrix (e.g. a permutation matrix, where
+ * each row has at most a single element 1 and all others are 0).
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param ambidata pointer to user allocated array to retrieve ambisonics
+ * channels into; must be large enough to hold at least
+ * (3*frames*ambix->info.ambichannels) bytes.
+ *
+ * @param otherdata pointer to user allocated array to retrieve non-ambisonics
+ * channels into; must be large enough to hold at least
+ * (3*frames*ambix->info.otherchannels) bytes.
+ *
+ * @param frames number of sample frames you want to read
+ *
+ * @return the number of sample frames successfully read, or a negative error
+ * code (e.g. -@ref AMBIX_ERR_INVALID_FORMAT if the file is not PCM24, or
+ * -@ref AMBIX_ERR_INVALID_MATRIX if the adaptor matrix is not a routing matrix)
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+int64_t ambix_readf_pcm24_raw (ambix_t *ambix, void *ambidata, void *otherdata, int64_t frames) ;
+/** @brief Write packed 24bit samples to the ambix file
+ *
+ * This is the counterpart to ambix_readf_pcm24_raw(): each sample occupies 3
+ * bytes (in host byte order), and is written to the PCM24 file as is.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param ambidata pointer to user allocated array holding
+ * (3*frames*ambix->info.ambichannels) bytes of ambisonics data
+ *
+ * @param otherdata pointer to user allocated array holding
+ * (3*frames*ambix->info.otherchannels) bytes of non-ambisonics data
+ *
+ * @param frames number of sample frames you want to write
+ *
+ * @return the number of sample frames successfully written, or a negative
+ * error code
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+int64_t ambix_writef_pcm24_raw (ambix_t *ambix, const void *ambidata, const void *otherdata, int64_t frames) ;
+
+/** @brief Quantize floating point data within the library when writing
+ *
+ * By default, floating point data written to an integer (PCM16/PCM24) file
+ * is converted by the backend, which simply clips without dithering.
+ * After calling this function, ambix_writef_float32() and
+ * ambix_writef_float64() apply the adaptor matrix, add dither, clip and
+ * pack the samples in a single pass.
+ *
+ * @param ambix The handle to an ambix file opened for writing
+ *
+ * @param dither The type of dither to use (@ref AMBIX_DITHER_NONE only rounds)
+ *
+ * @return an errorcode indicating success (@ref AMBIX_ERR_INVALID_FORMAT if
+ * the file is not a PCM16/PCM24 file opened for writing)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_set_dither (ambix_t *ambix, ambix_dither_t dither) ;
+
+/** @brief Get the number of samples clipped when quantizing
+ *
+ * Only samples quantized by the library (see ambix_set_dither()) are
+ * counted.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @return the number of clipped samples written so far
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+uint64_t ambix_get_clipcount (ambix_t *ambix) ;
+
+/** @brief Reserve disk space for sample frames yet to be written
+ *
+ * Preallocates the space needed for another number of sample frames beyond
+ * the current end of the file (e.g. the expected length of a recording), so
+ * the filesystem doesn't have to allocate (and fragment) the file while it
+ * grows.
+ * The size of the file does not change; whatever was not used is released
+ * again when the file is closed.
+ *
+ * Typically this is called right after opening the file, with the number of
+ * frames from the ambix_info_t.
+ *
+ * @param ambix The handle to an ambix file opened for writing (by path)
+ *
+ * @param frames The number of sample frames to reserve space for
+ *
+ * @return an errorcode indicating success (@ref AMBIX_ERR_INVALID_FILE for
+ * streams, virtual files and files opened for reading; @ref AMBIX_ERR_UNKNOWN
+ * if the system or filesystem cannot preallocate)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_reserve (ambix_t *ambix, int64_t frames) ;
+
+/** @brief Update the header of a file while it is being written
+ *
+ * The size of the audio data is usually only written to the header when the
+ * file is closed, so a recording that is never closed properly (e.g. because
+ * the application crashed) appears to be empty.
+ * A checkpoint patches the size fields of the header in place (the header is
+ * not rewritten), so the file is valid up to the frames written so far.
+ *
+ * Frames written after the last checkpoint are only read if the file is
+ * closed properly. A recording interrupted before its first checkpoint can
+ * still be read with @ref AMBIX_RECOVER.
+ *
+ * @param ambix The handle to an ambix file opened for writing
+ *
+ * @return an errorcode indicating success (@ref AMBIX_ERR_INVALID_FILE for
+ * files opened for reading, or files whose header cannot be accessed)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_checkpoint (ambix_t *ambix) ;
+
+/** @brief Periodically update the header while writing
+ *
+ * Makes the ambix_writef() functions call ambix_checkpoint() whenever another
+ * number of seconds (of audio) has been written, so an unattended recording
+ * never loses more than that if it is interrupted.
+ *
+ * @param ambix The handle to an ambix file opened for writing
+ *
+ * @param seconds The interval between checkpoints (0 disables checkpoints)
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_set_checkpoint (ambix_t *ambix, float64_t seconds) ;
+
+/** @brief Check whether the header of a file had to be recovered
+ *
+ * @param ambix The handle to an ambix file opened for reading with @ref
+ * AMBIX_RECOVER
+ *
+ * @return TRUE if the header was stale, and the number of frames was taken
+ * from the length of the file
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+int ambix_is_recovered (ambix_t *ambix) ;
+
+/** @brief Create a segmented ambix file for writing
+ *
+ * A segmented file is a sequence of ordinary ambix files (segments), which
+ * are filled one after the other: once a segment holds the maximum number of
+ * sample frames, writing seamlessly continues with the next segment (splitting
+ * blocks at the exact frame boundary).
+ * This keeps the size of the individual files within the limits of the
+ * filesystem, and limits the loss in case of a crash to the segment being
+ * written.
+ *
+ * The next segment is opened ahead of time, and full segments are finalized,
+ * on a separate thread; so writing only has to wait for the filesystem if a
+ * segment fills up before the next one could be opened.
+ *
+ * Every segment gets the same header (including the adaptor matrix, if any).
+ *
+ * @param pattern The filename pattern for the segments; it must contain
+ * exactly one integer conversion (e.g. "take1-%03d.caf"), which is replaced by
+ * the index of the segment (starting with 0)
+ *
+ * @param mode The mode to open the segments with; must include @ref
+ * AMBIX_WRITE (and must not include @ref AMBIX_READ or @ref AMBIX_STREAM)
+ *
+ * @param ambixinfo The format of the segments (as with ambix_open())
+ *
+ * @param matrix The adaptor matrix for all segments (or NULL if the format
+ * doesn't need one)
+ *
+ * @param maxframes The maximum number of sample frames per segment (0 for no
+ * limit)
+ *
+ * @param maxbytes The maximum size of the audio data per segment in bytes (0
+ * for no limit); it is rounded down to whole sample frames
+ *
+ * @return A handle to the segmented file (or NULL on failure)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_segmented_t *ambix_segmented_open (const char *pattern, const ambix_filemode_t mode, const ambix_info_t *ambixinfo,
+                                         const ambix_matrix_t *matrix, int64_t maxframes, int64_t maxbytes) ;
+
+/** @brief Write samples to a segmented ambix file
+ *
+ * Works like ambix_writef_float32(), rolling over to the next segment whenever
+ * the current one is full.
+ *
+ * @param segmented The handle to a segmented ambix file
+ *
+ * @param ambidata pointer to interleaved ambisonics sample data
+ *
+ * @param otherdata pointer to interleaved non-ambisonics sample data
+ *
+ * @param frames number of sample frames you want to write
+ *
+ * @return the number of sample frames successfully written (or a negative
+ * errorcode if nothing could be written, e.g. because the next segment could
+ * not be created)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+int64_t ambix_segmented_writef_float32 (ambix_segmented_t *segmented, const float32_t *ambidata, const float32_t *otherdata, int64_t frames) ;
+
+/** @brief Get the index of the segment currently written to
+ *
+ * @param segmented The handle to a segmented ambix file
+ *
+ * @return the index of the segment (as used in the filename pattern)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+uint32_t ambix_segmented_get_index (ambix_segmented_t *segmented) ;
+
+/** @brief Finalize a segmented ambix file
+ *
+ * Closes all segments and frees the handle.
+ *
+ * @param segmented The handle to a segmented ambix file
+ *
+ * @return an errorcode indicating success (the first error that occurred
+ * while finalizing any of the segments)
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_segmented_close (ambix_segmented_t *segmented) ;
+
+/** @brief Get the per-channel peak values of a file
+ *
+ * The peaks are the maximum absolute sample values (normalized to [0..1] for
+ * integer formats) of each channel as stored in the file, that is: the
+ * (reduced) ambisonics channels followed by the non-ambisonics channels.
+ *
+ * When reading, the PEAK chunk of the file is used if present; otherwise the
+ * entire file is scanned once (the read position is restored afterwards).
+ * When writing, the peaks of all the data written so far are returned; they
+ * are stored in a PEAK chunk when the file is closed.
+ *
+ * Once the peaks are known, channels that are entirely silent (e.g. the
+ * empty Z-channel of a horizontal-only recording) are skipped when applying
+ * the adaptor matrix during ambix_readf_float32() and friends.
+ *
+ * @param ambix The handle to an ambix file
+ * @param peaks An array to hold numchannels peak values
+ * @param numchannels The size of the peaks array; if this is larger than the
+ * number of channels in the file, the remaining entries are set to 0
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+ambix_err_t ambix_get_peaks (ambix_t *ambix, float32_t *peaks, uint32_t numchannels) ;
+
+/** @brief Get the positions of the per-channel peaks of a file
+ *
+ * @param ambix The handle to an ambix file
+ * @param positions An array to hold numchannels frame positions, where the
+ * peak values (as returned by ambix_get_peaks()) first occur; a position is
+ * -1 if it is unknown (e.g. if the file only provides the peak values)
+ * @param numchannels The size of the positions array
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+ambix_err_t ambix_get_peak_positions (ambix_t *ambix, int64_t *positions, uint32_t numchannels) ;
+
+/** @brief Enable the generation of a waveform overview
+ *
+ * If enabled, a multi-resolution overview (min/max/RMS for each bin of a
+ * given number of frames) is computed for each channel while writing, and
+ * stored in the file when it is closed. Level 0 has the finest resolution,
+ * each further level combines 16 bins of the previous one.
+ * To keep the memory bounded for long files, the number of bins is limited:
+ * once the finest level is full, adjacent bins of all levels are merged, so
+ * the binsizes (see ambix_get_overview_binsize()) double.
+ * If the overview cannot be computed (e.g. because memory runs out), it is
+ * dropped entirely and ambix_close() reports an error (the sample data is
+ * written nevertheless).
+ *
+ * This must be called before any sample data has been written.
+ *
+ * @param ambix The handle to an ambix file opened for writing
+ * @param enable Whether to compute the overview (1) or not (0)
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_set_overview (ambix_t *ambix, int enable) ;
+
+/** @brief Get the number of frames per bin of a waveform overview level
+ *
+ * @param ambix The handle to an ambix file
+ * @param level The resolution level (0 being the finest)
+ *
+ * @return the number of frames per bin, or 0 if the file has no overview
+ * (or the level does not exist)
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+uint32_t ambix_get_overview_binsize (ambix_t *ambix, uint32_t level) ;
+
+/** @brief Get bins of the waveform overview of a channel
+ *
+ * This allows drawing the waveform of an arbitrarily long file without
+ * reading its sample data. When reading, the overview stored in the file
+ * (see ambix_set_overview()) is used; when writing, the completed bins of
+ * the data written so far are available.
+ *
+ * @param ambix The handle to an ambix file
+ * @param channel The channel as stored in the file (the (reduced) ambisonics
+ * channels, followed by the non-ambisonics channels)
+ * @param level The resolution level (0 being the finest)
+ * @param offset The index of the first bin to get
+ * @param bins An array to hold numbins bins
+ * @param numbins The maximum number of bins to get
+ *
+ * @return the number of bins copied, or a negative error code
+ * (-@ref AMBIX_ERR_INVALID_FILE if the file has no overview)
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+int64_t ambix_get_overview (ambix_t *ambix, uint32_t channel, uint32_t level, int64_t offset, ambix_overview_t *bins, int64_t numbins) ;
+
+/** @brief Enable the generation of a directional energy index
+ *
+ * If enabled, the energy and the intensity vector of each block of frames
+ * are computed from the first order components (ACN 0-3) of the
+ * ambisonics signal while writing, and stored in the file when it is
+ * closed. This allows locating sound sources (e.g. with
+ * ambix_find_direction()) without decoding the file.
+ *
+ * This must be called before any sample data has been written, and
+ * requires (at least) a first order ambisonics signal.
+ *
+ * @param ambix The handle to an ambix file opened for writing
+ * @param blocksize The number of frames per block (0 disables the index)
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix_writef
+ */
+AMBIX_API
+ambix_err_t ambix_set_directionindex (ambix_t *ambix, uint32_t blocksize) ;
+
+/** @brief Get the number of frames per block of the directional energy index
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @return the number of frames per block, or 0 if the file has no directional energy index
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+uint32_t ambix_get_directionindex_blocksize (ambix_t *ambix) ;
+
+/** @brief Get blocks of the directional energy index
+ *
+ * @param ambix The handle to an ambix file
+ * @param offset The index of the first block to get
+ * @param blocks An array to hold numblocks blocks
+ * @param numblocks The maximum number of blocks to get
+ *
+ * @return the number of blocks copied, or a negative error code
+ * (-@ref AMBIX_ERR_INVALID_FILE if the file has no directional energy index)
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+int64_t ambix_get_directionindex (ambix_t *ambix, int64_t offset, ambix_direction_t *blocks, int64_t numblocks) ;
+
+/** @brief Find blocks with energy arriving from a given direction
+ *
+ * Searches the directional energy index for blocks whose intensity vector
+ * points (within a given angle) towards a direction, and whose intensity
+ * exceeds a threshold.
+ *
+ * @param ambix The handle to an ambix file
+ * @param azimuth The azimuth of the direction (in radians, counter-clockwise from the front)
+ * @param elevation The elevation of the direction (in radians, upwards from the horizontal plane)
+ * @param width The maximum angle (in radians) between the direction and the intensity vector
+ * @param threshold The minimum magnitude of the intensity vector
+ * @param blocks An array to hold the indices of up to numblocks matching blocks
+ * (the first frame of a block is its index times the blocksize)
+ * @param numblocks The maximum number of block indices to return
+ *
+ * @return the number of matching blocks found, or a negative error code
+ *
+ * @ingroup ambix_readf
+ */
+AMBIX_API
+int64_t ambix_find_direction (ambix_t *ambix, float32_t azimuth, float32_t elevation, float32_t width, float32_t threshold, int64_t *blocks, int64_t numblocks) ;
 /**
  * typedef from libsndfile
  * @private
@@ -752,8 +1533,12 @@ ambix_matrix_t* ambix_matrix_pinv(const ambix_matrix_t*matrix, ambix_matrix_t*pi
  *
  * @return an error code indicating success
  *
- * @remark Both source and dest data are arranged column-wise (as is the default
- * for interleaved audio-data).
+ * @remark For historical reasons, the floating point variants expect both
+ * source and dest data to be arranged column-wise (as is the default for
+ * interleaved audio-data), whereas the integer variants expect them to be
+ * arranged row-wise (planar, one channel after the other).
+ * Use the explicit _interleaved and _planar variants to avoid the confusion
+ * (see @ref ambix_matrix_multiply_interleaved and @ref ambix_matrix_multiply_planar).
  */
 
 /** @brief Multiply a matrix with (32bit floating point) data
@@ -781,6 +1566,161 @@ ambix_err_t ambix_matrix_multiply_int32(int32_t *dest, const ambix_matrix_t *mtx
 AMBIX_API
 ambix_err_t ambix_matrix_multiply_int16(int16_t *dest, const ambix_matrix_t *mtx, const int16_t *source, int64_t frames) ;
 
+/** @brief Multiply a matrix with interleaved data
+ * @defgroup ambix_matrix_multiply_interleaved ambix_matrix_multiply_interleaved()
+ * @ingroup ambix_matrix
+ *
+ * Multiply a [rows*cols] matrix with [frames] frames of interleaved source
+ * data (cols samples per frame) to get [frames] frames of interleaved dest
+ * data (rows samples per frame).
+ *
+ * @param dest a pointer to hold the output data; it must be large enough to
+ * hold at least rows*frames samples (allocated by the user).
+ *
+ * @param mtx the matrix to multiply source with.
+ *
+ * @param source a pointer to an array that holds cols*frames samples (allocated
+ * by the user).
+ *
+ * @param frames number of frames in source
+ *
+ * @return an error code indicating success
+ *
+ * @remark Integer results are saturated to the range of the sample type.
+ */
+/** @brief Multiply a matrix with interleaved (32bit floating point) data
+ *
+ * @ingroup ambix_matrix_multiply_interleaved
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float32_interleaved(float32_t *dest, const ambix_matrix_t *mtx, const float32_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with interleaved (64bit float) data
+ *
+ * @ingroup ambix_matrix_multiply_interleaved
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float64_interleaved(float64_t *dest, const ambix_matrix_t *mtx, const float64_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with interleaved (32bit signed integer) data
+ *
+ * @ingroup ambix_matrix_multiply_interleaved
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_int32_interleaved(int32_t *dest, const ambix_matrix_t *mtx, const int32_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with interleaved (16 bit signed integer) data
+ *
+ * @ingroup ambix_matrix_multiply_interleaved
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_int16_interleaved(int16_t *dest, const ambix_matrix_t *mtx, const int16_t *source, int64_t frames) ;
+
+/** @brief Multiply a matrix with planar data
+ * @defgroup ambix_matrix_multiply_planar ambix_matrix_multiply_planar()
+ * @ingroup ambix_matrix
+ *
+ * Multiply a [rows*cols] matrix with planar source data (cols channels of
+ * [frames] contiguous samples each) to get planar dest data (rows channels of
+ * [frames] contiguous samples each).
+ *
+ * @param dest a pointer to hold the output data; it must be large enough to
+ * hold at least rows*frames samples (allocated by the user).
+ *
+ * @param mtx the matrix to multiply source with.
+ *
+ * @param source a pointer to an array that holds cols*frames samples (allocated
+ * by the user).
+ *
+ * @param frames number of frames in source
+ *
+ * @return an error code indicating success
+ *
+ * @remark Integer results are saturated to the range of the sample type.
+ */
+/** @brief Multiply a matrix with planar (32bit floating point) data
+ *
+ * @ingroup ambix_matrix_multiply_planar
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float32_planar(float32_t *dest, const ambix_matrix_t *mtx, const float32_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with planar (64bit float) data
+ *
+ * @ingroup ambix_matrix_multiply_planar
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float64_planar(float64_t *dest, const ambix_matrix_t *mtx, const float64_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with planar (32bit signed integer) data
+ *
+ * @ingroup ambix_matrix_multiply_planar
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_int32_planar(int32_t *dest, const ambix_matrix_t *mtx, const int32_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with planar (16 bit signed integer) data
+ *
+ * @ingroup ambix_matrix_multiply_planar
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_int16_planar(int16_t *dest, const ambix_matrix_t *mtx, const int16_t *source, int64_t frames) ;
+
+/** @brief Multiply a matrix with (32bit floating point) data, using multiple threads
+ *
+ * This is the same as ambix_matrix_multiply_float32(), but large blocks of
+ * data are split into chunks of frames which are processed in parallel.
+ *
+ * @return an error code indicating success (or the first error of any chunk)
+ *
+ * @ingroup ambix_matrix_multiply_data
+ * @see ambix_set_num_threads
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float32_mt(float32_t *dest, const ambix_matrix_t *mtx, const float32_t *source, int64_t frames) ;
+
+/** @brief Set the number of threads used for processing
+ *
+ * libambix can distribute expensive operations (applying the adaptor matrix
+ * to large blocks when reading or writing, matrix multiplications) among a
+ * small pool of worker threads.
+ * The setting is process-wide; the worker threads are created lazily.
+ *
+ * @param numthreads the number of threads to use (including the calling
+ * thread); 1 (the default) disables multi-threading; 0 uses one thread per
+ * online CPU.
+ *
+ * @remark Multi-threading is only available if libambix has been compiled with
+ * pthreads support.
+ *
+ * @ingroup ambix_utilities
+ */
+AMBIX_API
+void ambix_set_num_threads(uint32_t numthreads) ;
+/** @brief Flush denormals to zero during processing
+ *
+ * Denormal numbers (e.g. in decaying reverb tails) can make floating point
+ * operations 10-100 times slower on some CPUs.
+ * By default, libambix temporarily enables flush-to-zero (and
+ * denormals-are-zero, where available) on the calling thread within
+ * ambix_readf_*(), ambix_writef_*() and ambix_matrix_multiply_*(), and
+ * restores the original state before returning.
+ * The host application does not need to touch the FPU control registers.
+ *
+ * @param flush whether to flush denormals to zero (default: TRUE)
+ *
+ * @remark The setting is process-wide. It has no effect on architectures
+ * where libambix does not know how to control denormal handling.
+ *
+ * @ingroup ambix_utilities
+ */
+AMBIX_API
+void ambix_set_flush_denormals(int flush) ;
+
+/** @brief Get the number of threads used for processing
+ *
+ * @return the number of threads libambix uses for processing
+ *
+ * @see ambix_set_num_threads
+ * @ingroup ambix_utilities
+ */
+AMBIX_API
+uint32_t ambix_get_num_threads(void) ;
+
 /**
  * @section api_utils utility functions
  */
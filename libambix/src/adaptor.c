@@ -26,6 +26,9 @@
 #ifdef HAVE_STDLIB_H
 # include <stdlib.h>
 #endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
 
 static inline uint64_t max_u64(uint64_t a, uint64_t b) {
   return((a>b)?a:b);
@@ -88,21 +91,22 @@ _AMBIX_SPLITADAPTOR(int16);
 
 
 #define _AMBIX_SPLITADAPTOR_MATRIX(type)                                \
-  ambix_err_t _ambix_splitAdaptormatrix_##type(const type##_t*source, uint32_t sourcechannels, \
-                                               const ambix_matrix_t*matrix, \
-                                               type##_t*dest_ambi, type##_t*dest_other, \
-                                               int64_t frames) {        \
+  AMBIX_ALWAYS_INLINE ambix_err_t _ambix_splitAdaptormatrix_kernel_##type(const type##_t*source, uint32_t sourcechannels, \
+                                                                          const ambix_matrix_t*matrix, \
+                                                                          const uint32_t rawambichannels, \
+                                                                          const uint32_t fullambichannels, \
+                                                                          type##_t*dest_ambi, type##_t*dest_other, \
+                                                                          int64_t frames) { \
     float32_t**mtx=matrix->data;                                        \
-    const uint32_t fullambichannels=matrix->rows;                       \
-    const uint32_t rawambichannels=matrix->cols;                        \
     int64_t f;                                                          \
     for(f=0; f<frames; f++) {                                           \
       uint32_t outchan, inchan;                                         \
       const type##_t*src = source+sourcechannels*f;                     \
       for(outchan=0; outchan<fullambichannels; outchan++) {             \
+        const float32_t*row=mtx[outchan];                               \
         float32_t sum=0.;                                               \
         for(inchan=0; inchan<rawambichannels; inchan++) {               \
-          sum+=mtx[outchan][inchan] * src[inchan];                      \
+          sum+=row[inchan] * src[inchan];                               \
         }                                                               \
         *dest_ambi++=(type##_t)sum;  /* FIXXXME: integer saturation */  \
       }                                                                 \
@@ -110,6 +114,13 @@ _AMBIX_SPLITADAPTOR(int16);
         *dest_other++=src[inchan];                                      \
     }                                                                   \
     return AMBIX_ERR_SUCCESS;                                           \
+  }                                                                     \
+  ambix_err_t _ambix_splitAdaptormatrix_##type(const type##_t*source, uint32_t sourcechannels, \
+                                               const ambix_matrix_t*matrix, \
+                                               type##_t*dest_ambi, type##_t*dest_other, \
+                                               int64_t frames) {        \
+    AMBIX_DISPATCH_CHANNELS2(matrix->cols, matrix->rows, C, R,          \
+                             _ambix_splitAdaptormatrix_kernel_##type(source, sourcechannels, matrix, C, R, dest_ambi, dest_other, frames)); \
   }
 
 _AMBIX_SPLITADAPTOR_MATRIX(float32);
@@ -120,6 +131,195 @@ _AMBIX_SPLITADAPTOR_MATRIX(float64);
 _AMBIX_SPLITADAPTOR_MATRIX(int32);
 _AMBIX_SPLITADAPTOR_MATRIX(int16);
 
+/* decode a single frame of raw integer PCM data (in native byte order) into normalized floats */
+static inline void _ambix_pcm16_decode(const unsigned char*src, float32_t*dest, uint32_t channels) {
+  const float32_t scale=1./(float32_t)0x8000;
+  uint32_t c;
+  for(c=0; c<channels; c++, src+=2) {
+    int16_t v;
+    memcpy(&v, src, 2);
+    dest[c]=scale*(float32_t)v;
+  }
+}
+static inline void _ambix_pcm24_decode(const unsigned char*src, float32_t*dest, uint32_t channels) {
+  const float32_t scale=1./(float32_t)0x800000;
+  uint32_t c;
+  /* shift the 24bit value into the upper bytes, and sign-extend back down */
+  if(_ambix_is_bigendian()) {
+    for(c=0; c<channels; c++, src+=3)
+      dest[c]=scale*(float32_t)((int32_t)(((uint32_t)src[0]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[2]<<8))>>8);
+  } else {
+    for(c=0; c<channels; c++, src+=3)
+      dest[c]=scale*(float32_t)((int32_t)(((uint32_t)src[2]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[0]<<8))>>8);
+  }
+}
+
+/* a decoded frame lives on the stack (only files with an unusual number of
+ * channels need to allocate it) */
+#define AMBIX_PCM_MAXFRAME 512
+
+#define _AMBIX_SPLITADAPTOR_MATRIX_PCM(type)                            \
+  ambix_err_t _ambix_splitAdaptormatrix_pcm_##type(const void*source, uint32_t samplebytes, \
+                                                   uint32_t sourcechannels, \
+                                                   const ambix_matrix_t*matrix, \
+                                                   type##_t*dest_ambi, type##_t*dest_other, \
+                                                   int64_t frames) {    \
+    float32_t**mtx=matrix->data;                                        \
+    const uint32_t fullambichannels=matrix->rows;                       \
+    const uint32_t rawambichannels=matrix->cols;                        \
+    const unsigned char*src=(const unsigned char*)source;               \
+    const uint32_t framesize=samplebytes*sourcechannels;                \
+    float32_t stackframe[AMBIX_PCM_MAXFRAME];                           \
+    float32_t*frame=stackframe;                                         \
+    int64_t f;                                                          \
+    if(samplebytes!=2 && samplebytes!=3)                                \
+      return AMBIX_ERR_INVALID_FORMAT;                                  \
+    /* a single decoded frame, which stays in cache for the matrix multiplication */ \
+    if(sourcechannels>AMBIX_PCM_MAXFRAME)                               \
+      frame=(float32_t*)malloc(sourcechannels*sizeof(float32_t));       \
+    if(!frame)                                                          \
+      return AMBIX_ERR_UNKNOWN;                                         \
+    for(f=0; f<frames; f++, src+=framesize) {                           \
+      uint32_t outchan, inchan;                                         \
+      if(2==samplebytes)                                                \
+        _ambix_pcm16_decode(src, frame, sourcechannels);                 \
+      else                                                              \
+        _ambix_pcm24_decode(src, frame, sourcechannels);                 \
+      for(outchan=0; outchan<fullambichannels; outchan++) {             \
+        const float32_t*row=mtx[outchan];                               \
+        float32_t sum=0.;                                               \
+        for(inchan=0; inchan<rawambichannels; inchan++)                 \
+          sum+=row[inchan] * frame[inchan];                             \
+        *dest_ambi++=(type##_t)sum;                                     \
+      }                                                                 \
+      for(inchan=rawambichannels; inchan<sourcechannels; inchan++)      \
+        *dest_other++=(type##_t)frame[inchan];                          \
+    }                                                                   \
+    if(frame!=stackframe)                                               \
+      free(frame);                                                      \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+_AMBIX_SPLITADAPTOR_MATRIX_PCM(float32);
+_AMBIX_SPLITADAPTOR_MATRIX_PCM(float64);
+
+/* apply a reduced adaptor matrix: silent source channels are never touched,
+ * and rows that only refer to silent channels are simply zeroed */
+#define _AMBIX_SPLITADAPTOR_PLAN(type)                                  \
+  ambix_err_t _ambix_splitAdaptorplan_##type(const type##_t*source, uint32_t sourcechannels, \
+                                             uint32_t rawambichannels, const ambix_matrixplan_t*plan, \
+                                             uint32_t fullambichannels, \
+                                             type##_t*dest_ambi, type##_t*dest_other, \
+                                             int64_t frames) {          \
+    float32_t**mtx=plan->compact.data;                                  \
+    const uint32_t numrows=plan->compact.rows;                          \
+    const uint32_t numcols=plan->compact.cols;                          \
+    const uint32_t*rows=plan->rows;                                     \
+    const uint32_t*cols=plan->columns;                                  \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++, dest_ambi+=fullambichannels) {              \
+      uint32_t r, c, inchan;                                            \
+      const type##_t*src = source+sourcechannels*f;                     \
+      memset(dest_ambi, 0, fullambichannels*sizeof(type##_t));          \
+      for(r=0; r<numrows; r++) {                                        \
+        const float32_t*row=mtx[r];                                     \
+        float32_t sum=0.;                                               \
+        for(c=0; c<numcols; c++)                                        \
+          sum+=row[c] * src[cols[c]];                                   \
+        dest_ambi[rows[r]]=_ambix_mtxmul_convert_##type(sum);           \
+      }                                                                 \
+      for(inchan=rawambichannels; inchan<sourcechannels; inchan++)      \
+        *dest_other++=src[inchan];                                      \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+_AMBIX_SPLITADAPTOR_PLAN(float32);
+_AMBIX_SPLITADAPTOR_PLAN(float64);
+_AMBIX_SPLITADAPTOR_PLAN(int32);
+_AMBIX_SPLITADAPTOR_PLAN(int16);
+
+#define _AMBIX_SPLITADAPTOR_PLAN_PCM(type)                              \
+  ambix_err_t _ambix_splitAdaptorplan_pcm_##type(const void*source, uint32_t samplebytes, \
+                                                 uint32_t sourcechannels, uint32_t rawambichannels, \
+                                                 const ambix_matrixplan_t*plan, \
+                                                 uint32_t fullambichannels, \
+                                                 type##_t*dest_ambi, type##_t*dest_other, \
+                                                 int64_t frames) {      \
+    float32_t**mtx=plan->compact.data;                                  \
+    const uint32_t numrows=plan->compact.rows;                          \
+    const uint32_t numcols=plan->compact.cols;                          \
+    const uint32_t*rows=plan->rows;                                     \
+    const uint32_t*cols=plan->columns;                                  \
+    const unsigned char*src=(const unsigned char*)source;               \
+    const uint32_t framesize=samplebytes*sourcechannels;                \
+    float32_t stackframe[AMBIX_PCM_MAXFRAME];                           \
+    float32_t*frame=stackframe;                                         \
+    int64_t f;                                                          \
+    if(samplebytes!=2 && samplebytes!=3)                                \
+      return AMBIX_ERR_INVALID_FORMAT;                                  \
+    if(sourcechannels>AMBIX_PCM_MAXFRAME)                               \
+      frame=(float32_t*)malloc(sourcechannels*sizeof(float32_t));       \
+    if(!frame)                                                          \
+      return AMBIX_ERR_UNKNOWN;                                         \
+    for(f=0; f<frames; f++, src+=framesize, dest_ambi+=fullambichannels) { \
+      uint32_t r, c, inchan;                                            \
+      if(2==samplebytes)                                                \
+        _ambix_pcm16_decode(src, frame, sourcechannels);                 \
+      else                                                              \
+        _ambix_pcm24_decode(src, frame, sourcechannels);                 \
+      memset(dest_ambi, 0, fullambichannels*sizeof(type##_t));          \
+      for(r=0; r<numrows; r++) {                                        \
+        const float32_t*row=mtx[r];                                     \
+        float32_t sum=0.;                                               \
+        for(c=0; c<numcols; c++)                                        \
+          sum+=row[c] * frame[cols[c]];                                 \
+        dest_ambi[rows[r]]=(type##_t)sum;                               \
+      }                                                                 \
+      for(inchan=rawambichannels; inchan<sourcechannels; inchan++)      \
+        *dest_other++=(type##_t)frame[inchan];                          \
+    }                                                                   \
+    if(frame!=stackframe)                                               \
+      free(frame);                                                      \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+_AMBIX_SPLITADAPTOR_PLAN_PCM(float32);
+_AMBIX_SPLITADAPTOR_PLAN_PCM(float64);
+
+#define _AMBIX_SPLITADAPTOR_CHANNELS(type)                              \
+  ambix_err_t _ambix_splitAdaptorchannels_##type(const type##_t*source, uint32_t sourcechannels, \
+                                                 const ambix_matrix_t*matrix, \
+                                                 const uint32_t*channels, uint32_t numchannels, \
+                                                 type##_t*dest, int64_t frames) { \
+    float32_t**mtx=matrix?matrix->data:NULL;                            \
+    const uint32_t fullambichannels=matrix?matrix->rows:0;              \
+    const uint32_t rawambichannels=matrix?matrix->cols:0;               \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++) {                                           \
+      uint32_t i, inchan;                                               \
+      const type##_t*src = source+sourcechannels*f;                     \
+      for(i=0; i<numchannels; i++) {                                    \
+        const uint32_t chan=channels[i];                                \
+        if(chan<fullambichannels) {                                     \
+          /* only compute the matrix rows that have been asked for */   \
+          const float32_t*row=mtx[chan];                                \
+          float32_t sum=0.;                                             \
+          for(inchan=0; inchan<rawambichannels; inchan++)               \
+            sum+=row[inchan] * src[inchan];                             \
+          *dest++=_ambix_mtxmul_convert_##type(sum);                    \
+        } else                                                          \
+          *dest++=src[chan-fullambichannels+rawambichannels];           \
+      }                                                                 \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+_AMBIX_SPLITADAPTOR_CHANNELS(float32);
+_AMBIX_SPLITADAPTOR_CHANNELS(float64);
+_AMBIX_SPLITADAPTOR_CHANNELS(int32);
+_AMBIX_SPLITADAPTOR_CHANNELS(int16);
+
 #define _AMBIX_MERGEADAPTOR(type)                                       \
   ambix_err_t _ambix_mergeAdaptor_##type(const type##_t*source1, uint32_t source1channels, \
                                          const type##_t*source2, uint32_t source2channels, \
@@ -144,21 +344,22 @@ _AMBIX_MERGEADAPTOR(int16);
 //#define _AMBIX_MERGEADAPTOR_MATRIX(type)      \
 
 #define _AMBIX_MERGEADAPTOR_MATRIX(type)                                \
-  ambix_err_t _ambix_mergeAdaptormatrix_##type(const type##_t*ambi_data, const ambix_matrix_t*matrix, \
-                                               const type##_t*otherdata, uint32_t source2channels, \
-                                               type##_t*destination, int64_t frames) { \
+  AMBIX_ALWAYS_INLINE ambix_err_t _ambix_mergeAdaptormatrix_kernel_##type(const type##_t*ambi_data, const ambix_matrix_t*matrix, \
+                                                                          const uint32_t fullambichannels, \
+                                                                          const uint32_t ambixchannels, \
+                                                                          const type##_t*otherdata, uint32_t source2channels, \
+                                                                          type##_t*destination, int64_t frames) { \
     float32_t**mtx=matrix->data;                                        \
-    const uint32_t fullambichannels=matrix->cols;                       \
-    const uint32_t ambixchannels=matrix->rows;                          \
     int64_t f;                                                          \
     for(f=0; f<frames; f++) {                                           \
       /* encode ambisonics->ambix and store in destination */           \
       uint32_t outchan, inchan;                                         \
       const type##_t*src = ambi_data+fullambichannels*f;                \
       for(outchan=0; outchan<ambixchannels; outchan++) {                \
+        const float32_t*row=mtx[outchan];                               \
         float32_t sum=0.;                                               \
         for(inchan=0; inchan<fullambichannels; inchan++) {              \
-          sum+=mtx[outchan][inchan] * src[inchan];                      \
+          sum+=row[inchan] * src[inchan];                               \
         }                                                               \
         *destination++=(type##_t)sum;                                   \
       }                                                                 \
@@ -167,9 +368,265 @@ _AMBIX_MERGEADAPTOR(int16);
         *destination++=*otherdata++;                                    \
     }                                                                   \
     return AMBIX_ERR_SUCCESS;                                           \
+  }                                                                     \
+  ambix_err_t _ambix_mergeAdaptormatrix_##type(const type##_t*ambi_data, const ambix_matrix_t*matrix, \
+                                               const type##_t*otherdata, uint32_t source2channels, \
+                                               type##_t*destination, int64_t frames) { \
+    AMBIX_DISPATCH_CHANNELS2(matrix->cols, matrix->rows, C, R,          \
+                             _ambix_mergeAdaptormatrix_kernel_##type(ambi_data, matrix, C, R, otherdata, source2channels, destination, frames)); \
   }
 
 _AMBIX_MERGEADAPTOR_MATRIX(float32);
 _AMBIX_MERGEADAPTOR_MATRIX(float64);
 _AMBIX_MERGEADAPTOR_MATRIX(int32);
 _AMBIX_MERGEADAPTOR_MATRIX(int16);
+
+
+/* multi-threaded variants of the matrix adaptors:
+ * the frames are split into chunks which are processed by the worker pool
+ */
+/* the per-frame cost of applying the (reduced) adaptor matrix */
+static inline uint64_t _ambix_splitcost(const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan) {
+  if(plan)
+    return (uint64_t)plan->compact.rows*plan->compact.cols + matrix->rows;
+  return (uint64_t)matrix->rows*matrix->cols;
+}
+#define _AMBIX_SPLITADAPTOR_MATRIX_MT(type)                             \
+  typedef struct _ambix_splitjob_##type {                               \
+    const type##_t*source;                                              \
+    uint32_t sourcechannels;                                            \
+    const ambix_matrix_t*matrix;                                        \
+    const ambix_matrixplan_t*plan;                                      \
+    type##_t*dest_ambi, *dest_other;                                    \
+    ambix_err_t err;                                                    \
+  } ambix_splitjob_##type##_t;                                          \
+  static void _ambix_splitjob_##type(void*userdata, int64_t offset, int64_t frames) { \
+    ambix_splitjob_##type##_t*job=(ambix_splitjob_##type##_t*)userdata; \
+    const ambix_matrix_t*matrix=job->matrix;                            \
+    const uint32_t otherchannels=job->sourcechannels-matrix->cols;      \
+    const type##_t*source=job->source+offset*job->sourcechannels;       \
+    type##_t*dest_ambi=job->dest_ambi+offset*matrix->rows;              \
+    type##_t*dest_other=otherchannels?(job->dest_other+offset*otherchannels):job->dest_other; \
+    ambix_err_t err=job->plan                                           \
+      ?_ambix_splitAdaptorplan_##type(source, job->sourcechannels, matrix->cols, job->plan, matrix->rows, \
+                                      dest_ambi, dest_other, frames)    \
+      :_ambix_splitAdaptormatrix_##type(source, job->sourcechannels, matrix, \
+                                        dest_ambi, dest_other, frames); \
+    if(AMBIX_ERR_SUCCESS!=err)job->err=err;                             \
+  }                                                                     \
+  ambix_err_t _ambix_splitAdaptormatrix_mt_##type(const type##_t*source, uint32_t sourcechannels, \
+                                                  const ambix_matrix_t*matrix, \
+                                                  const ambix_matrixplan_t*plan, \
+                                                  type##_t*dest_ambi, type##_t*dest_other, \
+                                                  int64_t frames) {     \
+    ambix_splitjob_##type##_t job;                                      \
+    job.source=source;                                                  \
+    job.sourcechannels=sourcechannels;                                  \
+    job.matrix=matrix;                                                  \
+    job.plan=plan;                                                      \
+    job.dest_ambi=dest_ambi;                                            \
+    job.dest_other=dest_other;                                          \
+    job.err=AMBIX_ERR_SUCCESS;                                          \
+    _ambix_parallel_frames(_ambix_splitjob_##type, &job, frames, _ambix_splitcost(matrix, plan)); \
+    return job.err;                                                     \
+  }
+
+_AMBIX_SPLITADAPTOR_MATRIX_MT(float32);
+_AMBIX_SPLITADAPTOR_MATRIX_MT(float64);
+_AMBIX_SPLITADAPTOR_MATRIX_MT(int32);
+_AMBIX_SPLITADAPTOR_MATRIX_MT(int16);
+
+#define _AMBIX_SPLITADAPTOR_MATRIX_PCM_MT(type)                         \
+  typedef struct _ambix_splitjob_pcm_##type {                           \
+    unsigned char*source;                                               \
+    uint32_t samplebytes;                                               \
+    int bigendian;                                                      \
+    uint32_t sourcechannels;                                            \
+    const ambix_matrix_t*matrix;                                        \
+    const ambix_matrixplan_t*plan;                                      \
+    type##_t*dest_ambi, *dest_other;                                    \
+    ambix_err_t err;                                                    \
+  } ambix_splitjob_pcm_##type##_t;                                      \
+  static void _ambix_splitjob_pcm_##type(void*userdata, int64_t offset, int64_t frames) { \
+    ambix_splitjob_pcm_##type##_t*job=(ambix_splitjob_pcm_##type##_t*)userdata; \
+    const ambix_matrix_t*matrix=job->matrix;                            \
+    const uint32_t otherchannels=job->sourcechannels-matrix->cols;      \
+    unsigned char*source=job->source+offset*job->sourcechannels*job->samplebytes; \
+    type##_t*dest_ambi=job->dest_ambi+offset*matrix->rows;              \
+    type##_t*dest_other=otherchannels?(job->dest_other+offset*otherchannels):job->dest_other; \
+    ambix_err_t err;                                                    \
+    /* each thread brings its own chunk into native byte order */       \
+    if(job->bigendian != _ambix_is_bigendian())                         \
+      _ambix_swaparray(source, job->samplebytes, frames*job->sourcechannels); \
+    err=job->plan                                                       \
+      ?_ambix_splitAdaptorplan_pcm_##type(source, job->samplebytes,     \
+                                          job->sourcechannels, matrix->cols, job->plan, matrix->rows, \
+                                          dest_ambi, dest_other, frames) \
+      :_ambix_splitAdaptormatrix_pcm_##type(source, job->samplebytes,   \
+                                            job->sourcechannels, matrix, \
+                                            dest_ambi, dest_other, frames); \
+    if(AMBIX_ERR_SUCCESS!=err)job->err=err;                             \
+  }                                                                     \
+  ambix_err_t _ambix_splitAdaptormatrix_pcm_mt_##type(void*source, uint32_t samplebytes, int bigendian, \
+                                                      uint32_t sourcechannels, \
+                                                      const ambix_matrix_t*matrix, \
+                                                      const ambix_matrixplan_t*plan, \
+                                                      type##_t*dest_ambi, type##_t*dest_other, \
+                                                      int64_t frames) { \
+    ambix_splitjob_pcm_##type##_t job;                                  \
+    job.source=(unsigned char*)source;                                  \
+    job.samplebytes=samplebytes;                                        \
+    job.bigendian=bigendian;                                            \
+    job.sourcechannels=sourcechannels;                                  \
+    job.matrix=matrix;                                                  \
+    job.plan=plan;                                                      \
+    job.dest_ambi=dest_ambi;                                            \
+    job.dest_other=dest_other;                                          \
+    job.err=AMBIX_ERR_SUCCESS;                                          \
+    _ambix_parallel_frames(_ambix_splitjob_pcm_##type, &job, frames, _ambix_splitcost(matrix, plan)); \
+    return job.err;                                                     \
+  }
+
+_AMBIX_SPLITADAPTOR_MATRIX_PCM_MT(float32);
+_AMBIX_SPLITADAPTOR_MATRIX_PCM_MT(float64);
+
+#define _AMBIX_MERGEADAPTOR_MATRIX_MT(type)                             \
+  typedef struct _ambix_mergejob_##type {                               \
+    const type##_t*ambidata;                                            \
+    const ambix_matrix_t*matrix;                                        \
+    const type##_t*otherdata;                                           \
+    uint32_t otherchannels;                                             \
+    type##_t*destination;                                               \
+    ambix_err_t err;                                                    \
+  } ambix_mergejob_##type##_t;                                          \
+  static void _ambix_mergejob_##type(void*userdata, int64_t offset, int64_t frames) { \
+    ambix_mergejob_##type##_t*job=(ambix_mergejob_##type##_t*)userdata; \
+    const uint32_t otherchannels=job->otherchannels;                    \
+    ambix_err_t err=_ambix_mergeAdaptormatrix_##type(job->ambidata+offset*job->matrix->cols, job->matrix, \
+                                                     otherchannels?(job->otherdata+offset*otherchannels):job->otherdata, \
+                                                     otherchannels, \
+                                                     job->destination+offset*(job->matrix->rows+otherchannels), \
+                                                     frames);           \
+    if(AMBIX_ERR_SUCCESS!=err)job->err=err;                             \
+  }                                                                     \
+  ambix_err_t _ambix_mergeAdaptormatrix_mt_##type(const type##_t*ambidata, const ambix_matrix_t*matrix, \
+                                                  const type##_t*otherdata, uint32_t source2channels, \
+                                                  type##_t*destination, int64_t frames) { \
+    ambix_mergejob_##type##_t job;                                      \
+    job.ambidata=ambidata;                                              \
+    job.matrix=matrix;                                                  \
+    job.otherdata=otherdata;                                            \
+    job.otherchannels=source2channels;                                  \
+    job.destination=destination;                                        \
+    job.err=AMBIX_ERR_SUCCESS;                                          \
+    _ambix_parallel_frames(_ambix_mergejob_##type, &job, frames, (uint64_t)matrix->rows*matrix->cols); \
+    return job.err;                                                     \
+  }
+
+_AMBIX_MERGEADAPTOR_MATRIX_MT(float32);
+_AMBIX_MERGEADAPTOR_MATRIX_MT(float64);
+_AMBIX_MERGEADAPTOR_MATRIX_MT(int32);
+_AMBIX_MERGEADAPTOR_MATRIX_MT(int16);
+
+int _ambix_matrix_get_routing(const ambix_matrix_t*matrix, int32_t*route) {
+  uint32_t r, c;
+  for(r=0; r<matrix->rows; r++) {
+    const float32_t*row=matrix->data[r];
+    route[r]=-1;
+    for(c=0; c<matrix->cols; c++) {
+      if(0.f == row[c])
+        continue;
+      if(1.f != row[c] || route[r]>=0)
+        return 0;
+      route[r]=c;
+    }
+  }
+  return 1;
+}
+
+void _ambix_update_routing(ambix_t*ambix) {
+  const ambix_matrix_t*matrix=NULL;
+  switch(ambix->use_matrix) {
+  case 1: matrix=&ambix->matrix ; break;
+  case 2: matrix=&ambix->matrix2; break;
+  default: break;
+  }
+  free(ambix->route);
+  ambix->route=NULL;
+  if(!matrix || !matrix->rows)
+    return;
+  /* when reading, the matrix must consume exactly the channels in the file */
+  if((ambix->filemode & AMBIX_READ) && matrix->cols != ambix->realinfo.ambichannels)
+    return;
+  ambix->route=(int32_t*)malloc(matrix->rows*sizeof(*ambix->route));
+  if(ambix->route && !_ambix_matrix_get_routing(matrix, ambix->route)) {
+    free(ambix->route);
+    ambix->route=NULL;
+  }
+}
+
+ambix_err_t _ambix_splitAdaptor_pcm24(const unsigned char*source, uint32_t sourcechannels,
+                                      uint32_t rawambichannels, const int32_t*route, uint32_t ambichannels,
+                                      unsigned char*dest_ambi, unsigned char*dest_other,
+                                      int64_t frames) {
+  const uint32_t framesize=3*sourcechannels;
+  const uint32_t otherbytes=3*(sourcechannels-rawambichannels);
+  int64_t f;
+  if(!route) {
+    /* no routing: just de-interleave the two blocks */
+    for(f=0; f<frames; f++, source+=framesize) {
+      memcpy(dest_ambi, source, 3*rawambichannels);
+      dest_ambi+=3*rawambichannels;
+      memcpy(dest_other, source+3*rawambichannels, otherbytes);
+      dest_other+=otherbytes;
+    }
+    return AMBIX_ERR_SUCCESS;
+  }
+  for(f=0; f<frames; f++, source+=framesize) {
+    uint32_t outchan;
+    for(outchan=0; outchan<ambichannels; outchan++, dest_ambi+=3) {
+      const int32_t inchan=route[outchan];
+      if(inchan<0) {
+        dest_ambi[0]=dest_ambi[1]=dest_ambi[2]=0;
+      } else {
+        const unsigned char*src=source+3*inchan;
+        dest_ambi[0]=src[0];
+        dest_ambi[1]=src[1];
+        dest_ambi[2]=src[2];
+      }
+    }
+    memcpy(dest_other, source+3*rawambichannels, otherbytes);
+    dest_other+=otherbytes;
+  }
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t _ambix_mergeAdaptor_pcm24(const unsigned char*ambidata, uint32_t fullambichannels,
+                                      const int32_t*route, uint32_t ambixchannels,
+                                      const unsigned char*otherdata, uint32_t otherchannels,
+                                      unsigned char*destination, int64_t frames) {
+  const uint32_t otherbytes=3*otherchannels;
+  int64_t f;
+  for(f=0; f<frames; f++, ambidata+=3*fullambichannels) {
+    if(route) {
+      uint32_t outchan;
+      for(outchan=0; outchan<ambixchannels; outchan++, destination+=3) {
+        const int32_t inchan=route[outchan];
+        if(inchan<0) {
+          destination[0]=destination[1]=destination[2]=0;
+        } else {
+          const unsigned char*src=ambidata+3*inchan;
+          destination[0]=src[0];
+          destination[1]=src[1];
+          destination[2]=src[2];
+        }
+      }
+    } else {
+      memcpy(destination, ambidata, 3*fullambichannels);
+      destination+=3*fullambichannels;
+    }
+    memcpy(destination, otherdata, otherbytes);
+    destination+=otherbytes;
+    otherdata+=otherbytes;
+  }
+  return AMBIX_ERR_SUCCESS;
+}
@@ -0,0 +1,52 @@
+/* advise.c -  access pattern hints                 -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "private.h"
+
+#include <stdio.h>
+
+ambix_err_t ambix_advise(ambix_t*ambix, ambix_advice_t advice, int64_t offset, int64_t frames) {
+  int64_t framesize;
+  if(NULL==ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!(ambix->filemode & AMBIX_READ) || (ambix->filemode & AMBIX_STREAM))
+    return AMBIX_ERR_INVALID_FILE;
+  if(offset<0 || frames<0)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  framesize=ambix->channels*_ambix_samplebytes(ambix->realinfo.sampleformat);
+  return _ambix_advise(ambix, advice, offset*framesize, frames*framesize);
+}
+
+ambix_err_t ambix_preload(ambix_t*ambix, int64_t frames) {
+  int64_t position;
+  if(NULL==ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  position=ambix_seek(ambix, 0, SEEK_CUR);
+  if(position<0)
+    return AMBIX_ERR_INVALID_FILE;
+  /* a preload of 0 frames would load the entire file */
+  if(frames<1)
+    return AMBIX_ERR_SUCCESS;
+  return ambix_advise(ambix, AMBIX_ADVISE_WILLNEED, position, frames);
+}
@@ -0,0 +1,440 @@
+/* async.c -  asynchronous reads              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#include <errno.h>
+
+/* we talk to io_uring directly (no need for liburing) */
+#if defined HAVE_LINUX_IO_URING_H && defined HAVE_SYS_SYSCALL_H && defined HAVE_SYS_MMAN_H && defined HAVE_UNISTD_H
+# include <linux/io_uring.h>
+# include <sys/syscall.h>
+# include <sys/mman.h>
+# include <sys/uio.h>
+# if defined __NR_io_uring_setup && defined __NR_io_uring_enter
+#  define AMBIX_HAVE_IO_URING 1
+# endif
+#endif
+
+/* maximum number of pending requests per handle */
+#define AMBIX_ASYNC_DEPTH 32
+
+enum {
+  ASYNC_FREE=0,
+  ASYNC_PENDING,
+  ASYNC_DONE
+};
+
+typedef struct ambix_asyncrequest_t {
+  /** one of ASYNC_FREE, ASYNC_PENDING, ASYNC_DONE */
+  int state;
+  /** the first frame to read */
+  uint64_t position;
+  /** the number of frames to read */
+  int64_t frames;
+  /** where to put the decoded frames */
+  float32_t*ambidata;
+  float32_t*otherdata;
+  void*userdata;
+  /** the raw frames as read from disk */
+  unsigned char*buffer;
+  size_t buffersize;
+  /** number of bytes read (or a negative error) */
+  int64_t result;
+#ifdef AMBIX_HAVE_IO_URING
+  struct iovec iov;
+#endif
+} ambix_asyncrequest_t;
+
+typedef struct ambix_async_t {
+  /** our own file descriptor for the file */
+  int fd;
+  /** byte offset of the first frame */
+  int64_t offset;
+  /** bytes per (interleaved) raw frame */
+  uint32_t framesize;
+  /** number of requests submitted to the kernel and not yet completed */
+  uint32_t inflight;
+  ambix_asyncrequest_t requests[AMBIX_ASYNC_DEPTH];
+#ifdef AMBIX_HAVE_IO_URING
+  /** the io_uring instance (or -1 if not available) */
+  int ring;
+  void*sq_ptr;
+  size_t sq_size;
+  void*cq_ptr;
+  size_t cq_size;
+  struct io_uring_sqe*sqes;
+  size_t sqes_size;
+  unsigned*sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned*cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe*cqes;
+#endif
+} ambix_async_t;
+
+/* (synchronously) read what is still missing of a request */
+static int64_t async_pread(ambix_async_t*async, ambix_asyncrequest_t*req, int64_t got) {
+#if defined HAVE_UNISTD_H && defined HAVE_PREAD
+  const int64_t size=req->frames*async->framesize;
+  if(got<0)
+    got=0;
+  while(got<size) {
+    ssize_t n=pread(async->fd, req->buffer+got, size-got, async->offset+req->position*async->framesize+got);
+    if(n<0 && EINTR==errno)
+      continue;
+    if(n<=0)
+      break;
+    got+=n;
+  }
+  return got;
+#else
+  return -1;
+#endif
+}
+
+#ifdef AMBIX_HAVE_IO_URING
+static void async_ring_deinit(ambix_async_t*async) {
+  if(async->sqes && MAP_FAILED!=(void*)async->sqes)
+    munmap(async->sqes, async->sqes_size);
+  if(async->cq_ptr && MAP_FAILED!=async->cq_ptr)
+    munmap(async->cq_ptr, async->cq_size);
+  if(async->sq_ptr && MAP_FAILED!=async->sq_ptr)
+    munmap(async->sq_ptr, async->sq_size);
+  if(async->ring>=0)
+    close(async->ring);
+  async->sqes=NULL;
+  async->cq_ptr=async->sq_ptr=NULL;
+  async->ring=-1;
+}
+static void async_ring_init(ambix_async_t*async) {
+  struct io_uring_params p;
+  unsigned char*sq, *cq;
+  memset(&p, 0, sizeof(p));
+  async->ring=(int)syscall(__NR_io_uring_setup, AMBIX_ASYNC_DEPTH, &p);
+  if(async->ring<0)
+    return;
+  async->sq_size=p.sq_off.array+p.sq_entries*sizeof(unsigned);
+  async->cq_size=p.cq_off.cqes+p.cq_entries*sizeof(struct io_uring_cqe);
+  async->sqes_size=p.sq_entries*sizeof(struct io_uring_sqe);
+  async->sq_ptr=mmap(NULL, async->sq_size, PROT_READ|PROT_WRITE, MAP_SHARED, async->ring, IORING_OFF_SQ_RING);
+  async->cq_ptr=mmap(NULL, async->cq_size, PROT_READ|PROT_WRITE, MAP_SHARED, async->ring, IORING_OFF_CQ_RING);
+  async->sqes=(struct io_uring_sqe*)mmap(NULL, async->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED, async->ring, IORING_OFF_SQES);
+  if(MAP_FAILED==async->sq_ptr || MAP_FAILED==async->cq_ptr || MAP_FAILED==(void*)async->sqes) {
+    async_ring_deinit(async);
+    return;
+  }
+  sq=(unsigned char*)async->sq_ptr;
+  cq=(unsigned char*)async->cq_ptr;
+  async->sq_head =(unsigned*)(sq+p.sq_off.head);
+  async->sq_tail =(unsigned*)(sq+p.sq_off.tail);
+  async->sq_mask =(unsigned*)(sq+p.sq_off.ring_mask);
+  async->sq_array=(unsigned*)(sq+p.sq_off.array);
+  async->cq_head =(unsigned*)(cq+p.cq_off.head);
+  async->cq_tail =(unsigned*)(cq+p.cq_off.tail);
+  async->cq_mask =(unsigned*)(cq+p.cq_off.ring_mask);
+  async->cqes=(struct io_uring_cqe*)(cq+p.cq_off.cqes);
+}
+/* hand a request over to the kernel; returns FALSE if that failed */
+static int async_ring_submit(ambix_async_t*async, uint32_t index) {
+  ambix_asyncrequest_t*req=async->requests+index;
+  unsigned tail, slot;
+  struct io_uring_sqe*sqe;
+  int res;
+  if(async->ring<0)
+    return 0;
+  tail=*async->sq_tail;
+  slot=tail & *async->sq_mask;
+  sqe=async->sqes+slot;
+  req->iov.iov_base=req->buffer;
+  req->iov.iov_len=req->frames*async->framesize;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode=IORING_OP_READV;
+  sqe->fd=async->fd;
+  sqe->off=async->offset+req->position*async->framesize;
+  sqe->addr=(uint64_t)(uintptr_t)&req->iov;
+  sqe->len=1;
+  sqe->user_data=index;
+  async->sq_array[slot]=slot;
+  __atomic_store_n(async->sq_tail, tail+1, __ATOMIC_RELEASE);
+  do {
+    res=(int)syscall(__NR_io_uring_enter, async->ring, 1, 0, 0, NULL, 0);
+  } while(res<0 && EINTR==errno);
+  if(res<1) {
+    /* take the request back, unless the kernel already picked it up */
+    if(__atomic_load_n(async->sq_head, __ATOMIC_ACQUIRE)==tail)
+      __atomic_store_n(async->sq_tail, tail, __ATOMIC_RELEASE);
+    else
+      res=1;
+  }
+  if(res<1)
+    return 0;
+  async->inflight++;
+  return 1;
+}
+/* move completed requests from the kernel to the DONE state */
+static void async_ring_collect(ambix_async_t*async, int wait) {
+  while(async->ring>=0 && async->inflight) {
+    unsigned head=*async->cq_head;
+    const unsigned tail=__atomic_load_n(async->cq_tail, __ATOMIC_ACQUIRE);
+    int collected=0;
+    for(; head!=tail; head++) {
+      const struct io_uring_cqe*cqe=async->cqes+(head & *async->cq_mask);
+      ambix_asyncrequest_t*req=async->requests+cqe->user_data;
+      /* short reads (and kernels that refuse to read the file) are finished synchronously */
+      req->result=async_pread(async, req, cqe->res);
+      req->state=ASYNC_DONE;
+      async->inflight--;
+      collected++;
+    }
+    __atomic_store_n(async->cq_head, head, __ATOMIC_RELEASE);
+    if(collected || !wait || !async->inflight)
+      return;
+    if(syscall(__NR_io_uring_enter, async->ring, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0)<0 && EINTR!=errno)
+      return;
+  }
+}
+#else
+static void async_ring_init(ambix_async_t*async) {
+}
+static void async_ring_deinit(ambix_async_t*async) {
+}
+static int async_ring_submit(ambix_async_t*async, uint32_t index) {
+  return 0;
+}
+static void async_ring_collect(ambix_async_t*async, int wait) {
+}
+#endif
+
+static ambix_async_t*async_init(ambix_t*ambix) {
+  ambix_async_t*async=NULL;
+  const uint32_t samplebytes=_ambix_samplebytes(ambix->realinfo.sampleformat);
+  int fd=-1;
+  int64_t offset=0;
+  if(ambix->async)
+    return ambix->async;
+  if(!(ambix->filemode & AMBIX_READ) || !samplebytes || ambix->channels<1)
+    return NULL;
+  if(AMBIX_ERR_SUCCESS!=_ambix_get_datachunk(ambix, &fd, &offset))
+    return NULL;
+  async=(ambix_async_t*)calloc(1, sizeof(*async));
+  if(!async) {
+    close(fd);
+    return NULL;
+  }
+  async->fd=fd;
+  async->offset=offset;
+  async->framesize=samplebytes*ambix->channels;
+  async_ring_init(async);
+  ambix->async=async;
+  return async;
+}
+void _ambix_async_deinit(ambix_t*ambix) {
+  ambix_async_t*async=ambix->async;
+  uint32_t i;
+  if(!async)
+    return;
+  /* the kernel must be done with our buffers before we free them */
+  while(async->inflight) {
+    const uint32_t inflight=async->inflight;
+    async_ring_collect(async, 1);
+    if(inflight==async->inflight)
+      break;
+  }
+  async_ring_deinit(async);
+  close(async->fd);
+  for(i=0; i<AMBIX_ASYNC_DEPTH; i++)
+    free(async->requests[i].buffer);
+  free(async);
+  ambix->async=NULL;
+}
+
+/* convert raw samples (in the byte order of the file) to normalized floats;
+ * the raw samples are brought into native byte order in place */
+static void async_decode(unsigned char*src, ambix_sampleformat_t format, int bigendian, float32_t*dest, uint64_t samples) {
+  const uint32_t samplebytes=_ambix_samplebytes(format);
+  uint64_t s;
+  if(bigendian != _ambix_is_bigendian())
+    _ambix_swaparray(src, samplebytes, samples);
+  switch(format) {
+  case AMBIX_SAMPLEFORMAT_PCM16:
+    for(s=0; s<samples; s++, src+=2) {
+      int16_t v;
+      memcpy(&v, src, 2);
+      dest[s]=(float32_t)v/(float32_t)0x8000;
+    }
+    break;
+  case AMBIX_SAMPLEFORMAT_PCM24:
+    for(s=0; s<samples; s++, src+=3) {
+      const uint32_t v=_ambix_is_bigendian()
+        ?(((uint32_t)src[0]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[2]<<8))
+        :(((uint32_t)src[2]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[0]<<8));
+      dest[s]=(float32_t)((int32_t)v>>8)/(float32_t)0x800000;
+    }
+    break;
+  case AMBIX_SAMPLEFORMAT_PCM32:
+    for(s=0; s<samples; s++, src+=4) {
+      int32_t v;
+      memcpy(&v, src, 4);
+      dest[s]=(float32_t)((float64_t)v/(float64_t)0x80000000);
+    }
+    break;
+  case AMBIX_SAMPLEFORMAT_FLOAT32:
+    memcpy(dest, src, samples*sizeof(float32_t));
+    break;
+  case AMBIX_SAMPLEFORMAT_FLOAT64:
+    for(s=0; s<samples; s++, src+=8) {
+      float64_t v;
+      memcpy(&v, src, 8);
+      dest[s]=(float32_t)v;
+    }
+    break;
+  default:
+    memset(dest, 0, samples*sizeof(float32_t));
+    break;
+  }
+}
+/* fill the user's buffers of a completed request (like ambix_readf_float32()) */
+static int64_t async_finish(ambix_t*ambix, ambix_asyncrequest_t*req) {
+  const ambix_async_t*async=ambix->async;
+  const uint32_t channels=ambix->realinfo.ambichannels+ambix->realinfo.extrachannels;
+  const ambix_sampleformat_t format=ambix->realinfo.sampleformat;
+  const int bigendian=(_ambix_is_bigendian() != !!ambix->byteswap);
+  const ambix_matrix_t*matrix=NULL;
+  int64_t frames;
+  if(req->result<0)
+    return -AMBIX_ERR_INVALID_FILE;
+  frames=req->result/async->framesize;
+  if(frames<1)
+    return 0;
+  switch(ambix->use_matrix) {
+  case 1: matrix=&ambix->matrix ; break;
+  case 2: matrix=&ambix->matrix2; break;
+  default: break;
+  }
+  if(matrix && ambix->channels==channels && matrix->cols==ambix->realinfo.ambichannels
+     && (AMBIX_SAMPLEFORMAT_PCM16==format || AMBIX_SAMPLEFORMAT_PCM24==format)) {
+    _ambix_splitAdaptormatrix_pcm_mt_float32(req->buffer, _ambix_samplebytes(format), bigendian, channels,
+                                             matrix, _ambix_get_matrixplan(ambix, matrix), req->ambidata, req->otherdata, frames);
+    return frames;
+  }
+  if(AMBIX_ERR_SUCCESS!=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(float32_t)))
+    return AMBIX_ERR_UNKNOWN;
+  async_decode(req->buffer, format, bigendian, (float32_t*)ambix->adaptorbuffer, frames*ambix->channels);
+  if(matrix)
+    _ambix_splitAdaptormatrix_mt_float32((float32_t*)ambix->adaptorbuffer, channels, matrix, _ambix_get_matrixplan(ambix, matrix), req->ambidata, req->otherdata, frames);
+  else
+    _ambix_splitAdaptor_float32((float32_t*)ambix->adaptorbuffer, channels, ambix->realinfo.ambichannels, req->ambidata, req->otherdata, frames);
+  return frames;
+}
+
+ambix_err_t ambix_read_submit(ambix_t*ambix, uint64_t position, float32_t*ambidata, float32_t*otherdata, int64_t frames, void*userdata) {
+  ambix_async_t*async;
+  ambix_asyncrequest_t*req=NULL;
+  uint32_t index;
+  size_t size;
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(frames<0)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  async=async_init(ambix);
+  if(!async)
+    return AMBIX_ERR_INVALID_FILE;
+  for(index=0; index<AMBIX_ASYNC_DEPTH; index++) {
+    if(ASYNC_FREE==async->requests[index].state) {
+      req=async->requests+index;
+      break;
+    }
+  }
+  if(!req)
+    return AMBIX_ERR_UNKNOWN;
+
+  /* never read beyond the audio data */
+  if(position>=ambix->realinfo.frames)
+    frames=0;
+  else if((uint64_t)frames>ambix->realinfo.frames-position)
+    frames=(int64_t)(ambix->realinfo.frames-position);
+  size=frames*async->framesize;
+  if(size>req->buffersize) {
+    unsigned char*buffer=(unsigned char*)realloc(req->buffer, size);
+    if(!buffer)
+      return AMBIX_ERR_UNKNOWN;
+    req->buffer=buffer;
+    req->buffersize=size;
+  }
+  req->position=position;
+  req->frames=frames;
+  req->ambidata=ambidata;
+  req->otherdata=otherdata;
+  req->userdata=userdata;
+  req->result=0;
+  ambix->startedReading=1;
+
+  if(frames && async_ring_submit(async, index)) {
+    req->state=ASYNC_PENDING;
+  } else {
+    /* no io_uring: read right away */
+    req->result=frames?async_pread(async, req, 0):0;
+    req->state=ASYNC_DONE;
+  }
+  return AMBIX_ERR_SUCCESS;
+}
+
+int64_t ambix_read_reap(ambix_t*ambix, ambix_completion_t*completions, uint32_t count, int wait) {
+  ambix_async_t*async;
+  ambix_fpstate_t fp;
+  int64_t done=0;
+  uint32_t i;
+  if(!ambix)
+    return -AMBIX_ERR_INVALID_HANDLE;
+  async=ambix->async;
+  if(!async || !count)
+    return 0;
+  for(i=0; i<AMBIX_ASYNC_DEPTH; i++) {
+    if(ASYNC_DONE==async->requests[i].state) {
+      wait=0;
+      break;
+    }
+  }
+  async_ring_collect(async, wait);
+
+  _ambix_denormals_protect(&fp);
+  for(i=0; i<AMBIX_ASYNC_DEPTH && done<count; i++) {
+    ambix_asyncrequest_t*req=async->requests+i;
+    if(ASYNC_DONE!=req->state)
+      continue;
+    completions[done].userdata=req->userdata;
+    completions[done].frames=async_finish(ambix, req);
+    req->state=ASYNC_FREE;
+    done++;
+  }
+  _ambix_denormals_restore(&fp);
+  return done;
+}
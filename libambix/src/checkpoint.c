@@ -0,0 +1,68 @@
+/* checkpoint.c -  incremental header updates              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+/* a checkpoint only touches the size fields of the header (which the backend
+ * patches in place), so it is cheap enough to be done every few seconds.
+ * the interval of the automatic checkpoints is counted in sample frames (for a
+ * live recording that is the same as wall-clock time).
+ */
+
+ambix_err_t ambix_checkpoint(ambix_t*ambix) {
+  if(NULL==ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!(ambix->filemode & AMBIX_WRITE))
+    return AMBIX_ERR_INVALID_FILE;
+  ambix->checkpoint_frames=0;
+  /* before the first frame, the header is not final (and not needed) */
+  if(!ambix->startedWriting)
+    return AMBIX_ERR_SUCCESS;
+  return _ambix_checkpoint(ambix);
+}
+
+ambix_err_t ambix_set_checkpoint(ambix_t*ambix, float64_t seconds) {
+  if(NULL==ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!(ambix->filemode & AMBIX_WRITE))
+    return AMBIX_ERR_INVALID_FILE;
+  if(seconds<0.)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  ambix->checkpoint_interval=(int64_t)(seconds*ambix->realinfo.samplerate);
+  if(seconds>0. && ambix->checkpoint_interval<1)
+    ambix->checkpoint_interval=1;
+  ambix->checkpoint_frames=0;
+  return AMBIX_ERR_SUCCESS;
+}
+
+int ambix_is_recovered(ambix_t*ambix) {
+  return (ambix && ambix->recovered);
+}
+
+void _ambix_checkpoint_track(ambix_t*ambix, int64_t frames) {
+  if(frames<1 || ambix->checkpoint_interval<1)
+    return;
+  ambix->checkpoint_frames+=frames;
+  if(ambix->checkpoint_frames>=ambix->checkpoint_interval)
+    ambix_checkpoint(ambix);
+}
@@ -177,7 +177,7 @@ read_uuidchunk(ambix_t*ax) {
     chunkver=_ambix_checkUUID(data);
     switch(chunkver) {
     case(1):
-      if(_ambix_uuid1_to_matrix(data+16, datasize-16, &ax->matrix, ax->byteswap)) {
+      if(_ambix_uuid1_to_matrix(data+16, datasize-16, &ax->matrix, ax->chunkswap)) {
         if(data) free(data) ; data=NULL;
         return AMBIX_ERR_SUCCESS;
       }
@@ -352,6 +352,7 @@ ambix_err_t _ambix_open_read(ambix_t*ambix, const char *path, const ambix_info_t
   }
 
   ambix->byteswap = !_coreaudio_isNativeEndian(PRIVATE(ambix)->xfile);
+  ambix->chunkswap = !_ambix_is_bigendian();
   ambix->channels = ambix->realinfo.extrachannels; /* FIXXXME: realinfo is a bad vehicle */
 
   int caf=_coreaudio_isCAF(&PRIVATE(ambix)->file);
@@ -420,6 +421,7 @@ ambix_err_t _ambix_open_write(ambix_t*ambix, const char *path, const ambix_info_
   
   ambix->is_AMBIX=is_ambix;
   ambix->byteswap = !_coreaudio_isNativeEndian(PRIVATE(ambix)->xfile);
+  ambix->chunkswap = !_ambix_is_bigendian();
   ambix->channels = format.mChannelsPerFrame;
 
   return AMBIX_ERR_SUCCESS;
@@ -435,6 +437,10 @@ ambix_err_t _ambix_open	(ambix_t*ambix, const char *path, const ambix_filemode_t
 
   return AMBIX_ERR_INVALID_FILE;
 }
+ambix_err_t _ambix_open_virtual	(ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  /* LATER: use AudioFileOpenWithCallbacks() */
+  return AMBIX_ERR_INVALID_FILE;
+}
 
 ambix_err_t	_ambix_close	(ambix_t*ambix) {
   if(ambix&&ambix->private_data) {
@@ -499,6 +505,24 @@ int64_t _ambix_readf_float32   (ambix_t*ambix, float32_t*data, int64_t frames) {
 int64_t _ambix_readf_float64   (ambix_t*ambix, float64_t*data, int64_t frames) {
   return coreaudio_readf(ambix, data, frames, AMBIX_SAMPLEFORMAT_FLOAT64, 8);
 }
+int64_t _ambix_readf_raw   (ambix_t*ambix, void*data, int64_t frames, uint32_t framesize) {
+  return -1;
+}
+ambix_err_t _ambix_get_peaks   (ambix_t*ambix, float32_t*peaks) {
+  return AMBIX_ERR_UNKNOWN;
+}
+ambix_err_t _ambix_get_datachunk (ambix_t*ambix, int*fd, int64_t*offset) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+ambix_err_t _ambix_reserve (ambix_t*ambix, int64_t bytes) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+ambix_err_t _ambix_advise (ambix_t*ambix, ambix_advice_t advice, int64_t offset, int64_t bytes) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+ambix_err_t _ambix_checkpoint (ambix_t*ambix) {
+  return AMBIX_ERR_INVALID_FILE;
+}
 
 int64_t coreaudio_writef(ambix_t*ambix, const void*data, int64_t frames, ambix_sampleformat_t sampleformat, UInt32 bytespersample) {
  //printf("info:\n");_ambix_print_info(&ambix->info);
@@ -533,6 +557,9 @@ int64_t _ambix_writef_float32   (ambix_t*ambix, const float32_t*data, int64_t fr
 int64_t _ambix_writef_float64   (ambix_t*ambix, const float64_t*data, int64_t frames) {
   return coreaudio_writef(ambix, data, frames, AMBIX_SAMPLEFORMAT_FLOAT64, 8);
 }
+int64_t _ambix_writef_raw   (ambix_t*ambix, const void*data, int64_t frames, uint32_t framesize) {
+  return -1;
+}
 ambix_err_t _ambix_write_uuidchunk_at(ambix_t*ax, UInt32 index, const void*data, int64_t datasize) {
   OSStatus  err = AudioFileSetUserData (
                                         PRIVATE(ax)->file,
@@ -601,6 +628,9 @@ ambix_err_t _ambix_write_uuidchunk(ambix_t*ax, const void*data, int64_t datasize
   data=NULL;
   return AMBIX_ERR_UNKNOWN;
 }
+ambix_err_t _ambix_append_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize) {
+  return AMBIX_ERR_UNKNOWN;
+}
 
 static int64_t _ambix_tell(ambix_t*ambix) {
   SInt64 pos=0;
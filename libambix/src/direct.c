@@ -0,0 +1,266 @@
+/* direct.c -  unbuffered writing              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* O_DIRECT is a GNU extension */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include "private.h"
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <errno.h>
+
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+
+/* unbuffered files are implemented on top of the virtual I/O:
+ * all I/O goes through a single window of the file, that is only ever
+ * written (and read) as a whole, at sector-aligned offsets.
+ * appending sample frames thus results in large aligned writes; the header
+ * (which libsndfile rewrites when closing) is patched by reading back the
+ * start of the file into the window.
+ */
+
+/* alignment of the window (in memory and in the file) */
+#define AMBIX_DIRECT_ALIGN 4096
+/* size of the window */
+#define AMBIX_DIRECT_BUFSIZE (1<<20)
+
+typedef struct ambix_direct_t {
+  int fd;
+  /** the window (aligned), and the memory it was carved from */
+  unsigned char*buffer;
+  void*memory;
+  /** file offset of the window */
+  int64_t start;
+  /** number of valid bytes in the window */
+  int64_t fill;
+  /** whether the window has to be written back */
+  int dirty;
+  /** size of the file */
+  int64_t size;
+  /** current position */
+  int64_t pos;
+} ambix_direct_t;
+
+/* write the window back to the file (padded to the alignment) */
+static int direct_flush(ambix_direct_t*d) {
+  int64_t size=d->fill, done=0;
+  if(!d->dirty)
+    return 1;
+  size=(size+AMBIX_DIRECT_ALIGN-1)/AMBIX_DIRECT_ALIGN*AMBIX_DIRECT_ALIGN;
+  memset(d->buffer+d->fill, 0, size-d->fill);
+  while(done<size) {
+    ssize_t n=pwrite(d->fd, d->buffer+done, size-done, d->start+done);
+    if(n<0 && EINTR==errno)
+      continue;
+    if(n<=0)
+      return 0;
+    done+=n;
+  }
+  d->dirty=0;
+  return 1;
+}
+/* move the window so it holds position pos */
+static int direct_window(ambix_direct_t*d, int64_t pos) {
+  int64_t start=pos/AMBIX_DIRECT_ALIGN*AMBIX_DIRECT_ALIGN, fill=0;
+  if(pos>=d->start && pos<d->start+AMBIX_DIRECT_BUFSIZE)
+    return 1;
+  if(!direct_flush(d))
+    return 0;
+  /* only existing data needs to be read (never when appending) */
+  if(start<d->size) {
+    fill=d->size-start;
+    if(fill>AMBIX_DIRECT_BUFSIZE)
+      fill=AMBIX_DIRECT_BUFSIZE;
+    if(pread(d->fd, d->buffer, AMBIX_DIRECT_BUFSIZE, start)<fill)
+      return 0;
+  }
+  d->start=start;
+  d->fill=fill;
+  return 1;
+}
+
+static int64_t direct_get_filelen(void*user) {
+  return ((ambix_direct_t*)user)->size;
+}
+static int64_t direct_seek(int64_t offset, int whence, void*user) {
+  ambix_direct_t*d=(ambix_direct_t*)user;
+  switch(whence) {
+  case SEEK_SET: break;
+  case SEEK_CUR: offset+=d->pos; break;
+  case SEEK_END: offset+=d->size; break;
+  default:
+    return -1;
+  }
+  if(offset<0)
+    return -1;
+  d->pos=offset;
+  return d->pos;
+}
+static int64_t direct_read(void*ptr, int64_t count, void*user) {
+  ambix_direct_t*d=(ambix_direct_t*)user;
+  unsigned char*dest=(unsigned char*)ptr;
+  int64_t done=0;
+  if(count>d->size-d->pos)
+    count=d->size-d->pos;
+  while(done<count) {
+    int64_t n=count-done;
+    if(!direct_window(d, d->pos))
+      break;
+    if(n>d->start+d->fill-d->pos)
+      n=d->start+d->fill-d->pos;
+    if(n<=0)
+      break;
+    memcpy(dest+done, d->buffer+(d->pos-d->start), n);
+    d->pos+=n;
+    done+=n;
+  }
+  return done;
+}
+static int64_t direct_write(const void*ptr, int64_t count, void*user) {
+  ambix_direct_t*d=(ambix_direct_t*)user;
+  const unsigned char*src=(const unsigned char*)ptr;
+  int64_t done=0;
+  while(done<count) {
+    int64_t offset, n=count-done;
+    if(!direct_window(d, d->pos))
+      break;
+    offset=d->pos-d->start;
+    if(n>AMBIX_DIRECT_BUFSIZE-offset)
+      n=AMBIX_DIRECT_BUFSIZE-offset;
+    /* seeking beyond the end leaves a gap that reads as zeros */
+    if(offset>d->fill)
+      memset(d->buffer+d->fill, 0, offset-d->fill);
+    memcpy(d->buffer+offset, src+done, n);
+    if(offset+n>d->fill)
+      d->fill=offset+n;
+    d->dirty=1;
+    d->pos+=n;
+    done+=n;
+    if(d->pos>d->size)
+      d->size=d->pos;
+  }
+  return done;
+}
+static int64_t direct_tell(void*user) {
+  return ((ambix_direct_t*)user)->pos;
+}
+
+static const ambix_virtual_io_t direct_vio = {
+  direct_get_filelen,
+  direct_seek,
+  direct_read,
+  direct_write,
+  direct_tell
+};
+
+static void direct_free(ambix_direct_t*d) {
+  if(d->fd>=0)
+    close(d->fd);
+  free(d->memory);
+  free(d);
+}
+
+ambix_t*_ambix_open_direct(const char*path, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+  const int flags=O_RDWR|O_CREAT|O_TRUNC;
+  ambix_direct_t*d;
+  ambix_t*ambix;
+  d=(ambix_direct_t*)calloc(1, sizeof(*d));
+  if(!d)
+    return NULL;
+  d->start=-AMBIX_DIRECT_BUFSIZE;
+  d->fd=-1;
+  d->memory=malloc(AMBIX_DIRECT_BUFSIZE+AMBIX_DIRECT_ALIGN);
+  if(!d->memory) {
+    direct_free(d);
+    return NULL;
+  }
+  d->buffer=(unsigned char*)d->memory+AMBIX_DIRECT_ALIGN-((uintptr_t)d->memory%AMBIX_DIRECT_ALIGN);
+#ifdef O_DIRECT
+  d->fd=open(path, flags|O_DIRECT, 0666);
+  /* not all filesystems support O_DIRECT (e.g. tmpfs) */
+  if(d->fd<0 && EINVAL==errno)
+#endif
+    d->fd=open(path, flags, 0666);
+  if(d->fd<0) {
+    direct_free(d);
+    return NULL;
+  }
+#if !defined O_DIRECT && defined F_NOCACHE
+  fcntl(d->fd, F_NOCACHE, 1);
+#endif
+  ambix=ambix_open_virtual(&direct_vio, mode, ambixinfo, d);
+  if(!ambix) {
+    direct_free(d);
+    return NULL;
+  }
+  ambix->direct=d;
+  return ambix;
+}
+
+ambix_err_t _ambix_direct_close(ambix_t*ambix) {
+  ambix_direct_t*d=ambix->direct;
+  ambix_err_t res=AMBIX_ERR_SUCCESS;
+  if(!d)
+    return AMBIX_ERR_SUCCESS;
+  /* strip the padding of the last block */
+  if(!direct_flush(d) || ftruncate(d->fd, d->size))
+    res=AMBIX_ERR_UNKNOWN;
+  direct_free(d);
+  ambix->direct=NULL;
+  return res;
+}
+
+ambix_err_t _ambix_direct_reserve(ambix_t*ambix, int64_t bytes) {
+  ambix_direct_t*d=ambix->direct;
+  /* the padding of the last block is stripped when closing, and so is the
+   * space not used */
+  return _ambix_preallocate(d->fd, d->size, bytes);
+}
+
+#else /* !(HAVE_UNISTD_H && HAVE_FCNTL_H) */
+
+ambix_t*_ambix_open_direct(const char*path, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+  return ambix_open(path, mode, ambixinfo);
+}
+ambix_err_t _ambix_direct_close(ambix_t*ambix) {
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t _ambix_direct_reserve(ambix_t*ambix, int64_t bytes) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
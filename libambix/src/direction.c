@@ -0,0 +1,358 @@
+/* direction.c -  directional energy index              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#include <math.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+/* the 'dirx' chunk (all big-endian):
+ *   UInt32 version, UInt32 blocksize, UInt64 numblocks
+ * followed by numblocks*{Float32 energy, x, y, z}
+ */
+#define DIRECTION_VERSION 1
+#define DIRECTION_CHUNKHEADER 16
+#define DIRECTION_BLOCKBYTES 16
+
+static uint32_t _ambix_direction_chunkid(void) {
+  uint32_t id;
+  memcpy(&id, "dirx", 4);
+  return id;
+}
+
+void _ambix_direction_deinit(ambix_t*ambix) {
+  if(ambix->direction) {
+    free(ambix->direction->blocks);
+    free(ambix->direction->frame);
+    free(ambix->direction);
+  }
+  ambix->direction=NULL;
+}
+
+ambix_err_t ambix_set_directionindex(ambix_t*ambix, uint32_t blocksize) {
+  ambix_directionindex_t*index;
+  if(!(ambix->filemode & AMBIX_WRITE))
+    return AMBIX_ERR_INVALID_FILE;
+  /* too late, writing started already */
+  if(ambix->startedWriting)
+    return AMBIX_ERR_UNKNOWN;
+  switch(ambix->realinfo.fileformat) {
+  case AMBIX_BASIC:
+    /* (unless an adaptor matrix is set later) the full set is stored as is */
+    if(ambix->realinfo.ambichannels<4)
+      return AMBIX_ERR_INVALID_DIMENSION;
+    break;
+  case AMBIX_EXTENDED:
+    break;
+  default:
+    return AMBIX_ERR_INVALID_FILE;
+  }
+  _ambix_direction_deinit(ambix);
+  if(!blocksize)
+    return AMBIX_ERR_SUCCESS;
+  index=(ambix_directionindex_t*)calloc(1, sizeof(*index));
+  if(!index)
+    return AMBIX_ERR_UNKNOWN;
+  index->frame=(float32_t*)calloc(ambix->realinfo.ambichannels+1, sizeof(float32_t));
+  if(!index->frame) {
+    free(index);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  index->blocksize=blocksize;
+  ambix->direction=index;
+  return AMBIX_ERR_SUCCESS;
+}
+
+/* the rows of the adaptor matrix that yield W/Y/Z/X from the stored channels
+ * (or NULL if they are stored directly) */
+static int _ambix_direction_getrows(ambix_t*ambix, float32_t***rows) {
+  const ambix_matrix_t*matrix=&ambix->matrix;
+  *rows=NULL;
+  if(AMBIX_EXTENDED!=ambix->realinfo.fileformat)
+    return (ambix->realinfo.ambichannels>=4);
+  if(matrix->rows<4 || matrix->cols!=ambix->realinfo.ambichannels)
+    return 0;
+  *rows=matrix->data;
+  return 1;
+}
+
+static void _ambix_direction_finishblock(ambix_directionindex_t*index) {
+  const float64_t n=(float64_t)index->curframes;
+  ambix_direction_t*block;
+  if(index->numblocks>=index->allocblocks) {
+    uint64_t allocblocks=index->allocblocks?(2*index->allocblocks):64;
+    ambix_direction_t*blocks=(ambix_direction_t*)realloc(index->blocks, allocblocks*sizeof(ambix_direction_t));
+    if(!blocks) {
+      /* drop the block rather than failing the write */
+      memset(index->cursum, 0, sizeof(index->cursum));
+      index->curframes=0;
+      return;
+    }
+    index->blocks=blocks;
+    index->allocblocks=allocblocks;
+  }
+  block=index->blocks+index->numblocks++;
+  block->energy      =(float32_t)(index->cursum[0]/n);
+  block->intensity[0]=(float32_t)(index->cursum[3]/n);
+  block->intensity[1]=(float32_t)(index->cursum[1]/n);
+  block->intensity[2]=(float32_t)(index->cursum[2]/n);
+  memset(index->cursum, 0, sizeof(index->cursum));
+  index->curframes=0;
+}
+
+/* accumulate a single frame of the stored ambisonics channels */
+static inline void _ambix_direction_frame(ambix_directionindex_t*index, float32_t**rows, uint32_t ambichannels, const float32_t*frame) {
+  float32_t acn[4];
+  uint32_t i, c;
+  if(rows) {
+    for(i=0; i<4; i++) {
+      float32_t sum=0.;
+      for(c=0; c<ambichannels; c++)
+        sum+=rows[i][c]*frame[c];
+      acn[i]=sum;
+    }
+  } else {
+    for(i=0; i<4; i++)
+      acn[i]=frame[i];
+  }
+  /* ACN#0..3 are W, Y, Z, X */
+  for(i=0; i<4; i++)
+    index->cursum[i]+=(float64_t)acn[0]*acn[i];
+  if(++index->curframes>=index->blocksize)
+    _ambix_direction_finishblock(index);
+}
+
+#define _AMBIX_DIRECTION_TRACK(type, scale)                             \
+  void _ambix_direction_track_##type(ambix_t*ambix, const type##_t*data, int64_t frames) { \
+    ambix_directionindex_t*index=ambix->direction;                      \
+    const uint32_t channels=ambix->channels;                            \
+    const uint32_t ambichannels=ambix->realinfo.ambichannels;           \
+    float32_t**rows;                                                    \
+    int64_t f;                                                          \
+    if(!index || !_ambix_direction_getrows(ambix, &rows))               \
+      return;                                                           \
+    for(f=0; f<frames; f++, data+=channels) {                           \
+      uint32_t c;                                                       \
+      for(c=0; c<ambichannels; c++)                                     \
+        index->frame[c]=(float32_t)(data[c]*(scale));                   \
+      _ambix_direction_frame(index, rows, ambichannels, index->frame);  \
+    }                                                                   \
+  }
+
+_AMBIX_DIRECTION_TRACK(float32, 1.);
+_AMBIX_DIRECTION_TRACK(float64, 1.);
+_AMBIX_DIRECTION_TRACK(int32, 1./2147483648.);
+_AMBIX_DIRECTION_TRACK(int16, 1./32768.);
+
+void _ambix_direction_track_pcm(ambix_t*ambix, const unsigned char*data, uint32_t samplebytes, int bigendian, int64_t frames) {
+  ambix_directionindex_t*index=ambix->direction;
+  const uint32_t framebytes=samplebytes*ambix->channels;
+  const uint32_t ambichannels=ambix->realinfo.ambichannels;
+  const float32_t scale=1./2147483648.;
+  float32_t**rows;
+  int64_t f;
+  if(!index || !_ambix_direction_getrows(ambix, &rows))
+    return;
+  for(f=0; f<frames; f++, data+=framebytes) {
+    const unsigned char*src=data;
+    uint32_t c;
+    for(c=0; c<ambichannels; c++, src+=samplebytes) {
+      uint32_t u;
+      if(2==samplebytes)
+        u=bigendian
+          ?(((uint32_t)src[0]<<24) | ((uint32_t)src[1]<<16))
+          :(((uint32_t)src[1]<<24) | ((uint32_t)src[0]<<16));
+      else
+        u=bigendian
+          ?(((uint32_t)src[0]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[2]<<8))
+          :(((uint32_t)src[2]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[0]<<8));
+      index->frame[c]=scale*(float32_t)(int32_t)u;
+    }
+    _ambix_direction_frame(index, rows, ambichannels, index->frame);
+  }
+}
+
+ambix_err_t _ambix_direction_write(ambix_t*ambix) {
+  ambix_directionindex_t*index=ambix->direction;
+  int64_t datasize;
+  unsigned char*data, *dest;
+  ambix_err_t res;
+  uint64_t b;
+  if(!index)
+    return AMBIX_ERR_SUCCESS;
+  /* the trailing frames make up a (shorter) last block */
+  if(index->curframes>0)
+    _ambix_direction_finishblock(index);
+  if(!index->numblocks)
+    return AMBIX_ERR_SUCCESS;
+
+  datasize=DIRECTION_CHUNKHEADER+index->numblocks*DIRECTION_BLOCKBYTES;
+  data=(unsigned char*)malloc(datasize);
+  if(!data)
+    return AMBIX_ERR_UNKNOWN;
+  dest=data;
+  {
+    const uint32_t header[4]={
+      DIRECTION_VERSION, index->blocksize,
+      (uint32_t)(index->numblocks>>32), (uint32_t)(index->numblocks&0xFFFFFFFF)
+    };
+    uint32_t i;
+    for(i=0; i<4; i++, dest+=4) {
+      dest[0]=(header[i]>>24)&0xFF;
+      dest[1]=(header[i]>>16)&0xFF;
+      dest[2]=(header[i]>> 8)&0xFF;
+      dest[3]=(header[i]    )&0xFF;
+    }
+  }
+  for(b=0; b<index->numblocks; b++) {
+    const ambix_direction_t*block=index->blocks+b;
+    const float32_t values[4]={block->energy, block->intensity[0], block->intensity[1], block->intensity[2]};
+    uint32_t i;
+    for(i=0; i<4; i++, dest+=4) {
+      union {
+        uint32_t i;
+        float32_t f;
+      } value;
+      value.f=values[i];
+      dest[0]=(value.i>>24)&0xFF;
+      dest[1]=(value.i>>16)&0xFF;
+      dest[2]=(value.i>> 8)&0xFF;
+      dest[3]=(value.i    )&0xFF;
+    }
+  }
+  res=_ambix_append_chunk(ambix, _ambix_direction_chunkid(), data, datasize);
+  free(data);
+  return res;
+}
+
+static uint32_t _ambix_direction_get32(const unsigned char*src) {
+  return ((uint32_t)src[0]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[2]<<8) | (uint32_t)src[3];
+}
+
+/* read the directional energy index from the 'dirx' chunk */
+static ambix_err_t _ambix_direction_read(ambix_t*ambix) {
+  int64_t datasize=0;
+  const unsigned char*data=(const unsigned char*)_ambix_read_chunk(ambix, _ambix_direction_chunkid(), 0, &datasize);
+  const unsigned char*src;
+  ambix_directionindex_t*index;
+  uint64_t numblocks, b;
+  if(!data)
+    return AMBIX_ERR_INVALID_FILE;
+  if(datasize<DIRECTION_CHUNKHEADER) {
+    free((void*)data);
+    return AMBIX_ERR_INVALID_FILE;
+  }
+  numblocks=((uint64_t)_ambix_direction_get32(data+8)<<32) | _ambix_direction_get32(data+12);
+  if(DIRECTION_VERSION!=_ambix_direction_get32(data)
+     || !_ambix_direction_get32(data+4)
+     || (uint64_t)(datasize-DIRECTION_CHUNKHEADER)/DIRECTION_BLOCKBYTES < numblocks) {
+    free((void*)data);
+    return AMBIX_ERR_INVALID_FILE;
+  }
+  index=(ambix_directionindex_t*)calloc(1, sizeof(*index));
+  if(index && numblocks)
+    index->blocks=(ambix_direction_t*)malloc(numblocks*sizeof(ambix_direction_t));
+  if(!index || (numblocks && !index->blocks)) {
+    free(index);
+    free((void*)data);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  index->blocksize=_ambix_direction_get32(data+4);
+  index->numblocks=index->allocblocks=numblocks;
+  for(b=0, src=data+DIRECTION_CHUNKHEADER; b<numblocks; b++) {
+    float32_t values[4];
+    uint32_t i;
+    for(i=0; i<4; i++, src+=4) {
+      union {
+        uint32_t i;
+        float32_t f;
+      } value;
+      value.i=_ambix_direction_get32(src);
+      values[i]=value.f;
+    }
+    index->blocks[b].energy=values[0];
+    index->blocks[b].intensity[0]=values[1];
+    index->blocks[b].intensity[1]=values[2];
+    index->blocks[b].intensity[2]=values[3];
+  }
+  free((void*)data);
+  ambix->direction=index;
+  return AMBIX_ERR_SUCCESS;
+}
+
+/* when reading, the index is only parsed when it is first asked for */
+static const ambix_directionindex_t*_ambix_direction_get(ambix_t*ambix) {
+  if(!ambix->direction && !ambix->direction_loaded && (ambix->filemode & AMBIX_READ)) {
+    ambix->direction_loaded=1;
+    _ambix_direction_read(ambix);
+  }
+  return ambix->direction;
+}
+
+uint32_t ambix_get_directionindex_blocksize(ambix_t*ambix) {
+  const ambix_directionindex_t*index=_ambix_direction_get(ambix);
+  return index?index->blocksize:0;
+}
+
+int64_t ambix_get_directionindex(ambix_t*ambix, int64_t offset, ambix_direction_t*blocks, int64_t numblocks) {
+  const ambix_directionindex_t*index=_ambix_direction_get(ambix);
+  if(!index)
+    return -AMBIX_ERR_INVALID_FILE;
+  if(offset<0 || numblocks<0)
+    return -AMBIX_ERR_INVALID_DIMENSION;
+  if((uint64_t)offset>=index->numblocks)
+    return 0;
+  if((uint64_t)(offset+numblocks)>index->numblocks)
+    numblocks=index->numblocks-offset;
+  memcpy(blocks, index->blocks+offset, numblocks*sizeof(*blocks));
+  return numblocks;
+}
+
+int64_t ambix_find_direction(ambix_t*ambix, float32_t azimuth, float32_t elevation, float32_t width, float32_t threshold, int64_t*blocks, int64_t numblocks) {
+  const ambix_directionindex_t*index=_ambix_direction_get(ambix);
+  const float64_t dir[3]={
+    cos(elevation)*cos(azimuth),
+    cos(elevation)*sin(azimuth),
+    sin(elevation)
+  };
+  const float64_t mincos=cos(width);
+  int64_t found=0;
+  uint64_t b;
+  if(!index)
+    return -AMBIX_ERR_INVALID_FILE;
+  for(b=0; b<index->numblocks && found<numblocks; b++) {
+    const float32_t*I=index->blocks[b].intensity;
+    const float64_t magnitude=sqrt((float64_t)I[0]*I[0] + (float64_t)I[1]*I[1] + (float64_t)I[2]*I[2]);
+    if(magnitude<=0. || magnitude<threshold)
+      continue;
+    if((dir[0]*I[0] + dir[1]*I[1] + dir[2]*I[2]) < mincos*magnitude)
+      continue;
+    blocks[found++]=b;
+  }
+  return found;
+}
@@ -0,0 +1,259 @@
+/* dither.c -  quantization of floating point data to integer PCM              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#include <math.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+/* the frames are quantized in blocks, one channel after the other */
+#define DITHER_BLOCKSIZE 256
+
+ambix_err_t _ambix_dither_init(ambix_t*ambix, ambix_dither_t dither) {
+  switch(dither) {
+  case AMBIX_DITHER_NONE:
+  case AMBIX_DITHER_TPDF:
+  case AMBIX_DITHER_SHAPED:
+    break;
+  default:
+    return AMBIX_ERR_UNKNOWN;
+  }
+  if(!ambix->dither_error && ambix->channels>0) {
+    /* noise shaping needs to keep the quantization error of each channel */
+    ambix->dither_error=(float64_t*)calloc(ambix->channels, sizeof(float64_t));
+    ambix->dither_work=(float64_t*)malloc(ambix->channels*DITHER_BLOCKSIZE*sizeof(float64_t));
+    ambix->dither_samples=(int32_t*)malloc(ambix->channels*DITHER_BLOCKSIZE*sizeof(int32_t));
+    if(!ambix->dither_error || !ambix->dither_work || !ambix->dither_samples) {
+      _ambix_dither_deinit(ambix);
+      return AMBIX_ERR_UNKNOWN;
+    }
+  }
+  if(!ambix->dither_seed)
+    ambix->dither_seed=0x1234567;
+  ambix->dither=dither;
+  ambix->use_dither=1;
+  return AMBIX_ERR_SUCCESS;
+}
+void _ambix_dither_deinit(ambix_t*ambix) {
+  free(ambix->dither_error);
+  free(ambix->dither_work);
+  free(ambix->dither_samples);
+  ambix->dither_error=NULL;
+  ambix->dither_work=NULL;
+  ambix->dither_samples=NULL;
+  ambix->use_dither=0;
+}
+
+/* xorshift32: uniformly distributed in [0..1) */
+static inline float64_t _ambix_dither_random(uint32_t*seed) {
+  uint32_t x=*seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *seed=x;
+  return (float64_t)x * (1./4294967296.);
+}
+
+/* round and clip a single (scaled) sample */
+static inline int32_t _ambix_dither_clip(float64_t v, float64_t maxval, uint32_t*clips) {
+  const float64_t minval=-maxval-1.;
+  *clips+=(v>=maxval+0.5) | (v<minval-0.5);
+  v=(v>maxval)?maxval:v;
+  v=(v<minval)?minval:v;
+  return (int32_t)lrint(v);
+}
+
+/* quantize a block of a single channel, one loop for each type of dither */
+static uint32_t _ambix_dither_none(const float64_t*work, int32_t*samples, int64_t n, float64_t maxval,
+                                   uint32_t*seed, float64_t*error) {
+  uint32_t clips=0;
+  int64_t f;
+  for(f=0; f<n; f++)
+    samples[f]=_ambix_dither_clip(work[f], maxval, &clips);
+  return clips;
+}
+static uint32_t _ambix_dither_tpdf(const float64_t*work, int32_t*samples, int64_t n, float64_t maxval,
+                                   uint32_t*seed, float64_t*error) {
+  uint32_t clips=0;
+  int64_t f;
+  for(f=0; f<n; f++) {
+    const float64_t noise=_ambix_dither_random(seed) - _ambix_dither_random(seed);
+    samples[f]=_ambix_dither_clip(work[f]+noise, maxval, &clips);
+  }
+  return clips;
+}
+/* 1st order error feedback: pushes the quantization noise towards nyquist */
+static uint32_t _ambix_dither_shaped(const float64_t*work, int32_t*samples, int64_t n, float64_t maxval,
+                                     uint32_t*seed, float64_t*error) {
+  float64_t err=*error;
+  uint32_t clips=0;
+  int64_t f;
+  for(f=0; f<n; f++) {
+    const float64_t v=work[f]-err;
+    const float64_t noise=_ambix_dither_random(seed) - _ambix_dither_random(seed);
+    const float64_t q=rint(v+noise);
+    samples[f]=_ambix_dither_clip(q, maxval, &clips);
+    /* feed back the rounding error only (not the clipping) */
+    err=q - v;
+  }
+  *error=err;
+  return clips;
+}
+typedef uint32_t(*_ambix_dither_fun_t)(const float64_t*, int32_t*, int64_t, float64_t, uint32_t*, float64_t*);
+
+/* keep track of the peaks of a quantized block of a single channel */
+static void _ambix_dither_peak(ambix_t*ambix, const int32_t*samples, int64_t n, uint32_t channel, float64_t scale, int64_t frame) {
+  int32_t peak=0;
+  int64_t f;
+  for(f=0; f<n; f++) {
+    const int32_t a=(samples[f]<0)?-samples[f]:samples[f];
+    peak=(a>peak)?a:peak;
+  }
+  if((float32_t)(peak/scale) <= ambix->peaks[channel])
+    return;
+  for(f=0; f<n; f++)
+    if(samples[f]==peak || samples[f]==-peak)
+      break;
+  ambix->peaks[channel]=(float32_t)(peak/scale);
+  ambix->peak_positions[channel]=ambix->peak_offset+frame+f;
+}
+
+/* interleave the quantized blocks of all channels into raw PCM */
+static void _ambix_dither_pack(const int32_t*samples, uint32_t channels, int64_t n,
+                               unsigned char*dest, uint32_t samplebytes, int bigendian) {
+  const uint32_t framesize=samplebytes*channels;
+  uint32_t c;
+  int64_t f;
+  for(c=0; c<channels; c++, samples+=DITHER_BLOCKSIZE, dest+=samplebytes) {
+    unsigned char*d=dest;
+    if(2==samplebytes && bigendian == _ambix_is_bigendian()) {
+      for(f=0; f<n; f++, d+=framesize) {
+        const int16_t value=(int16_t)samples[f];
+        memcpy(d, &value, 2);
+      }
+    } else if(2==samplebytes) {
+      for(f=0; f<n; f++, d+=framesize) {
+        const uint16_t value=(uint16_t)samples[f];
+        const uint16_t swapped=(uint16_t)((value<<8) | (value>>8));
+        memcpy(d, &swapped, 2);
+      }
+    } else if(bigendian) {
+      for(f=0; f<n; f++, d+=framesize) {
+        d[0]=(samples[f]>>16)&0xFF;
+        d[1]=(samples[f]>> 8)&0xFF;
+        d[2]=(samples[f]    )&0xFF;
+      }
+    } else {
+      for(f=0; f<n; f++, d+=framesize) {
+        d[0]=(samples[f]    )&0xFF;
+        d[1]=(samples[f]>> 8)&0xFF;
+        d[2]=(samples[f]>>16)&0xFF;
+      }
+    }
+  }
+}
+
+/* the samples are accumulated (matrixed), scaled and dithered in double precision,
+ * so the full resolution of PCM24 is retained */
+#define _AMBIX_MERGEADAPTOR_QUANTIZE(type)                              \
+  ambix_err_t _ambix_mergeAdaptor_quantize_##type(ambix_t*ambix,        \
+                                                  const type##_t*ambidata, const ambix_matrix_t*matrix, uint32_t ambichannels, \
+                                                  const type##_t*otherdata, uint32_t otherchannels, \
+                                                  void*destination, uint32_t samplebytes, int bigendian, \
+                                                  int64_t frames) {     \
+    float32_t**mtx=matrix?matrix->data:NULL;                            \
+    const uint32_t fullambichannels=matrix?matrix->cols:ambichannels;   \
+    const uint32_t ambixchannels=matrix?matrix->rows:ambichannels;      \
+    const uint32_t channels=ambixchannels+otherchannels;                \
+    unsigned char*dest=(unsigned char*)destination;                     \
+    float64_t*work=ambix->dither_work;                                  \
+    int32_t*samples=ambix->dither_samples;                              \
+    _ambix_dither_fun_t ditherfun;                                      \
+    float64_t scale, maxval;                                            \
+    int64_t frame;                                                      \
+    switch(samplebytes) {                                               \
+    case 2: scale=(float64_t)0x8000  ; maxval=(float64_t)0x7FFF  ; break; \
+    case 3: scale=(float64_t)0x800000; maxval=(float64_t)0x7FFFFF; break; \
+    default:                                                            \
+      return AMBIX_ERR_INVALID_FORMAT;                                  \
+    }                                                                   \
+    if(!work || !samples || channels>(uint32_t)ambix->channels)         \
+      return AMBIX_ERR_UNKNOWN;                                         \
+    switch(ambix->dither) {                                             \
+    case AMBIX_DITHER_TPDF  : ditherfun=_ambix_dither_tpdf  ; break;    \
+    case AMBIX_DITHER_SHAPED: ditherfun=_ambix_dither_shaped; break;    \
+    default                 : ditherfun=_ambix_dither_none  ; break;    \
+    }                                                                   \
+    for(frame=0; frame<frames; frame+=DITHER_BLOCKSIZE) {               \
+      const int64_t n=(frames-frame<DITHER_BLOCKSIZE)?(frames-frame):DITHER_BLOCKSIZE; \
+      const type##_t*src=ambidata+fullambichannels*frame;               \
+      const type##_t*other=otherdata+otherchannels*frame;               \
+      uint32_t outchan, inchan;                                         \
+      int64_t f;                                                        \
+      /* matrix: de-interleave into one (scaled) block per channel */   \
+      for(outchan=0; outchan<ambixchannels; outchan++) {                \
+        float64_t*w=work+outchan*DITHER_BLOCKSIZE;                      \
+        if(!mtx) {                                                      \
+          for(f=0; f<n; f++)                                            \
+            w[f]=scale*src[f*fullambichannels+outchan];                 \
+          continue;                                                     \
+        }                                                               \
+        for(f=0; f<n; f++)                                              \
+          w[f]=0.;                                                      \
+        for(inchan=0; inchan<fullambichannels; inchan++) {              \
+          const float64_t coeff=scale*mtx[outchan][inchan];             \
+          const type##_t*s=src+inchan;                                  \
+          if(0.==coeff)                                                 \
+            continue;                                                   \
+          for(f=0; f<n; f++)                                            \
+            w[f]+=coeff*s[f*fullambichannels];                          \
+        }                                                               \
+      }                                                                 \
+      for(inchan=0; inchan<otherchannels; inchan++) {                   \
+        float64_t*w=work+(ambixchannels+inchan)*DITHER_BLOCKSIZE;       \
+        for(f=0; f<n; f++)                                              \
+          w[f]=scale*other[f*otherchannels+inchan];                     \
+      }                                                                 \
+      /* dither & quantize */                                           \
+      for(outchan=0; outchan<channels; outchan++) {                     \
+        ambix->clipcount+=ditherfun(work+outchan*DITHER_BLOCKSIZE, samples+outchan*DITHER_BLOCKSIZE, n, \
+                                    maxval, &ambix->dither_seed, ambix->dither_error+outchan); \
+        if(ambix->peaks)                                                \
+          _ambix_dither_peak(ambix, samples+outchan*DITHER_BLOCKSIZE, n, outchan, scale, frame); \
+      }                                                                 \
+      /* pack */                                                        \
+      _ambix_dither_pack(samples, channels, n, dest, samplebytes, bigendian); \
+      dest+=n*channels*samplebytes;                                     \
+    }                                                                   \
+    if(ambix->peaks)                                                    \
+      ambix->peak_offset+=frames;                                       \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+_AMBIX_MERGEADAPTOR_QUANTIZE(float32);
+_AMBIX_MERGEADAPTOR_QUANTIZE(float64);
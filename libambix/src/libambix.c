@@ -76,7 +76,8 @@ static void _ambix_info_set(ambix_t*ambix
   ambix->ambisonics_order=(fullambichannels>0)?ambix_channels2order(fullambichannels):0;
 }
 
-ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+/* open either a file (path) or virtual I/O (vio) */
+static ambix_t*_ambix_do_open(const char *path, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
   ambix_t*ambix=NULL;
   ambix_err_t err = AMBIX_ERR_UNKNOWN;
   int32_t ambichannels=0, otherchannels=0;
@@ -109,7 +110,11 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
   }
 
   ambix=(ambix_t*)calloc(1, sizeof(ambix_t));
-  if(AMBIX_ERR_SUCCESS == _ambix_open(ambix, path, mode, ambixinfo)) {
+  if(vio)
+    err=_ambix_open_virtual(ambix, vio, userdata, mode, ambixinfo);
+  else
+    err=_ambix_open(ambix, path, mode, ambixinfo);
+  if(AMBIX_ERR_SUCCESS == err) {
     const ambix_fileformat_t wantformat=basic2extended?AMBIX_BASIC:ambixinfo->fileformat;
     ambix_fileformat_t haveformat;
     uint32_t channels = ambix->channels;
@@ -169,6 +174,9 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
     ambix->filemode=mode;
     memcpy(&ambix->info, &ambix->realinfo, sizeof(ambix->info));
 
+    /* fetch the channel peaks (if the file provides them), or prepare tracking them */
+    _ambix_peaks_init(ambix);
+
     if(basic2extended) {
       /* write EXTENDED files as BASIC */
 #if 0
@@ -189,6 +197,7 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
       ambix->use_matrix=0;
     }
 
+    _ambix_update_routing(ambix);
     memcpy(ambixinfo, &ambix->info, sizeof(ambix->info));
 
     if(_ambix_adaptorbuffer_resize(ambix, DEFAULT_ADAPTORBUFFER_SIZE, sizeof(float32_t)) == AMBIX_ERR_SUCCESS)
@@ -199,8 +208,23 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
   return NULL;
 }
 
+ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+  if((mode & AMBIX_DIRECT) && (mode & AMBIX_WRITE) && !(mode & (AMBIX_READ | AMBIX_STREAM)))
+    return _ambix_open_direct(path, (ambix_filemode_t)(mode & ~AMBIX_DIRECT), ambixinfo);
+  return _ambix_do_open(path, NULL, NULL, mode, ambixinfo);
+}
+
+ambix_t*        ambix_open_virtual      (const ambix_virtual_io_t*vio, const ambix_filemode_t mode, ambix_info_t*ambixinfo, void*userdata) {
+  if(!vio || !vio->get_filelen || !vio->seek || !vio->tell)
+    return NULL;
+  if(((AMBIX_READ & mode) && !vio->read) || ((AMBIX_WRITE & mode) && !vio->write))
+    return NULL;
+  return _ambix_do_open(NULL, vio, userdata, mode, ambixinfo);
+}
+
 ambix_err_t     ambix_close     (ambix_t*ambix) {
   ambix_err_t res=AMBIX_ERR_SUCCESS;
+  int overview_ok=1;
   if(NULL==ambix) {
     return AMBIX_ERR_INVALID_HANDLE;
   }
@@ -208,10 +232,26 @@ ambix_err_t     ambix_close     (ambix_t*ambix) {
   if((ambix->filemode & AMBIX_WRITE) && ambix->pendingHeaders) {
     _ambix_write_header(ambix);
   }
+  if(ambix->filemode & AMBIX_WRITE) {
+    _ambix_peaks_write(ambix);
+    overview_ok=(AMBIX_ERR_SUCCESS==_ambix_overview_write(ambix));
+    _ambix_direction_write(ambix);
+  }
 
+  _ambix_async_deinit(ambix);
   res=_ambix_close(ambix);
-
+  if(!overview_ok && AMBIX_ERR_SUCCESS==res)
+    res=AMBIX_ERR_UNKNOWN;
+  _ambix_memory_close(ambix);
+  if(AMBIX_ERR_SUCCESS!=_ambix_direct_close(ambix) && AMBIX_ERR_SUCCESS==res)
+    res=AMBIX_ERR_UNKNOWN;
+
+  _ambix_dither_deinit(ambix);
+  _ambix_peaks_deinit(ambix);
+  _ambix_overview_deinit(ambix);
+  _ambix_direction_deinit(ambix);
   _ambix_adaptorbuffer_destroy(ambix);
+  free(ambix->route);
   ambix_matrix_deinit(&ambix->matrix);
   ambix_matrix_deinit(&ambix->matrix2);
 
@@ -234,6 +274,24 @@ struct SNDFILE_tag*ambix_get_sndfile    (ambix_t*ambix) {
   return NULL;
 }
 
+ambix_err_t ambix_set_dither (ambix_t*ambix, ambix_dither_t dither) {
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!(ambix->filemode & AMBIX_WRITE))
+    return AMBIX_ERR_INVALID_FORMAT;
+  switch(ambix->realinfo.sampleformat) {
+  case AMBIX_SAMPLEFORMAT_PCM16:
+  case AMBIX_SAMPLEFORMAT_PCM24:
+    break;
+  default:
+    return AMBIX_ERR_INVALID_FORMAT;
+  }
+  return _ambix_dither_init(ambix, dither);
+}
+uint64_t ambix_get_clipcount (ambix_t*ambix) {
+  return ambix->clipcount;
+}
+
 uint32_t ambix_get_num_markers (ambix_t*ambix) {
   return ambix->num_markers;
 }
@@ -335,6 +393,8 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
       if(mtx != &ambix->matrix2)
         return AMBIX_ERR_UNKNOWN;
       ambix->use_matrix=2;
+      ambix->plan_dirty=1;
+      _ambix_update_routing(ambix);
       return AMBIX_ERR_SUCCESS;
     } else {
       if(matrix->cols != ambix->realinfo.ambichannels) {
@@ -343,6 +403,8 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
       mtx=ambix_matrix_copy(matrix, &ambix->matrix2);
       if(mtx) {
         ambix->use_matrix=2;
+        ambix->plan_dirty=1;
+        _ambix_update_routing(ambix);
       } else {
         return AMBIX_ERR_UNKNOWN;
       }
@@ -388,6 +450,7 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
       ambix->info.ambichannels=matrix->rows;
       ambix->use_matrix=2;
     }
+    _ambix_update_routing(ambix);
 
     /* ready to write it to file */
     ambix->pendingHeaders=1;
@@ -404,14 +467,14 @@ ambix_err_t     _ambix_write_header     (ambix_t*ambix) {
       _ambix_write_markersregions(ambix); // this need to be done in a more elegant way...!
       ambix_err_t res;
       /* generate UUID-chunk */
-      uint64_t datalen=_ambix_matrix_to_uuid1(&ambix->matrix, NULL, ambix->byteswap);
+      uint64_t datalen=_ambix_matrix_to_uuid1(&ambix->matrix, NULL, ambix->chunkswap);
       uint64_t usedlen=1+datalen/sizeof(float32_t);
 
       if(datalen<1)
         return AMBIX_ERR_UNKNOWN;
 
       data=calloc(usedlen, sizeof(float32_t));
-      if(_ambix_matrix_to_uuid1(&ambix->matrix, data, ambix->byteswap)!=datalen)
+      if(_ambix_matrix_to_uuid1(&ambix->matrix, data, ambix->chunkswap)!=datalen)
         goto cleanup;
 
       /* and write it to file */
@@ -464,48 +527,179 @@ static ambix_err_t _ambix_check_read(ambix_t*ambix, const void*ambidata, const v
 }
 
 
+/* read raw PCM data and apply the adaptor matrix while converting to float
+ * returns FALSE if the fused path is not available (so the caller has to
+ * fall back to reading decoded samples) */
+#define AMBIX_READF_FUSED(type)                                         \
+  static int _ambix_readf_fused_##type(ambix_t*ambix, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, type##_t*ambidata, type##_t*otherdata, int64_t frames, int64_t*realframes) { \
+    const uint32_t channels=ambix->realinfo.ambichannels+ambix->realinfo.extrachannels; \
+    uint32_t samplebytes=0;                                             \
+    int64_t got;                                                        \
+    switch(ambix->realinfo.sampleformat) {                              \
+    case AMBIX_SAMPLEFORMAT_PCM16: samplebytes=2; break;                \
+    case AMBIX_SAMPLEFORMAT_PCM24: samplebytes=3; break;                \
+    default: return 0;                                                  \
+    }                                                                   \
+    if(ambix->channels!=channels || matrix->cols!=ambix->realinfo.ambichannels) \
+      return 0;                                                         \
+    got=_ambix_readf_raw(ambix, ambix->adaptorbuffer, frames, samplebytes*channels); \
+    if(got<0)                                                           \
+      return 0;                                                         \
+    _ambix_splitAdaptormatrix_pcm_mt_##type(ambix->adaptorbuffer, samplebytes, (_ambix_is_bigendian() != !!ambix->byteswap), \
+                                            channels, matrix, plan, ambidata, otherdata, got); \
+    *realframes=got;                                                    \
+    return 1;                                                           \
+  }
+#define AMBIX_READF_NOFUSED(type)                                       \
+  static inline int _ambix_readf_fused_##type(ambix_t*ambix, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, type##_t*ambidata, type##_t*otherdata, int64_t frames, int64_t*realframes) { \
+    return 0;                                                           \
+  }
+AMBIX_READF_FUSED(float32);
+AMBIX_READF_FUSED(float64);
+AMBIX_READF_NOFUSED(int32);
+AMBIX_READF_NOFUSED(int16);
+
 #define AMBIX_READF(type)                                               \
-  int64_t ambix_readf_##type (ambix_t*ambix, type##_t*ambidata, type##_t*otherdata, int64_t frames) { \
+  static int64_t _ambix_do_readf_##type (ambix_t*ambix, type##_t*ambidata, type##_t*otherdata, int64_t frames) { \
     int64_t realframes;                                                 \
     type##_t*adaptorbuffer;                                             \
+    const ambix_matrix_t*matrix=NULL;                                   \
     ambix_err_t err= _ambix_check_read(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
     err=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(type##_t));   \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
     adaptorbuffer=(type##_t*)ambix->adaptorbuffer;                      \
-    realframes=_ambix_readf_##type(ambix, adaptorbuffer, frames);       \
     switch(ambix->use_matrix) {                                         \
-    case 1:                                                             \
-      _ambix_splitAdaptormatrix_##type(adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, &ambix->matrix          , ambidata, otherdata, realframes); \
-      break;                                                            \
-    case 2:                                                             \
-      _ambix_splitAdaptormatrix_##type(adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, &ambix->matrix2         , ambidata, otherdata, realframes); \
-      break;                                                            \
-    default:                                                            \
+    case 1: matrix=&ambix->matrix ; break;                              \
+    case 2: matrix=&ambix->matrix2; break;                              \
+    default: break;                                                     \
+    }                                                                   \
+    if(matrix) {                                                        \
+      const ambix_matrixplan_t*plan=_ambix_get_matrixplan(ambix, matrix); \
+      if(_ambix_readf_fused_##type(ambix, matrix, plan, ambidata, otherdata, frames, &realframes)) \
+        return realframes;                                              \
+      realframes=_ambix_readf_##type(ambix, adaptorbuffer, frames);     \
+      _ambix_splitAdaptormatrix_mt_##type(adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, matrix, plan, ambidata, otherdata, realframes); \
+    } else {                                                            \
+      realframes=_ambix_readf_##type(ambix, adaptorbuffer, frames);     \
       _ambix_splitAdaptor_##type      (adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, ambix->realinfo.ambichannels, ambidata, otherdata, realframes); \
-    };                                                                  \
+    }                                                                   \
     return realframes;                                                  \
+  } \
+  /* protect the processing from denormals */                          \
+  int64_t ambix_readf_##type (ambix_t*ambix, type##_t*ambidata, type##_t*otherdata, int64_t frames) { \
+    ambix_fpstate_t fp;                                                 \
+    int64_t result;                                                     \
+    _ambix_denormals_protect(&fp);                                      \
+    result=_ambix_do_readf_##type(ambix, ambidata, otherdata, frames);  \
+    _ambix_denormals_restore(&fp);                                      \
+    return result;                                                      \
   }
 
+#define AMBIX_READF_CHANNELS(type)                                      \
+  static int64_t _ambix_do_readf_##type##_channels (ambix_t*ambix, const uint32_t*channels, uint32_t numchannels, type##_t*data, int64_t frames) { \
+    int64_t realframes;                                                 \
+    type##_t*adaptorbuffer;                                             \
+    const ambix_matrix_t*matrix=NULL;                                   \
+    uint32_t sourcechannels, maxchannels, i;                            \
+    ambix_err_t err= _ambix_check_read(ambix, (const void*)data, NULL, frames); \
+    if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
+    switch(ambix->use_matrix) {                                         \
+    case 1: matrix=&ambix->matrix ; break;                              \
+    case 2: matrix=&ambix->matrix2; break;                              \
+    default: break;                                                     \
+    }                                                                   \
+    sourcechannels=ambix->realinfo.ambichannels+ambix->realinfo.extrachannels; \
+    maxchannels=(matrix?matrix->rows:ambix->realinfo.ambichannels)+ambix->realinfo.extrachannels; \
+    if(!channels || !numchannels)                                       \
+      return -AMBIX_ERR_INVALID_DIMENSION;                              \
+    for(i=0; i<numchannels; i++)                                        \
+      if(channels[i]>=maxchannels)                                      \
+        return -AMBIX_ERR_INVALID_DIMENSION;                            \
+    err=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(type##_t));   \
+    if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
+    adaptorbuffer=(type##_t*)ambix->adaptorbuffer;                      \
+    realframes=_ambix_readf_##type(ambix, adaptorbuffer, frames);       \
+    _ambix_splitAdaptorchannels_##type(adaptorbuffer, sourcechannels, matrix, channels, numchannels, data, realframes); \
+    return realframes;                                                  \
+  } \
+  int64_t ambix_readf_##type##_channels (ambix_t*ambix, const uint32_t*channels, uint32_t numchannels, type##_t*data, int64_t frames) { \
+    ambix_fpstate_t fp;                                                 \
+    int64_t result;                                                     \
+    _ambix_denormals_protect(&fp);                                      \
+    result=_ambix_do_readf_##type##_channels(ambix, channels, numchannels, data, frames); \
+    _ambix_denormals_restore(&fp);                                      \
+    return result;                                                      \
+  }
+
+/* merge, dither and quantize float data to raw PCM in a single pass
+ * returns FALSE if not possible (so the caller has to fall back to letting
+ * the backend convert the data) */
+#define AMBIX_WRITEF_QUANTIZED(type)                                    \
+  static int _ambix_writef_quantized_##type(ambix_t*ambix, const ambix_matrix_t*matrix, const type##_t*ambidata, const type##_t*otherdata, int64_t frames, int64_t*written) { \
+    uint32_t samplebytes=0;                                             \
+    switch(ambix->realinfo.sampleformat) {                              \
+    case AMBIX_SAMPLEFORMAT_PCM16: samplebytes=2; break;                \
+    case AMBIX_SAMPLEFORMAT_PCM24: samplebytes=3; break;                \
+    default: return 0;                                                  \
+    }                                                                   \
+    if(!ambix->use_dither)                                              \
+      return 0;                                                         \
+    if(AMBIX_ERR_SUCCESS != _ambix_mergeAdaptor_quantize_##type(ambix, ambidata, matrix, ambix->info.ambichannels, \
+                                                                otherdata, ambix->info.extrachannels, \
+                                                                ambix->adaptorbuffer, samplebytes, \
+                                                                (_ambix_is_bigendian() != !!ambix->byteswap), frames)) \
+      return 0;                                                         \
+    _ambix_overview_track_pcm(ambix, (const unsigned char*)ambix->adaptorbuffer, samplebytes, \
+                              (_ambix_is_bigendian() != !!ambix->byteswap), frames); \
+    _ambix_direction_track_pcm(ambix, (const unsigned char*)ambix->adaptorbuffer, samplebytes, \
+                               (_ambix_is_bigendian() != !!ambix->byteswap), frames); \
+    *written=_ambix_writef_raw(ambix, ambix->adaptorbuffer, frames, samplebytes*ambix->channels); \
+    return (*written>=0);                                               \
+  }
+#define AMBIX_WRITEF_NOQUANTIZED(type)                                  \
+  static inline int _ambix_writef_quantized_##type(ambix_t*ambix, const ambix_matrix_t*matrix, const type##_t*ambidata, const type##_t*otherdata, int64_t frames, int64_t*written) { \
+    return 0;                                                           \
+  }
+AMBIX_WRITEF_QUANTIZED(float32);
+AMBIX_WRITEF_QUANTIZED(float64);
+AMBIX_WRITEF_NOQUANTIZED(int32);
+AMBIX_WRITEF_NOQUANTIZED(int16);
+
 #define AMBIX_WRITEF(type)                                              \
-  int64_t ambix_writef_##type (ambix_t*ambix, const type##_t *ambidata, const type##_t*otherdata, int64_t frames) { \
+  static int64_t _ambix_do_writef_##type (ambix_t*ambix, const type##_t *ambidata, const type##_t*otherdata, int64_t frames) { \
     type##_t*adaptorbuffer;                                             \
+    const ambix_matrix_t*matrix=NULL;                                   \
+    int64_t written;                                                    \
     ambix_err_t err= _ambix_check_write(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
     err=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(type##_t));   \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
     adaptorbuffer=(type##_t*)ambix->adaptorbuffer;                      \
     switch(ambix->use_matrix) {                                         \
-    case 1:                                                             \
-      _ambix_mergeAdaptormatrix_##type(ambidata, &ambix->matrix , otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
-      break;                                                            \
-    case 2:                                                             \
-      _ambix_mergeAdaptormatrix_##type(ambidata, &ambix->matrix2, otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
-      break;                                                            \
-    default:                                                            \
+    case 1: matrix=&ambix->matrix ; break;                              \
+    case 2: matrix=&ambix->matrix2; break;                              \
+    default: break;                                                     \
+    }                                                                   \
+    if(_ambix_writef_quantized_##type(ambix, matrix, ambidata, otherdata, frames, &written)) \
+      return written;                                                   \
+    if(matrix)                                                          \
+      _ambix_mergeAdaptormatrix_mt_##type(ambidata, matrix, otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
+    else                                                                \
       _ambix_mergeAdaptor_##type(ambidata, ambix->info.ambichannels, otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
-    };                                                                  \
+    _ambix_peaks_track_##type(ambix, adaptorbuffer, frames);            \
+    _ambix_overview_track_##type(ambix, adaptorbuffer, frames);         \
+    _ambix_direction_track_##type(ambix, adaptorbuffer, frames);        \
     return _ambix_writef_##type(ambix, adaptorbuffer, frames);          \
+  } \
+  int64_t ambix_writef_##type (ambix_t*ambix, const type##_t *ambidata, const type##_t*otherdata, int64_t frames) { \
+    ambix_fpstate_t fp;                                                 \
+    int64_t result;                                                     \
+    _ambix_denormals_protect(&fp);                                      \
+    result=_ambix_do_writef_##type(ambix, ambidata, otherdata, frames); \
+    _ambix_denormals_restore(&fp);                                      \
+    _ambix_checkpoint_track(ambix, result);                             \
+    return result;                                                      \
   }
 
 AMBIX_READF(int16);
@@ -513,7 +707,76 @@ AMBIX_READF(int32);
 AMBIX_READF(float32);
 AMBIX_READF(float64);
 
+AMBIX_READF_CHANNELS(int16);
+AMBIX_READF_CHANNELS(int32);
+AMBIX_READF_CHANNELS(float32);
+AMBIX_READF_CHANNELS(float64);
+
 AMBIX_WRITEF(int16);
 AMBIX_WRITEF(int32);
 AMBIX_WRITEF(float32);
 AMBIX_WRITEF(float64);
+
+int64_t ambix_readf_pcm24_raw (ambix_t*ambix, void*ambidata, void*otherdata, int64_t frames) {
+  const uint32_t channels=ambix->realinfo.ambichannels+ambix->realinfo.extrachannels;
+  const ambix_matrix_t*matrix=NULL;
+  int64_t realframes;
+  ambix_err_t err;
+  if(AMBIX_SAMPLEFORMAT_PCM24 != ambix->realinfo.sampleformat)
+    return -AMBIX_ERR_INVALID_FORMAT;
+  err=_ambix_check_read(ambix, ambidata, otherdata, frames);
+  if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}
+  switch(ambix->use_matrix) {
+  case 1: matrix=&ambix->matrix ; break;
+  case 2: matrix=&ambix->matrix2; break;
+  default: break;
+  }
+  /* only matrices that merely shuffle channels can be applied to raw data */
+  if(matrix && !ambix->route)
+    return -AMBIX_ERR_INVALID_MATRIX;
+  err=_ambix_adaptorbuffer_resize(ambix, frames, 3);
+  if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}
+  realframes=_ambix_readf_raw(ambix, ambix->adaptorbuffer, frames, 3*channels);
+  if(realframes>0) {
+    if(ambix->byteswap)
+      _ambix_swap3array((unsigned char*)ambix->adaptorbuffer, realframes*channels);
+    _ambix_splitAdaptor_pcm24((const unsigned char*)ambix->adaptorbuffer, channels,
+                              ambix->realinfo.ambichannels, ambix->route, matrix?matrix->rows:ambix->realinfo.ambichannels,
+                              (unsigned char*)ambidata, (unsigned char*)otherdata, realframes);
+  }
+  return realframes;
+}
+
+int64_t ambix_writef_pcm24_raw (ambix_t*ambix, const void*ambidata, const void*otherdata, int64_t frames) {
+  const ambix_matrix_t*matrix=NULL;
+  int64_t written;
+  ambix_err_t err;
+  if(AMBIX_SAMPLEFORMAT_PCM24 != ambix->realinfo.sampleformat)
+    return -AMBIX_ERR_INVALID_FORMAT;
+  err=_ambix_check_write(ambix, ambidata, otherdata, frames);
+  if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}
+  switch(ambix->use_matrix) {
+  case 1: matrix=&ambix->matrix ; break;
+  case 2: matrix=&ambix->matrix2; break;
+  default: break;
+  }
+  /* only matrices that merely shuffle channels can be applied to raw data */
+  if(matrix && !ambix->route)
+    return -AMBIX_ERR_INVALID_MATRIX;
+  err=_ambix_adaptorbuffer_resize(ambix, frames, 3);
+  if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}
+  _ambix_mergeAdaptor_pcm24((const unsigned char*)ambidata, matrix?matrix->cols:ambix->info.ambichannels,
+                            ambix->route, matrix?matrix->rows:ambix->info.ambichannels,
+                            (const unsigned char*)otherdata, ambix->info.extrachannels,
+                            (unsigned char*)ambix->adaptorbuffer, frames);
+  _ambix_peaks_track_pcm24(ambix, (const unsigned char*)ambix->adaptorbuffer, frames);
+  _ambix_overview_track_pcm(ambix, (const unsigned char*)ambix->adaptorbuffer, 3, _ambix_is_bigendian(), frames);
+  _ambix_direction_track_pcm(ambix, (const unsigned char*)ambix->adaptorbuffer, 3, _ambix_is_bigendian(), frames);
+  if(ambix->byteswap)
+    _ambix_swap3array((unsigned char*)ambix->adaptorbuffer, frames*ambix->channels);
+  written=_ambix_writef_raw(ambix, ambix->adaptorbuffer, frames, 3*ambix->channels);
+  if(written<0)
+    return AMBIX_ERR_UNKNOWN;
+  _ambix_checkpoint_track(ambix, written);
+  return written;
+}
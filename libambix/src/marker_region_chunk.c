@@ -190,7 +190,7 @@ unsigned char* get_string_from_buffer(strings_buffer* buffer, uint32_t id) {
 }
 
 ambix_err_t _ambix_read_markersregions(ambix_t*ambix) {
-  int byteswap = ambix->byteswap;
+  int byteswap = ambix->chunkswap;
   uint32_t chunk_it = 0;
   uint32_t i;
 
@@ -382,7 +382,7 @@ void add_string_to_data(int id, unsigned char *byte_ptr_stringid, char *name, in
 
 ambix_err_t _ambix_write_markersregions(ambix_t*ambix) {
   uint32_t i;
-  int byteswap = ambix->byteswap;
+  int byteswap = ambix->chunkswap;
 
   void *strings_data = NULL;
   uint32_t num_strings = ambix->num_markers+ambix->num_regions;
@@ -26,6 +26,9 @@
 #ifdef HAVE_STDLIB_H
 # include <stdlib.h>
 #endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
 
 #include <math.h>
 
@@ -121,13 +124,10 @@ _ambix_matrix_fill_data_byteswapped(ambix_matrix_t*mtx, const number32_t*data) {
   uint32_t cols=mtx->cols;
   uint32_t r;
   for(r=0; r<rows; r++) {
-    uint32_t c;
-    for(c=0; c<cols; c++) {
-      number32_t v;
-      number32_t d = *data++;
-      v.i=swap4(d.i);
-      matrix[r][c]=v.f;
-    }
+    /* copy a row as is, and swap it in place */
+    memcpy(matrix[r], data, cols*sizeof(number32_t));
+    _ambix_swap4array((uint32_t*)matrix[r], cols);
+    data+=cols;
   }
   return AMBIX_ERR_SUCCESS;
 }
@@ -184,11 +184,75 @@ ambix_matrix_copy(const ambix_matrix_t*src, ambix_matrix_t*dest) {
 }
 
 
+/* block sizes for the matrix multiplication:
+ * a block of GEMM_ROWS rows of the result is accumulated (in double precision)
+ * while sweeping over the rows of the right-hand matrix in chunks of GEMM_DEPTH,
+ * so the inner loop runs over contiguous memory (and can be vectorized)
+ */
+#define GEMM_ROWS 16
+#define GEMM_DEPTH 128
+/* only use multiple threads if there are at least this many multiply-adds */
+#define GEMM_THREADING_THRESHOLD (1<<20)
+#define GEMM_MAX_THREADS 64
+
+typedef struct _ambix_gemm {
+  float32_t**ldat, **rdat, **ddat;
+  uint32_t common, cols;
+  uint32_t rowstart, rowstop;
+  int err;
+} ambix_gemm_t;
+
+static void _ambix_gemm_rows(ambix_gemm_t*g) {
+  const uint32_t common=g->common, cols=g->cols;
+  float64_t*acc=NULL;
+  uint32_t r0;
+  if(g->rowstart>=g->rowstop || !cols)
+    return;
+  acc=(float64_t*)malloc(GEMM_ROWS*cols*sizeof(float64_t));
+  if(!acc) {
+    g->err=1;
+    return;
+  }
+  for(r0=g->rowstart; r0<g->rowstop; r0+=GEMM_ROWS) {
+    const uint32_t nrows=(g->rowstop-r0 < GEMM_ROWS)?(g->rowstop-r0):GEMM_ROWS;
+    uint32_t r, c, i0;
+    memset(acc, 0, nrows*cols*sizeof(float64_t));
+    for(i0=0; i0<common; i0+=GEMM_DEPTH) {
+      const uint32_t i1=(common-i0 < GEMM_DEPTH)?common:(i0+GEMM_DEPTH);
+      for(r=0; r<nrows; r++) {
+        const float32_t*lrow=g->ldat[r0+r];
+        float64_t*arow=acc+r*cols;
+        uint32_t i;
+        for(i=i0; i<i1; i++) {
+          const float64_t lv=lrow[i];
+          const float32_t*rrow=g->rdat[i];
+          /* adaptor matrices are mostly sparse */
+          if(0.==lv)
+            continue;
+          for(c=0; c<cols; c++)
+            arow[c]+=lv*rrow[c];
+        }
+      }
+    }
+    for(r=0; r<nrows; r++) {
+      float32_t*drow=g->ddat[r0+r];
+      const float64_t*arow=acc+r*cols;
+      for(c=0; c<cols; c++)
+        drow[c]=(float32_t)arow[c];
+    }
+  }
+  free(acc);
+}
+
+static void _ambix_gemm_job(void*userdata, uint32_t index) {
+  _ambix_gemm_rows(((ambix_gemm_t*)userdata)+index);
+}
+
 ambix_matrix_t*
 _ambix_matrix_multiply(const ambix_matrix_t*left, const ambix_matrix_t*right, ambix_matrix_t*dest) {
-  uint32_t r, c, rows, cols, common;
-  float32_t**ldat,**rdat,**ddat;
-  float32_t lv, rv;
+  ambix_matrix_t*orgdest=dest;
+  ambix_gemm_t gemm;
+  uint32_t nthreads=1;
   if(!left || !right)
     return NULL;
 
@@ -201,25 +265,46 @@ _ambix_matrix_multiply(const ambix_matrix_t*left, const ambix_matrix_t*right, am
   if((dest->rows != left->rows) || (dest->cols != right->cols))
     ambix_matrix_init(left->rows, right->cols, dest);
 
-  rows=dest->rows;
-  cols=dest->cols;
-  common=left->cols;
-
-  ldat=left->data;
-  rdat=right->data;
-  ddat=dest->data;
-
-  for(r=0; r<rows; r++)
-    for(c=0; c<cols; c++) {
-      double sum=0.;
-      uint32_t i;
-      for(i=0; i<common; i++) {
-        lv=ldat[r][i];
-        rv=rdat[i][c];
-        sum+=lv*rv;
-      }
-      ddat[r][c]=(float32_t)sum;
+  gemm.ldat=left->data;
+  gemm.rdat=right->data;
+  gemm.ddat=dest->data;
+  gemm.common=left->cols;
+  gemm.cols=dest->cols;
+  gemm.rowstart=0;
+  gemm.rowstop=dest->rows;
+  gemm.err=0;
+
+  if((uint64_t)dest->rows*dest->cols*left->cols >= GEMM_THREADING_THRESHOLD)
+    nthreads=ambix_get_num_threads();
+  /* each thread should get at least one block of rows */
+  if(nthreads > (dest->rows+GEMM_ROWS-1)/GEMM_ROWS)
+    nthreads=(dest->rows+GEMM_ROWS-1)/GEMM_ROWS;
+  if(nthreads > GEMM_MAX_THREADS)
+    nthreads=GEMM_MAX_THREADS;
+  if(nthreads>1) {
+    ambix_gemm_t jobs[GEMM_MAX_THREADS];
+    /* distribute whole blocks of rows among the threads */
+    const uint32_t blocks=(dest->rows+GEMM_ROWS-1)/GEMM_ROWS;
+    uint32_t t, block=0;
+    for(t=0; t<nthreads; t++) {
+      const uint32_t nblocks=blocks/nthreads + (t < blocks%nthreads);
+      jobs[t]=gemm;
+      jobs[t].rowstart=block*GEMM_ROWS;
+      block+=nblocks;
+      jobs[t].rowstop=(block*GEMM_ROWS < dest->rows)?(block*GEMM_ROWS):dest->rows;
     }
+    _ambix_parallel_for(_ambix_gemm_job, jobs, nthreads);
+    for(t=0; t<nthreads; t++)
+      gemm.err|=jobs[t].err;
+  }
+  if(nthreads<=1)
+    _ambix_gemm_rows(&gemm);
+
+  if(gemm.err) {
+    if(dest!=orgdest)
+      ambix_matrix_destroy(dest);
+    return NULL;
+  }
 
   return dest;
 }
@@ -342,7 +427,19 @@ _ambix_matrix_pinv(const ambix_matrix_t*A, ambix_matrix_t*P) {
   const float32_t eps=1e-7;
   ambix_matrix_t *result = NULL;
 
-  /* try cholesky inversion */
+  /* the same adaptor matrix is typically used by many files */
+  result=_ambix_matrix_pinv_cache_lookup(A, P);
+  if(result)
+    return result;
+
+  /* SVD in double precision */
+  result=_ambix_matrix_pinvert_svd(A, P, 0.);
+  if(result) {
+    _ambix_matrix_pinv_cache_store(A, result);
+    return result;
+  }
+
+  /* if that fails (out of memory), try the cheaper cholesky inversion */
   result=_ambix_matrix_pinvert_cholesky(A, P, eps);
   if(result)
     return result;
@@ -387,59 +484,162 @@ _ambix_matrix_pinv(const ambix_matrix_t*A, ambix_matrix_t*P) {
   return result;
 }
 
-#define MTXMULTIPLY_DATA_FLOAT(typ)                                     \
-  ambix_err_t ambix_matrix_multiply_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
-    float32_t**mtx=matrix->data;                                        \
-    const uint32_t outchannels=matrix->rows;                            \
-    const uint32_t inchannels=matrix->cols;                             \
+/* the largest number of output channels whose accumulators are kept on the stack */
+#define MTXMULTIPLY_MAXLOCAL 64
+/* the largest (transposed) matrix plus accumulators that is kept on the stack (8kB) */
+#define MTXMULTIPLY_MAXCOEFFS 1024
+/* number of frames processed at once by the planar kernel */
+#define MTXMULTIPLY_BLOCKSIZE 256
+
+/* interleaved: for each frame, the input samples are scaled with the columns
+ * of the (transposed) matrix and accumulated, so the inner loop runs over
+ * contiguous memory */
+#define MTXMULTIPLY_DATA_INTERLEAVED(typ)                               \
+  AMBIX_ALWAYS_INLINE ambix_err_t _ambix_matrix_multiply_kernel_##typ##_interleaved(typ##_t*dest, const float64_t*coeffs, \
+                                                                                  const uint32_t outchannels, const uint32_t inchannels, \
+                                                                                  const typ##_t*source, int64_t frames, \
+                                                                                  float64_t*scratch) { \
+    /* for (small) constant outchannels, the accumulators can live in registers */ \
+    float64_t local[MTXMULTIPLY_MAXLOCAL];                              \
+    float64_t*acc=(outchannels<=MTXMULTIPLY_MAXLOCAL)?local:scratch;    \
     int64_t frame;                                                      \
-    typ##_t*dst=dest;                                                   \
-    const typ##_t*src=source;                                           \
     for(frame=0; frame<frames; frame++) {                               \
-      uint32_t outchan;                                                 \
-      for(outchan=0; outchan<outchannels; outchan++) {                  \
-        double sum=0.;                                                  \
-        uint32_t inchan;                                                \
-        for(inchan=0; inchan<inchannels; inchan++) {                    \
-          double scale=mtx[outchan][inchan];                            \
-          double in=src[frame*inchannels+inchan];                       \
-          sum+=scale*in;                                                \
-        }                                                               \
-        dst[frame*outchannels+outchan]=(typ##_t)sum;                    \
+      const typ##_t*src=source+frame*inchannels;                        \
+      typ##_t*dst=dest+frame*outchannels;                               \
+      uint32_t inchan, outchan;                                         \
+      for(outchan=0; outchan<outchannels; outchan++)                    \
+        acc[outchan]=0.;                                                \
+      for(inchan=0; inchan<inchannels; inchan++) {                      \
+        const float64_t in=src[inchan];                                 \
+        const float64_t*c=coeffs+inchan*outchannels;                    \
+        for(outchan=0; outchan<outchannels; outchan++)                  \
+          acc[outchan]+=c[outchan]*in;                                  \
       }                                                                 \
+      for(outchan=0; outchan<outchannels; outchan++)                    \
+        dst[outchan]=_ambix_mtxmul_convert_##typ(acc[outchan]);         \
     }                                                                   \
     return AMBIX_ERR_SUCCESS;                                           \
   }                                                                     \
+  static ambix_err_t _ambix_matrix_multiply_dispatch_##typ##_interleaved(typ##_t*dest, const float64_t*coeffs, \
+                                                                          uint32_t outchannels, uint32_t inchannels, \
+                                                                          const typ##_t*source, int64_t frames, \
+                                                                          float64_t*scratch) { \
+    AMBIX_DISPATCH_CHANNELS2(outchannels, inchannels, O, I,             \
+                             _ambix_matrix_multiply_kernel_##typ##_interleaved(dest, coeffs, O, I, source, frames, scratch)); \
+  }                                                                     \
+  ambix_err_t ambix_matrix_multiply_##typ##_interleaved(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
+    const uint32_t outchannels=matrix->rows;                            \
+    const uint32_t inchannels=matrix->cols;                             \
+    float64_t stackcoeffs[MTXMULTIPLY_MAXCOEFFS];                       \
+    float64_t*coeffs=stackcoeffs;                                       \
+    uint32_t inchan, outchan;                                           \
+    ambix_fpstate_t fp;                                                 \
+    ambix_err_t err;                                                    \
+    if(!outchannels || !inchannels || frames<=0)                        \
+      return AMBIX_ERR_SUCCESS;                                         \
+    /* the transposed matrix, followed by the accumulators;             \
+     * only very large matrices need to go to the heap */               \
+    if((uint64_t)outchannels*inchannels+outchannels > MTXMULTIPLY_MAXCOEFFS) \
+      coeffs=(float64_t*)malloc((outchannels*inchannels+outchannels)*sizeof(float64_t)); \
+    if(!coeffs)                                                         \
+      return AMBIX_ERR_UNKNOWN;                                         \
+    for(inchan=0; inchan<inchannels; inchan++)                          \
+      for(outchan=0; outchan<outchannels; outchan++)                    \
+        coeffs[inchan*outchannels+outchan]=matrix->data[outchan][inchan]; \
+    _ambix_denormals_protect(&fp);                                      \
+    err=_ambix_matrix_multiply_dispatch_##typ##_interleaved(dest, coeffs, outchannels, inchannels, source, frames, \
+                                                           coeffs+outchannels*inchannels); \
+    _ambix_denormals_restore(&fp);                                      \
+    if(coeffs!=stackcoeffs)                                             \
+      free(coeffs);                                                     \
+    return err;                                                         \
+  }
 
-MTXMULTIPLY_DATA_FLOAT(float32);
-MTXMULTIPLY_DATA_FLOAT(float64);
-
-#define MTXMULTIPLY_DATA_INT(typ)                                       \
-  ambix_err_t ambix_matrix_multiply_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
-    float32_t**mtx=matrix->data; \
+/* planar: each channel is a contiguous block of frames, so we can process
+ * blocks of frames for each output channel */
+#define MTXMULTIPLY_DATA_PLANAR(typ)                                    \
+  ambix_err_t ambix_matrix_multiply_##typ##_planar(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
     const uint32_t outchannels=matrix->rows;                            \
     const uint32_t inchannels=matrix->cols;                             \
-    int64_t frame;                                                      \
-    for(frame=0; frame<frames; frame++) {                               \
+    float64_t acc[MTXMULTIPLY_BLOCKSIZE];                               \
+    ambix_fpstate_t fp;                                                 \
+    int64_t frame0;                                                     \
+    _ambix_denormals_protect(&fp);                                      \
+    for(frame0=0; frame0<frames; frame0+=MTXMULTIPLY_BLOCKSIZE) {       \
+      const int64_t blocksize=(frames-frame0<MTXMULTIPLY_BLOCKSIZE)?(frames-frame0):MTXMULTIPLY_BLOCKSIZE; \
       uint32_t outchan;                                                 \
-      typ##_t*dst=dest+frame;                                           \
-      const typ##_t*src=source+frame;                                   \
       for(outchan=0; outchan<outchannels; outchan++) {                  \
-        double sum=0.;                                                  \
+        const float32_t*row=matrix->data[outchan];                      \
+        typ##_t*dst=dest+outchan*frames+frame0;                         \
         uint32_t inchan;                                                \
+        int64_t f;                                                      \
+        for(f=0; f<blocksize; f++)                                      \
+          acc[f]=0.;                                                    \
         for(inchan=0; inchan<inchannels; inchan++) {                    \
-          double scale=mtx[outchan][inchan];                            \
-          double in=src[inchan*frames];                                 \
-          sum+=scale * in;                                              \
+          const float64_t scale=row[inchan];                            \
+          const typ##_t*src=source+inchan*frames+frame0;                \
+          if(0.==scale)                                                 \
+            continue;                                                   \
+          for(f=0; f<blocksize; f++)                                    \
+            acc[f]+=scale*src[f];                                       \
         }                                                               \
-        dst[frames*outchan]=(typ##_t)(sum);  /* FIXXXME: saturation */  \
+        for(f=0; f<blocksize; f++)                                      \
+          dst[f]=_ambix_mtxmul_convert_##typ(acc[f]);                   \
       }                                                                 \
     }                                                                   \
+    _ambix_denormals_restore(&fp);                                      \
     return AMBIX_ERR_SUCCESS;                                           \
   }
 
-MTXMULTIPLY_DATA_INT(int16);
-MTXMULTIPLY_DATA_INT(int32);
+MTXMULTIPLY_DATA_INTERLEAVED(float32);
+MTXMULTIPLY_DATA_INTERLEAVED(float64);
+MTXMULTIPLY_DATA_INTERLEAVED(int32);
+MTXMULTIPLY_DATA_INTERLEAVED(int16);
+
+MTXMULTIPLY_DATA_PLANAR(float32);
+MTXMULTIPLY_DATA_PLANAR(float64);
+MTXMULTIPLY_DATA_PLANAR(int32);
+MTXMULTIPLY_DATA_PLANAR(int16);
+
+/* for historical reasons, the float variants use interleaved data
+ * whereas the integer variants use planar data */
+ambix_err_t ambix_matrix_multiply_float32(float32_t*dest, const ambix_matrix_t*matrix, const float32_t*source, int64_t frames) {
+  return ambix_matrix_multiply_float32_interleaved(dest, matrix, source, frames);
+}
+ambix_err_t ambix_matrix_multiply_float64(float64_t*dest, const ambix_matrix_t*matrix, const float64_t*source, int64_t frames) {
+  return ambix_matrix_multiply_float64_interleaved(dest, matrix, source, frames);
+}
+ambix_err_t ambix_matrix_multiply_int32(int32_t*dest, const ambix_matrix_t*matrix, const int32_t*source, int64_t frames) {
+  return ambix_matrix_multiply_int32_planar(dest, matrix, source, frames);
+}
+ambix_err_t ambix_matrix_multiply_int16(int16_t*dest, const ambix_matrix_t*matrix, const int16_t*source, int64_t frames) {
+  return ambix_matrix_multiply_int16_planar(dest, matrix, source, frames);
+}
+
+typedef struct _ambix_mtxmul_job {
+  float32_t*dest;
+  const ambix_matrix_t*matrix;
+  const float32_t*source;
+  ambix_err_t err;
+} ambix_mtxmul_job_t;
+static void _ambix_mtxmul_job(void*userdata, int64_t offset, int64_t frames) {
+  ambix_mtxmul_job_t*job=(ambix_mtxmul_job_t*)userdata;
+  ambix_err_t err=ambix_matrix_multiply_float32(job->dest+offset*job->matrix->rows, job->matrix, job->source+offset*job->matrix->cols, frames);
+  if(AMBIX_ERR_SUCCESS!=err)job->err=err;
+}
+ambix_err_t ambix_matrix_multiply_float32_mt(float32_t*dest, const ambix_matrix_t*matrix, const float32_t*source, int64_t frames) {
+  ambix_mtxmul_job_t job;
+  if(!dest || !matrix || !source)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(frames<0)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  job.dest=dest;
+  job.matrix=matrix;
+  job.source=source;
+  job.err=AMBIX_ERR_SUCCESS;
+  _ambix_parallel_frames(_ambix_mtxmul_job, &job, frames, (uint64_t)matrix->rows*matrix->cols);
+  return job.err;
+}
 
 
 
@@ -28,6 +28,13 @@
 #endif /* HAVE_STDLIB_H */
 
 #include <math.h>
+#include <float.h>
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#ifdef HAVE_PTHREADS
+# include <pthread.h>
+#endif /* HAVE_PTHREADS */
 
 /**
  * simple matrix inversion of square matrices, using Gauss-Jordan
@@ -256,3 +263,208 @@ _ambix_matrix_pinvert_cholesky(const ambix_matrix_t*input, ambix_matrix_t*invers
 
   return result;
 }
+
+/*
+ * calculate the pseudo-inverse of any (rectangular) real-valued matrix
+ * using a one-sided Jacobi (Hestenes) SVD in double precision.
+ * this is slower than the Cholesky variant, but it does not need to square
+ * the condition number (by building x'*x) and it handles rank-deficient
+ * matrices gracefully.
+ */
+ambix_matrix_t*
+_ambix_matrix_pinvert_svd(const ambix_matrix_t*input, ambix_matrix_t*inverse, float64_t tolerance) {
+  /* we decompose A (or A' if A is wide), so that m>=n */
+  const int transposed=(input->rows < input->cols);
+  const uint32_t m=transposed?input->cols:input->rows;
+  const uint32_t n=transposed?input->rows:input->cols;
+  float64_t*U=NULL, *V=NULL, *S=NULL;
+  float64_t smax=0., thresh;
+  uint32_t i, j, k;
+  int sweep;
+
+  if(!m || !n)
+    return NULL;
+
+  /* U is stored column-major (each column is contiguous), V is n*n */
+  U=(float64_t*)malloc(m*n*sizeof(float64_t));
+  V=(float64_t*)calloc(n*n, sizeof(float64_t));
+  S=(float64_t*)calloc(n, sizeof(float64_t));
+  if(!U || !V || !S) {
+    free(U); free(V); free(S);
+    return NULL;
+  }
+  for(j=0; j<n; j++) {
+    for(i=0; i<m; i++)
+      U[j*m+i]=transposed?input->data[j][i]:input->data[i][j];
+    V[j*n+j]=1.;
+  }
+
+  /* orthogonalize pairs of columns until all are mutually orthogonal */
+  for(sweep=0; sweep<64; sweep++) {
+    int rotated=0;
+    for(j=0; j+1<n; j++) {
+      float64_t*uj=U+j*m, *vj=V+j*n;
+      for(k=j+1; k<n; k++) {
+        float64_t*uk=U+k*m, *vk=V+k*n;
+        float64_t alpha=0., beta=0., gamma=0.;
+        float64_t zeta, t, c, s;
+        for(i=0; i<m; i++) {
+          alpha+=uj[i]*uj[i];
+          beta +=uk[i]*uk[i];
+          gamma+=uj[i]*uk[i];
+        }
+        if(fabs(gamma) <= DBL_EPSILON*sqrt(alpha*beta))
+          continue;
+        rotated=1;
+        zeta=(beta-alpha)/(2.*gamma);
+        t=((zeta<0.)?-1.:1.)/(fabs(zeta)+sqrt(1.+zeta*zeta));
+        c=1./sqrt(1.+t*t);
+        s=c*t;
+        for(i=0; i<m; i++) {
+          const float64_t a=uj[i], b=uk[i];
+          uj[i]=c*a - s*b;
+          uk[i]=s*a + c*b;
+        }
+        for(i=0; i<n; i++) {
+          const float64_t a=vj[i], b=vk[i];
+          vj[i]=c*a - s*b;
+          vk[i]=s*a + c*b;
+        }
+      }
+    }
+    if(!rotated)
+      break;
+  }
+
+  /* the singular values are the norms of the columns of U */
+  for(j=0; j<n; j++) {
+    float64_t sum=0.;
+    for(i=0; i<m; i++)
+      sum+=U[j*m+i]*U[j*m+i];
+    S[j]=sqrt(sum);
+    if(S[j]>smax)
+      smax=S[j];
+  }
+  /* discard singular values below the threshold (same default as MATLAB's pinv) */
+  thresh=smax*((tolerance>0.)?tolerance:(m*DBL_EPSILON));
+  for(j=0; j<n; j++)
+    S[j]=(S[j]>thresh)?(1./(S[j]*S[j])):0.;
+
+  /* pinv(B) = V*diag(1/s^2)*U' (with U not normalized), which is n*m;
+   * if we decomposed B=A', pinv(A)=pinv(B)', which is m*n */
+  inverse=transposed?ambix_matrix_init(m, n, inverse):ambix_matrix_init(n, m, inverse);
+  if(inverse) {
+    for(k=0; k<n; k++) {
+      for(i=0; i<m; i++) {
+        float64_t sum=0.;
+        for(j=0; j<n; j++)
+          sum+=V[j*n+k]*S[j]*U[j*m+i];
+        if(transposed)
+          inverse->data[i][k]=(float32_t)sum;
+        else
+          inverse->data[k][i]=(float32_t)sum;
+      }
+    }
+  }
+
+  free(U);
+  free(V);
+  free(S);
+  return inverse;
+}
+
+/*
+ * process-wide cache of pseudo-inverses
+ * many files share the same adaptor matrix, so we keep the last few
+ * (matrix, pinv) pairs around, keyed by a hash of the matrix contents.
+ */
+#define AMBIX_PINV_CACHE_SIZE 8
+typedef struct _ambix_pinv_cache_entry {
+  uint32_t hash;
+  ambix_matrix_t*matrix;
+  ambix_matrix_t*pinv;
+} ambix_pinv_cache_entry_t;
+static ambix_pinv_cache_entry_t s_pinv_cache[AMBIX_PINV_CACHE_SIZE];
+static uint32_t s_pinv_cache_next=0;
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t s_pinv_cache_mutex=PTHREAD_MUTEX_INITIALIZER;
+# define PINV_CACHE_LOCK() pthread_mutex_lock(&s_pinv_cache_mutex)
+# define PINV_CACHE_UNLOCK() pthread_mutex_unlock(&s_pinv_cache_mutex)
+#else
+# define PINV_CACHE_LOCK()
+# define PINV_CACHE_UNLOCK()
+#endif
+
+/* FNV-1a over the dimensions and the bit-patterns of the matrix data */
+static uint32_t _ambix_matrix_hash(const ambix_matrix_t*mtx) {
+  uint32_t hash=2166136261u;
+  uint32_t r;
+  const unsigned char*bytes;
+  size_t i;
+#define HASHBYTES(ptr, size) \
+  for(bytes=(const unsigned char*)(ptr), i=0; i<(size); i++) hash=(hash^bytes[i])*16777619u
+  HASHBYTES(&mtx->rows, sizeof(mtx->rows));
+  HASHBYTES(&mtx->cols, sizeof(mtx->cols));
+  for(r=0; r<mtx->rows; r++)
+    HASHBYTES(mtx->data[r], mtx->cols*sizeof(float32_t));
+#undef HASHBYTES
+  return hash;
+}
+static int _ambix_matrix_equal(const ambix_matrix_t*A, const ambix_matrix_t*B) {
+  uint32_t r;
+  if(A->rows != B->rows || A->cols != B->cols)
+    return 0;
+  for(r=0; r<A->rows; r++)
+    if(memcmp(A->data[r], B->data[r], A->cols*sizeof(float32_t)))
+      return 0;
+  return 1;
+}
+
+ambix_matrix_t*
+_ambix_matrix_pinv_cache_lookup(const ambix_matrix_t*matrix, ambix_matrix_t*pinv) {
+  const uint32_t hash=_ambix_matrix_hash(matrix);
+  ambix_matrix_t*result=NULL;
+  uint32_t i;
+  PINV_CACHE_LOCK();
+  for(i=0; i<AMBIX_PINV_CACHE_SIZE; i++) {
+    const ambix_pinv_cache_entry_t*entry=s_pinv_cache+i;
+    if(entry->matrix && entry->hash==hash && _ambix_matrix_equal(entry->matrix, matrix)) {
+      result=ambix_matrix_copy(entry->pinv, pinv);
+      break;
+    }
+  }
+  PINV_CACHE_UNLOCK();
+  return result;
+}
+void
+_ambix_matrix_pinv_cache_store(const ambix_matrix_t*matrix, const ambix_matrix_t*pinv) {
+  ambix_matrix_t*mtx=ambix_matrix_copy(matrix, NULL);
+  ambix_matrix_t*inv=ambix_matrix_copy(pinv, NULL);
+  ambix_pinv_cache_entry_t*entry;
+  if(!mtx || !inv) {
+    if(mtx)ambix_matrix_destroy(mtx);
+    if(inv)ambix_matrix_destroy(inv);
+    return;
+  }
+  PINV_CACHE_LOCK();
+  /* round-robin replacement */
+  entry=s_pinv_cache+s_pinv_cache_next;
+  s_pinv_cache_next=(s_pinv_cache_next+1)%AMBIX_PINV_CACHE_SIZE;
+  if(entry->matrix)ambix_matrix_destroy(entry->matrix);
+  if(entry->pinv)ambix_matrix_destroy(entry->pinv);
+  entry->hash=_ambix_matrix_hash(mtx);
+  entry->matrix=mtx;
+  entry->pinv=inv;
+  PINV_CACHE_UNLOCK();
+}
+#ifdef __GNUC__
+/* free the cache when the library is unloaded (keeps valgrind quiet) */
+static void __attribute__((destructor)) _ambix_matrix_pinv_cache_free(void) {
+  uint32_t i;
+  for(i=0; i<AMBIX_PINV_CACHE_SIZE; i++) {
+    if(s_pinv_cache[i].matrix)ambix_matrix_destroy(s_pinv_cache[i].matrix);
+    if(s_pinv_cache[i].pinv)ambix_matrix_destroy(s_pinv_cache[i].pinv);
+    s_pinv_cache[i].matrix=s_pinv_cache[i].pinv=NULL;
+  }
+}
+#endif
@@ -0,0 +1,175 @@
+/* memory.c -  in-memory ambix files              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+/* in-memory files are implemented on top of the virtual I/O */
+typedef struct ambix_memory_t {
+  /** the file content when reading */
+  const unsigned char*rdata;
+  /** the file content when writing (grows as needed) */
+  unsigned char*wdata;
+  /** size of the file */
+  int64_t size;
+  /** allocated size of wdata */
+  int64_t allocated;
+  /** current position */
+  int64_t pos;
+  /** where to put the file content when closing (when writing) */
+  void**userbuffer;
+  size_t*usersize;
+} ambix_memory_t;
+
+static int64_t memory_get_filelen(void*user) {
+  return ((ambix_memory_t*)user)->size;
+}
+static int64_t memory_seek(int64_t offset, int whence, void*user) {
+  ambix_memory_t*mem=(ambix_memory_t*)user;
+  switch(whence) {
+  case SEEK_SET: break;
+  case SEEK_CUR: offset+=mem->pos; break;
+  case SEEK_END: offset+=mem->size; break;
+  default:
+    return -1;
+  }
+  if(offset<0)
+    return -1;
+  mem->pos=offset;
+  return mem->pos;
+}
+static int64_t memory_read(void*ptr, int64_t count, void*user) {
+  ambix_memory_t*mem=(ambix_memory_t*)user;
+  const unsigned char*data=mem->rdata?mem->rdata:mem->wdata;
+  if(count<=0 || mem->pos>=mem->size)
+    return 0;
+  if(count>mem->size-mem->pos)
+    count=mem->size-mem->pos;
+  memcpy(ptr, data+mem->pos, count);
+  mem->pos+=count;
+  return count;
+}
+static int64_t memory_write(const void*ptr, int64_t count, void*user) {
+  ambix_memory_t*mem=(ambix_memory_t*)user;
+  if(count<=0 || mem->rdata)
+    return 0;
+  if(mem->pos+count>mem->allocated) {
+    /* grow exponentially, to keep the number of reallocations low */
+    int64_t allocated=mem->allocated?mem->allocated:65536;
+    unsigned char*data;
+    while(allocated<mem->pos+count)
+      allocated*=2;
+    data=(unsigned char*)realloc(mem->wdata, allocated);
+    if(!data)
+      return 0;
+    mem->wdata=data;
+    mem->allocated=allocated;
+  }
+  /* seeking beyond the end leaves a gap that reads as zeros */
+  if(mem->pos>mem->size)
+    memset(mem->wdata+mem->size, 0, mem->pos-mem->size);
+  memcpy(mem->wdata+mem->pos, ptr, count);
+  mem->pos+=count;
+  if(mem->pos>mem->size)
+    mem->size=mem->pos;
+  return count;
+}
+static int64_t memory_tell(void*user) {
+  return ((ambix_memory_t*)user)->pos;
+}
+
+static const ambix_virtual_io_t memory_vio = {
+  memory_get_filelen,
+  memory_seek,
+  memory_read,
+  memory_write,
+  memory_tell
+};
+
+ambix_t*ambix_open_memory(const void*buffer, size_t size, ambix_info_t*ambixinfo) {
+  ambix_memory_t*mem;
+  ambix_t*ambix;
+  if(!buffer)
+    return NULL;
+  mem=(ambix_memory_t*)calloc(1, sizeof(*mem));
+  if(!mem)
+    return NULL;
+  mem->rdata=(const unsigned char*)buffer;
+  mem->size=(int64_t)size;
+  ambix=ambix_open_virtual(&memory_vio, AMBIX_READ, ambixinfo, mem);
+  if(!ambix) {
+    free(mem);
+    return NULL;
+  }
+  ambix->memory=mem;
+  return ambix;
+}
+
+ambix_t*ambix_open_memory_write(void**buffer, size_t*size, ambix_info_t*ambixinfo) {
+  ambix_memory_t*mem;
+  ambix_t*ambix;
+  if(!buffer || !size)
+    return NULL;
+  *buffer=NULL;
+  *size=0;
+  mem=(ambix_memory_t*)calloc(1, sizeof(*mem));
+  if(!mem)
+    return NULL;
+  mem->userbuffer=buffer;
+  mem->usersize=size;
+  ambix=ambix_open_virtual(&memory_vio, AMBIX_WRITE, ambixinfo, mem);
+  if(!ambix) {
+    free(mem->wdata);
+    free(mem);
+    return NULL;
+  }
+  ambix->memory=mem;
+  return ambix;
+}
+
+void _ambix_memory_close(ambix_t*ambix) {
+  ambix_memory_t*mem=ambix->memory;
+  if(!mem)
+    return;
+  if(mem->userbuffer) {
+    /* hand the file over to the user (without any slack) */
+    unsigned char*data=mem->wdata;
+    if(data && mem->size>0 && mem->size<mem->allocated) {
+      data=(unsigned char*)realloc(mem->wdata, mem->size);
+      if(!data)
+        data=mem->wdata;
+    }
+    *mem->userbuffer=data;
+    *mem->usersize=(size_t)mem->size;
+  } else
+    free(mem->wdata);
+  free(mem);
+  ambix->memory=NULL;
+}
@@ -26,6 +26,10 @@ ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t
   return AMBIX_ERR_INVALID_FILE;
 }
 
+ambix_err_t _ambix_open_virtual (ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+
 ambix_err_t     _ambix_close    (ambix_t*ambix) {
   return AMBIX_ERR_INVALID_FILE;
 }
@@ -33,6 +37,18 @@ ambix_err_t     _ambix_close    (ambix_t*ambix) {
 struct SNDFILE_tag*_ambix_get_sndfile   (ambix_t*ambix) {
   return 0;
 }
+ambix_err_t _ambix_get_datachunk (ambix_t*ambix, int*fd, int64_t*offset) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+ambix_err_t _ambix_reserve (ambix_t*ambix, int64_t bytes) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+ambix_err_t _ambix_advise (ambix_t*ambix, ambix_advice_t advice, int64_t offset, int64_t bytes) {
+  return AMBIX_ERR_INVALID_FILE;
+}
+ambix_err_t _ambix_checkpoint (ambix_t*ambix) {
+  return AMBIX_ERR_INVALID_FILE;
+}
 
 int64_t _ambix_readf_int16   (ambix_t*ambix, int16_t*data, int64_t frames) {
   return -1;
@@ -46,6 +62,12 @@ int64_t _ambix_readf_float32   (ambix_t*ambix, float32_t*data, int64_t frames) {
 int64_t _ambix_readf_float64   (ambix_t*ambix, float64_t*data, int64_t frames) {
   return -1;
 }
+int64_t _ambix_readf_raw   (ambix_t*ambix, void*data, int64_t frames, uint32_t framesize) {
+  return -1;
+}
+ambix_err_t _ambix_get_peaks   (ambix_t*ambix, float32_t*peaks) {
+  return AMBIX_ERR_UNKNOWN;
+}
 
 int64_t _ambix_writef_int16   (ambix_t*ambix, const int16_t*data, int64_t frames) {
   return -1;
@@ -59,9 +81,15 @@ int64_t _ambix_writef_float32   (ambix_t*ambix, const float32_t*data, int64_t fr
 int64_t _ambix_writef_float64   (ambix_t*ambix, const float64_t*data, int64_t frames) {
   return -1;
 }
+int64_t _ambix_writef_raw   (ambix_t*ambix, const void*data, int64_t frames, uint32_t framesize) {
+  return -1;
+}
 ambix_err_t _ambix_write_uuidchunk(ambix_t*ax, const void*data, int64_t datasize) {
   return  AMBIX_ERR_UNKNOWN;
 }
+ambix_err_t _ambix_append_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize) {
+  return  AMBIX_ERR_UNKNOWN;
+}
 int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int whence) {
   return -1;
 }
@@ -0,0 +1,448 @@
+/* overview.c -  multi-resolution waveform overview              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#include <math.h>
+#include <float.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+/* bins of 256, 4096 and 65536 frames */
+#define OVERVIEW_LEVELS 3
+#define OVERVIEW_BINSIZE(level) (256u << (4*(level)))
+/* the maximum number of bins on the finest level; when it is reached, adjacent
+ * bins of all levels are merged (doubling the binsizes).
+ * must be a multiple of 2*16^(OVERVIEW_LEVELS-1), so all levels are aligned */
+#define OVERVIEW_MAXBINS 16384
+
+/* the 'ovrv' chunk (all big-endian):
+ *   UInt32 version, UInt32 channels, UInt32 levels
+ * followed by each level:
+ *   UInt32 binsize, UInt64 numbins, numbins*channels*{Float32 min, max, rms}
+ */
+#define OVERVIEW_VERSION 1
+#define OVERVIEW_CHUNKHEADER 12
+#define OVERVIEW_LEVELHEADER 12
+#define OVERVIEW_BINBYTES 12
+
+static uint32_t _ambix_overview_chunkid(void) {
+  uint32_t id;
+  memcpy(&id, "ovrv", 4);
+  return id;
+}
+
+static unsigned char*_ambix_overview_put32(unsigned char*dest, uint32_t value) {
+  *dest++=(value>>24)&0xFF;
+  *dest++=(value>>16)&0xFF;
+  *dest++=(value>> 8)&0xFF;
+  *dest++=(value    )&0xFF;
+  return dest;
+}
+static const unsigned char*_ambix_overview_get32(const unsigned char*src, uint32_t*value) {
+  *value=((uint32_t)src[0]<<24) | ((uint32_t)src[1]<<16) | ((uint32_t)src[2]<<8) | (uint32_t)src[3];
+  return src+4;
+}
+
+static void _ambix_overview_reset(ambix_overviewlevel_t*level, uint32_t channels) {
+  uint32_t c;
+  for(c=0; c<channels; c++) {
+    level->curmin[c]= FLT_MAX;
+    level->curmax[c]=-FLT_MAX;
+    level->cursumsq[c]=0.;
+  }
+  level->curframes=0;
+}
+
+static ambix_overviewlevel_t*_ambix_overview_create(uint32_t channels, uint32_t levels, int accumulate) {
+  ambix_overviewlevel_t*overview=(ambix_overviewlevel_t*)calloc(levels, sizeof(ambix_overviewlevel_t));
+  uint32_t l;
+  if(!overview)
+    return NULL;
+  for(l=0; l<levels; l++) {
+    ambix_overviewlevel_t*level=overview+l;
+    level->binsize=OVERVIEW_BINSIZE(l);
+    if(!accumulate)
+      continue;
+    level->curmin=(float32_t*)calloc(channels, sizeof(float32_t));
+    level->curmax=(float32_t*)calloc(channels, sizeof(float32_t));
+    level->cursumsq=(float64_t*)calloc(channels, sizeof(float64_t));
+    if(!level->curmin || !level->curmax || !level->cursumsq) {
+      uint32_t i;
+      for(i=0; i<=l; i++) {
+        free(overview[i].curmin);
+        free(overview[i].curmax);
+        free(overview[i].cursumsq);
+      }
+      free(overview);
+      return NULL;
+    }
+    _ambix_overview_reset(level, channels);
+  }
+  return overview;
+}
+
+void _ambix_overview_deinit(ambix_t*ambix) {
+  uint32_t l;
+  if(ambix->overview) {
+    for(l=0; l<ambix->overview_levels; l++) {
+      ambix_overviewlevel_t*level=ambix->overview+l;
+      free(level->bins);
+      free(level->curmin);
+      free(level->curmax);
+      free(level->cursumsq);
+    }
+    free(ambix->overview);
+  }
+  ambix->overview=NULL;
+  ambix->overview_levels=0;
+}
+
+ambix_err_t ambix_set_overview(ambix_t*ambix, int enable) {
+  const uint32_t channels=(ambix->channels>0)?ambix->channels:0;
+  if(!(ambix->filemode & AMBIX_WRITE))
+    return AMBIX_ERR_INVALID_FILE;
+  /* too late, writing started already */
+  if(ambix->startedWriting)
+    return AMBIX_ERR_UNKNOWN;
+  _ambix_overview_deinit(ambix);
+  ambix->overview_failed=0;
+  if(!enable || !channels)
+    return AMBIX_ERR_SUCCESS;
+  ambix->overview=_ambix_overview_create(channels, OVERVIEW_LEVELS, 1);
+  if(!ambix->overview)
+    return AMBIX_ERR_UNKNOWN;
+  ambix->overview_levels=OVERVIEW_LEVELS;
+  return AMBIX_ERR_SUCCESS;
+}
+
+/* give up on the overview (rather than storing a corrupted one) */
+static void _ambix_overview_fail(ambix_t*ambix) {
+  _ambix_overview_deinit(ambix);
+  ambix->overview_failed=1;
+}
+
+/* halve the resolution of all levels, by merging pairs of adjacent (full) bins */
+static void _ambix_overview_decimate(ambix_t*ambix) {
+  const uint32_t channels=ambix->channels;
+  uint32_t l;
+  if(ambix->overview[ambix->overview_levels-1].binsize > 0x7FFFFFFFu) {
+    _ambix_overview_fail(ambix);
+    return;
+  }
+  for(l=0; l<ambix->overview_levels; l++) {
+    ambix_overviewlevel_t*level=ambix->overview+l;
+    const uint64_t numbins=level->numbins/2;
+    uint64_t b;
+    for(b=0; b<numbins; b++) {
+      const ambix_overview_t*src=level->bins+2*b*channels;
+      ambix_overview_t*dest=level->bins+b*channels;
+      uint32_t c;
+      for(c=0; c<channels; c++) {
+        const ambix_overview_t a=src[c], z=src[channels+c];
+        dest[c].min=(a.min<z.min)?a.min:z.min;
+        dest[c].max=(a.max>z.max)?a.max:z.max;
+        dest[c].rms=(float32_t)sqrt(0.5*((float64_t)a.rms*a.rms+(float64_t)z.rms*z.rms));
+      }
+    }
+    level->numbins=numbins;
+    level->binsize*=2;
+  }
+}
+
+/* finish the current bin of a level, and feed it into the next (coarser) level */
+static void _ambix_overview_finishbin(ambix_t*ambix, uint32_t l) {
+  const uint32_t channels=ambix->channels;
+  ambix_overviewlevel_t*level=ambix->overview+l;
+  ambix_overviewlevel_t*next=(l+1<ambix->overview_levels)?(level+1):NULL;
+  const int full=(level->curframes>=level->binsize);
+  ambix_overview_t*bin;
+  uint32_t c;
+  if(level->numbins>=level->allocbins) {
+    uint64_t allocbins=level->allocbins?(2*level->allocbins):64;
+    ambix_overview_t*bins;
+    if(allocbins>OVERVIEW_MAXBINS)
+      allocbins=OVERVIEW_MAXBINS;
+    bins=(ambix_overview_t*)realloc(level->bins, allocbins*channels*sizeof(ambix_overview_t));
+    if(!bins) {
+      /* dropping a single bin would misalign all the following ones */
+      _ambix_overview_fail(ambix);
+      return;
+    }
+    level->bins=bins;
+    level->allocbins=allocbins;
+  }
+  bin=level->bins+level->numbins*channels;
+  for(c=0; c<channels; c++) {
+    bin[c].min=level->curmin[c];
+    bin[c].max=level->curmax[c];
+    bin[c].rms=(float32_t)sqrt(level->cursumsq[c]/(float64_t)level->curframes);
+    if(next) {
+      next->curmin[c]=(level->curmin[c]<next->curmin[c])?level->curmin[c]:next->curmin[c];
+      next->curmax[c]=(level->curmax[c]>next->curmax[c])?level->curmax[c]:next->curmax[c];
+      next->cursumsq[c]+=level->cursumsq[c];
+    }
+  }
+  level->numbins++;
+  if(next) {
+    next->curframes+=level->curframes;
+    if(next->curframes>=next->binsize) {
+      _ambix_overview_finishbin(ambix, l+1);
+      if(!ambix->overview)
+        return;
+    }
+  }
+  _ambix_overview_reset(level, channels);
+  /* the trailing (partial) bin written when closing never triggers a merge */
+  if(!l && full && level->numbins>=OVERVIEW_MAXBINS)
+    _ambix_overview_decimate(ambix);
+}
+
+/* only the finest level sees the actual samples */
+#define _AMBIX_OVERVIEW_TRACK(type, scale)                              \
+  void _ambix_overview_track_##type(ambix_t*ambix, const type##_t*data, int64_t frames) { \
+    const uint32_t channels=ambix->channels;                            \
+    ambix_overviewlevel_t*level=ambix->overview;                        \
+    if(!level)                                                          \
+      return;                                                           \
+    while(frames>0) {                                                   \
+      const int64_t left=level->binsize-level->curframes;               \
+      const int64_t n=(frames<left)?frames:left;                        \
+      int64_t f;                                                        \
+      for(f=0; f<n; f++, data+=channels) {                              \
+        uint32_t c;                                                     \
+        for(c=0; c<channels; c++) {                                     \
+          const float32_t v=(float32_t)(data[c]*(scale));               \
+          level->curmin[c]=(v<level->curmin[c])?v:level->curmin[c];     \
+          level->curmax[c]=(v>level->curmax[c])?v:level->curmax[c];     \
+          level->cursumsq[c]+=(float64_t)v*v;                           \
+        }                                                               \
+      }                                                                 \
+      level->curframes+=n;                                              \
+      frames-=n;                                                        \
+      if(level->curframes>=level->binsize) {                            \
+        _ambix_overview_finishbin(ambix, 0);                            \
+        if(!ambix->overview)                                            \
+          return;                                                       \
+      }                                                                 \
+    }                                                                   \
+  }
+
+_AMBIX_OVERVIEW_TRACK(float32, 1.);
+_AMBIX_OVERVIEW_TRACK(float64, 1.);
+_AMBIX_OVERVIEW_TRACK(int32, 1./2147483648.);
+_AMBIX_OVERVIEW_TRACK(int16, 1./32768.);
+
+void _ambix_overview_track_pcm(ambix_t*ambix, const unsigned char*data, uint32_t samplebytes, int bigendian, int64_t frames) {
+  const uint32_t channels=ambix->channels;
+  ambix_overviewlevel_t*level=ambix->overview;
+  const float32_t scale=1./2147483648.;
+  if(!level)
+    return;
+  while(frames>0) {
+    const int64_t left=level->binsize-level->curframes;
+    const int64_t n=(frames<left)?frames:left;
+    int64_t f;
+    for(f=0; f<n; f++) {
+      uint32_t c;
+      for(c=0; c<channels; c++, data+=samplebytes) {
+        uint32_t u;
+        float32_t v;
+        if(2==samplebytes)
+          u=bigendian
+            ?(((uint32_t)data[0]<<24) | ((uint32_t)data[1]<<16))
+            :(((uint32_t)data[1]<<24) | ((uint32_t)data[0]<<16));
+        else
+          u=bigendian
+            ?(((uint32_t)data[0]<<24) | ((uint32_t)data[1]<<16) | ((uint32_t)data[2]<<8))
+            :(((uint32_t)data[2]<<24) | ((uint32_t)data[1]<<16) | ((uint32_t)data[0]<<8));
+        v=scale*(float32_t)(int32_t)u;
+        level->curmin[c]=(v<level->curmin[c])?v:level->curmin[c];
+        level->curmax[c]=(v>level->curmax[c])?v:level->curmax[c];
+        level->cursumsq[c]+=(float64_t)v*v;
+      }
+    }
+    level->curframes+=n;
+    frames-=n;
+    if(level->curframes>=level->binsize) {
+      _ambix_overview_finishbin(ambix, 0);
+      if(!ambix->overview)
+        return;
+    }
+  }
+}
+
+ambix_err_t _ambix_overview_write(ambix_t*ambix) {
+  const uint32_t channels=ambix->channels;
+  const uint32_t levels=ambix->overview_levels;
+  int64_t datasize=OVERVIEW_CHUNKHEADER;
+  unsigned char*data, *dest;
+  ambix_err_t res;
+  uint32_t l;
+  if(ambix->overview_failed)
+    return AMBIX_ERR_UNKNOWN;
+  if(!ambix->overview)
+    return AMBIX_ERR_SUCCESS;
+
+  /* the trailing frames make up a (shorter) last bin on each level */
+  for(l=0; l<levels; l++) {
+    if(ambix->overview[l].curframes>0)
+      _ambix_overview_finishbin(ambix, l);
+    if(!ambix->overview)
+      return AMBIX_ERR_UNKNOWN;
+  }
+  if(!ambix->overview[0].numbins)
+    return AMBIX_ERR_SUCCESS;
+
+  for(l=0; l<levels; l++)
+    datasize+=OVERVIEW_LEVELHEADER+ambix->overview[l].numbins*channels*OVERVIEW_BINBYTES;
+  data=(unsigned char*)malloc(datasize);
+  if(!data)
+    return AMBIX_ERR_UNKNOWN;
+  dest=_ambix_overview_put32(data, OVERVIEW_VERSION);
+  dest=_ambix_overview_put32(dest, channels);
+  dest=_ambix_overview_put32(dest, levels);
+  for(l=0; l<levels; l++) {
+    const ambix_overviewlevel_t*level=ambix->overview+l;
+    const float32_t*values=(const float32_t*)level->bins;
+    uint64_t i;
+    dest=_ambix_overview_put32(dest, level->binsize);
+    dest=_ambix_overview_put32(dest, (uint32_t)(level->numbins>>32));
+    dest=_ambix_overview_put32(dest, (uint32_t)(level->numbins&0xFFFFFFFF));
+    for(i=0; i<level->numbins*channels*3; i++) {
+      union {
+        uint32_t i;
+        float32_t f;
+      } value;
+      value.f=values[i];
+      dest=_ambix_overview_put32(dest, value.i);
+    }
+  }
+  res=_ambix_append_chunk(ambix, _ambix_overview_chunkid(), data, datasize);
+  free(data);
+  return res;
+}
+
+/* read the overview from the 'ovrv' chunk */
+static ambix_err_t _ambix_overview_read(ambix_t*ambix) {
+  const uint32_t channels=ambix->channels;
+  int64_t datasize=0;
+  const unsigned char*data=(const unsigned char*)_ambix_read_chunk(ambix, _ambix_overview_chunkid(), 0, &datasize);
+  const unsigned char*src, *end;
+  ambix_overviewlevel_t*overview=NULL;
+  uint32_t version, numchannels, levels, l;
+  if(!data)
+    return AMBIX_ERR_INVALID_FILE;
+  end=data+datasize;
+  if(datasize<OVERVIEW_CHUNKHEADER)
+    goto fail;
+  src=_ambix_overview_get32(data, &version);
+  src=_ambix_overview_get32(src, &numchannels);
+  src=_ambix_overview_get32(src, &levels);
+  if(OVERVIEW_VERSION!=version || numchannels!=channels || levels<1)
+    goto fail;
+  overview=_ambix_overview_create(channels, levels, 0);
+  if(!overview)
+    goto fail;
+  for(l=0; l<levels; l++) {
+    ambix_overviewlevel_t*level=overview+l;
+    uint32_t hi, lo;
+    float32_t*values;
+    uint64_t i;
+    if(end-src<OVERVIEW_LEVELHEADER)
+      goto fail;
+    src=_ambix_overview_get32(src, &level->binsize);
+    src=_ambix_overview_get32(src, &hi);
+    src=_ambix_overview_get32(src, &lo);
+    level->numbins=((uint64_t)hi<<32) | lo;
+    if(!level->binsize || (uint64_t)(end-src)/(channels*OVERVIEW_BINBYTES) < level->numbins)
+      goto fail;
+    if(!level->numbins)
+      continue;
+    level->bins=(ambix_overview_t*)malloc(level->numbins*channels*sizeof(ambix_overview_t));
+    if(!level->bins)
+      goto fail;
+    level->allocbins=level->numbins;
+    values=(float32_t*)level->bins;
+    for(i=0; i<level->numbins*channels*3; i++) {
+      union {
+        uint32_t i;
+        float32_t f;
+      } value;
+      src=_ambix_overview_get32(src, &value.i);
+      values[i]=value.f;
+    }
+  }
+  free((void*)data);
+  ambix->overview=overview;
+  ambix->overview_levels=levels;
+  return AMBIX_ERR_SUCCESS;
+
+ fail:
+  if(overview) {
+    for(l=0; l<levels; l++)
+      free(overview[l].bins);
+    free(overview);
+  }
+  free((void*)data);
+  return AMBIX_ERR_INVALID_FILE;
+}
+
+/* when reading, the overview is only parsed when it is first asked for */
+static const ambix_overviewlevel_t*_ambix_overview_getlevel(ambix_t*ambix, uint32_t level) {
+  if(!ambix->overview && !ambix->overview_loaded && (ambix->filemode & AMBIX_READ) && ambix->channels>0) {
+    ambix->overview_loaded=1;
+    _ambix_overview_read(ambix);
+  }
+  if(!ambix->overview || level>=ambix->overview_levels)
+    return NULL;
+  return ambix->overview+level;
+}
+
+uint32_t ambix_get_overview_binsize(ambix_t*ambix, uint32_t level) {
+  const ambix_overviewlevel_t*lvl=_ambix_overview_getlevel(ambix, level);
+  return lvl?lvl->binsize:0;
+}
+
+int64_t ambix_get_overview(ambix_t*ambix, uint32_t channel, uint32_t level, int64_t offset, ambix_overview_t*bins, int64_t numbins) {
+  const uint32_t channels=(ambix->channels>0)?ambix->channels:0;
+  const ambix_overviewlevel_t*lvl=_ambix_overview_getlevel(ambix, level);
+  const ambix_overview_t*src;
+  int64_t i;
+  if(!lvl)
+    return -AMBIX_ERR_INVALID_FILE;
+  if(channel>=channels || offset<0 || numbins<0)
+    return -AMBIX_ERR_INVALID_DIMENSION;
+  if((uint64_t)offset>=lvl->numbins)
+    return 0;
+  if((uint64_t)(offset+numbins)>lvl->numbins)
+    numbins=lvl->numbins-offset;
+  src=lvl->bins+offset*channels+channel;
+  for(i=0; i<numbins; i++, src+=channels)
+    bins[i]=*src;
+  return numbins;
+}
@@ -0,0 +1,422 @@
+/* peaks.c -  per-channel peaks and skipping of silent channels              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#include <math.h>
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+/* number of frames to read at once when scanning a file for its peaks */
+#define PEAKS_SCANSIZE 4096
+
+/* the CAF 'peak' chunk: UInt32 mEditCount, followed by
+ * {Float32 mValue; SInt64 mFrameNumber} for each channel (all big-endian) */
+#define PEAKS_CHUNKHEADER 4
+#define PEAKS_CHUNKENTRY 12
+
+static uint32_t _ambix_peaks_chunkid(void) {
+  uint32_t id;
+  memcpy(&id, "peak", 4);
+  return id;
+}
+
+/* read the peaks (including their positions) from the 'peak' chunk */
+static ambix_err_t _ambix_peaks_read(ambix_t*ambix) {
+  const uint32_t channels=ambix->channels;
+  int64_t datasize=0;
+  const unsigned char*data=(const unsigned char*)_ambix_read_chunk(ambix, _ambix_peaks_chunkid(), 0, &datasize);
+  uint32_t c;
+  if(!data)
+    return AMBIX_ERR_UNKNOWN;
+  if(datasize < PEAKS_CHUNKHEADER+PEAKS_CHUNKENTRY*channels) {
+    free((void*)data);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  for(c=0; c<channels; c++) {
+    const unsigned char*entry=data+PEAKS_CHUNKHEADER+PEAKS_CHUNKENTRY*c;
+    union {
+      uint32_t i;
+      float32_t f;
+    } value;
+    uint64_t pos=0;
+    uint32_t i;
+    value.i=((uint32_t)entry[0]<<24) | ((uint32_t)entry[1]<<16) | ((uint32_t)entry[2]<<8) | (uint32_t)entry[3];
+    for(i=4; i<PEAKS_CHUNKENTRY; i++)
+      pos=(pos<<8) | entry[i];
+    ambix->peaks[c]=value.f;
+    ambix->peak_positions[c]=(int64_t)pos;
+  }
+  free((void*)data);
+  return AMBIX_ERR_SUCCESS;
+}
+
+void _ambix_peaks_init(ambix_t*ambix) {
+  const uint32_t channels=(ambix->channels>0)?ambix->channels:0;
+  uint32_t c;
+  if(channels<1)
+    return;
+  ambix->peaks=(float32_t*)calloc(channels, sizeof(float32_t));
+  ambix->peak_positions=(int64_t*)calloc(channels, sizeof(int64_t));
+  if(ambix->filemode & AMBIX_WRITE)
+    ambix->peak_block=(float32_t*)calloc(channels, sizeof(float32_t));
+  if(!ambix->peaks || !ambix->peak_positions || ((ambix->filemode & AMBIX_WRITE) && !ambix->peak_block)) {
+    _ambix_peaks_deinit(ambix);
+    return;
+  }
+  ambix->peak_offset=0;
+  if(ambix->filemode & AMBIX_WRITE)
+    return;
+
+  /* prefer our own parser of the 'peak' chunk, as it also yields the positions */
+  if(AMBIX_ERR_SUCCESS==_ambix_peaks_read(ambix)) {
+    ambix->plan_dirty=1;
+    return;
+  }
+  if(AMBIX_ERR_SUCCESS==_ambix_get_peaks(ambix, ambix->peaks)) {
+    for(c=0; c<channels; c++)
+      ambix->peak_positions[c]=-1;
+    ambix->plan_dirty=1;
+    return;
+  }
+  /* no peaks available (yet) */
+  free(ambix->peaks);
+  free(ambix->peak_positions);
+  ambix->peaks=NULL;
+  ambix->peak_positions=NULL;
+}
+
+static void _ambix_matrixplan_deinit(ambix_matrixplan_t*plan) {
+  free(plan->rows);
+  free(plan->columns);
+  plan->rows=NULL;
+  plan->columns=NULL;
+  ambix_matrix_deinit(&plan->compact);
+  plan->matrix=NULL;
+}
+
+void _ambix_peaks_deinit(ambix_t*ambix) {
+  free(ambix->peaks);
+  free(ambix->peak_positions);
+  free(ambix->peak_block);
+  ambix->peaks=NULL;
+  ambix->peak_positions=NULL;
+  ambix->peak_block=NULL;
+  _ambix_matrixplan_deinit(&ambix->plan);
+  ambix->plan_dirty=0;
+}
+
+/* drop the columns of the silent channels (and the rows that become all zero) */
+static void _ambix_matrixplan_init(ambix_matrixplan_t*plan, const ambix_matrix_t*matrix, const float32_t*peaks, uint32_t channels) {
+  float32_t**mtx=matrix->data;
+  uint32_t numrows=0, numcols=0;
+  uint32_t r, c;
+
+  _ambix_matrixplan_deinit(plan);
+  plan->matrix=matrix;
+  if(matrix->cols>channels)
+    return;
+
+  for(c=0; c<matrix->cols; c++)
+    if(peaks[c]>0.)
+      numcols++;
+  /* nothing to skip */
+  if(numcols==matrix->cols)
+    return;
+
+  plan->rows=(uint32_t*)calloc(matrix->rows+1, sizeof(uint32_t));
+  plan->columns=(uint32_t*)calloc(numcols+1, sizeof(uint32_t));
+  if(!plan->rows || !plan->columns)
+    goto fail;
+
+  for(c=0, numcols=0; c<matrix->cols; c++)
+    if(peaks[c]>0.)
+      plan->columns[numcols++]=c;
+  for(r=0; r<matrix->rows; r++) {
+    for(c=0; c<numcols; c++) {
+      if(mtx[r][plan->columns[c]]!=0.) {
+        plan->rows[numrows++]=r;
+        break;
+      }
+    }
+  }
+
+  if(!ambix_matrix_init(numrows, numcols, &plan->compact))
+    goto fail;
+  for(r=0; r<numrows; r++)
+    for(c=0; c<numcols; c++)
+      plan->compact.data[r][c]=mtx[plan->rows[r]][plan->columns[c]];
+  return;
+
+ fail:
+  _ambix_matrixplan_deinit(plan);
+  plan->matrix=matrix;
+}
+
+const ambix_matrixplan_t*_ambix_get_matrixplan(ambix_t*ambix, const ambix_matrix_t*matrix) {
+  ambix_matrixplan_t*plan=&ambix->plan;
+  if(!ambix->peaks)
+    return NULL;
+  if(ambix->plan_dirty || plan->matrix!=matrix) {
+    _ambix_matrixplan_init(plan, matrix, ambix->peaks, ambix->channels);
+    ambix->plan_dirty=0;
+  }
+  /* if there are no columns, there is nothing to be gained */
+  return plan->columns?plan:NULL;
+}
+
+/* track the peaks block-wise: first find the per-channel maxima of a block
+ * (which vectorizes nicely), and only if a channel exceeds its current peak,
+ * search the block for the position of the new peak */
+#define PEAKS_BLOCKSIZE 256
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+static void _ambix_peaks_blockmax_float32(const float32_t*data, uint32_t channels, int64_t frames, float32_t*blockmax) {
+  const __m128 zero=_mm_setzero_ps();
+  int64_t f;
+  for(f=0; f<frames; f++, data+=channels) {
+    uint32_t c=0;
+    for(; c+4<=channels; c+=4) {
+      /* |x| = max(x, -x) */
+      const __m128 x=_mm_loadu_ps(data+c);
+      const __m128 v=_mm_max_ps(x, _mm_sub_ps(zero, x));
+      _mm_storeu_ps(blockmax+c, _mm_max_ps(_mm_loadu_ps(blockmax+c), v));
+    }
+    for(; c<channels; c++) {
+      const float32_t v=fabsf(data[c]);
+      blockmax[c]=(v>blockmax[c])?v:blockmax[c];
+    }
+  }
+}
+#else
+static void _ambix_peaks_blockmax_float32(const float32_t*data, uint32_t channels, int64_t frames, float32_t*blockmax) {
+  int64_t f;
+  for(f=0; f<frames; f++, data+=channels) {
+    uint32_t c;
+    for(c=0; c<channels; c++) {
+      const float32_t v=fabsf(data[c]);
+      blockmax[c]=(v>blockmax[c])?v:blockmax[c];
+    }
+  }
+}
+#endif
+
+#define _AMBIX_PEAKS_BLOCKMAX(type, scale)                              \
+  static void _ambix_peaks_blockmax_##type(const type##_t*data, uint32_t channels, int64_t frames, float32_t*blockmax) { \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++, data+=channels) {                           \
+      uint32_t c;                                                       \
+      for(c=0; c<channels; c++) {                                       \
+        const float32_t v=(float32_t)fabs((float64_t)data[c]*(scale));  \
+        blockmax[c]=(v>blockmax[c])?v:blockmax[c];                      \
+      }                                                                 \
+    }                                                                   \
+  }
+
+_AMBIX_PEAKS_BLOCKMAX(float64, 1.);
+_AMBIX_PEAKS_BLOCKMAX(int32, 1./2147483648.);
+_AMBIX_PEAKS_BLOCKMAX(int16, 1./32768.);
+
+#define _AMBIX_PEAKS_TRACK(type, scale)                                 \
+  void _ambix_peaks_track_##type(ambix_t*ambix, const type##_t*data, int64_t frames) { \
+    const uint32_t channels=ambix->channels;                            \
+    float32_t*blockmax=ambix->peak_block;                               \
+    int64_t block;                                                      \
+    if(!ambix->peaks || !blockmax || frames<1)                          \
+      return;                                                           \
+    for(block=0; block<frames; block+=PEAKS_BLOCKSIZE) {                \
+      const type##_t*src=data+block*channels;                           \
+      const int64_t blocksize=(frames-block<PEAKS_BLOCKSIZE)?(frames-block):PEAKS_BLOCKSIZE; \
+      uint32_t c;                                                       \
+      memset(blockmax, 0, channels*sizeof(*blockmax));                  \
+      _ambix_peaks_blockmax_##type(src, channels, blocksize, blockmax); \
+      for(c=0; c<channels; c++) {                                       \
+        int64_t f;                                                      \
+        if(!(blockmax[c]>ambix->peaks[c]))                              \
+          continue;                                                     \
+        for(f=0; f<blocksize; f++) {                                    \
+          if((float32_t)fabs((float64_t)src[f*channels+c]*(scale)) == blockmax[c]) \
+            break;                                                      \
+        }                                                               \
+        ambix->peaks[c]=blockmax[c];                                    \
+        ambix->peak_positions[c]=ambix->peak_offset+block+f;            \
+      }                                                                 \
+    }                                                                   \
+    ambix->peak_offset+=frames;                                         \
+  }
+
+_AMBIX_PEAKS_TRACK(float32, 1.);
+_AMBIX_PEAKS_TRACK(float64, 1.);
+_AMBIX_PEAKS_TRACK(int32, 1./2147483648.);
+_AMBIX_PEAKS_TRACK(int16, 1./32768.);
+
+void _ambix_peaks_track_pcm24(ambix_t*ambix, const unsigned char*data, int64_t frames) {
+  const uint32_t channels=ambix->channels;
+  const int bigendian=_ambix_is_bigendian();
+  const float32_t scale=1./(float32_t)0x800000;
+  int64_t f;
+  if(!ambix->peaks)
+    return;
+  for(f=0; f<frames; f++) {
+    uint32_t c;
+    for(c=0; c<channels; c++, data+=3) {
+      const uint32_t u=bigendian
+        ?(((uint32_t)data[0]<<24) | ((uint32_t)data[1]<<16) | ((uint32_t)data[2]<<8))
+        :(((uint32_t)data[2]<<24) | ((uint32_t)data[1]<<16) | ((uint32_t)data[0]<<8));
+      const float32_t v=fabsf(scale*(float32_t)((int32_t)u>>8));
+      if(v>ambix->peaks[c]) {
+        ambix->peaks[c]=v;
+        ambix->peak_positions[c]=ambix->peak_offset+f;
+      }
+    }
+  }
+  ambix->peak_offset+=frames;
+}
+
+ambix_err_t _ambix_peaks_write(ambix_t*ambix) {
+  const uint32_t channels=ambix->channels;
+  const int64_t datasize=PEAKS_CHUNKHEADER+PEAKS_CHUNKENTRY*channels;
+  unsigned char*data, *entry;
+  ambix_err_t res;
+  uint32_t c;
+  if(!ambix->peaks || ambix->peak_offset<1)
+    return AMBIX_ERR_SUCCESS;
+  data=(unsigned char*)calloc(datasize, 1);
+  if(!data)
+    return AMBIX_ERR_UNKNOWN;
+  /* mEditCount (matching the 'data' chunk) stays 0 */
+  for(c=0, entry=data+PEAKS_CHUNKHEADER; c<channels; c++, entry+=PEAKS_CHUNKENTRY) {
+    union {
+      uint32_t i;
+      float32_t f;
+    } value;
+    uint64_t pos=(uint64_t)ambix->peak_positions[c];
+    int i;
+    value.f=ambix->peaks[c];
+    entry[0]=(value.i>>24)&0xFF;
+    entry[1]=(value.i>>16)&0xFF;
+    entry[2]=(value.i>> 8)&0xFF;
+    entry[3]=(value.i    )&0xFF;
+    for(i=PEAKS_CHUNKENTRY-1; i>=4; i--, pos>>=8)
+      entry[i]=pos&0xFF;
+  }
+  res=_ambix_append_chunk(ambix, _ambix_peaks_chunkid(), data, datasize);
+  free(data);
+  return res;
+}
+
+/* read the entire file to find the peaks, and return to the current position */
+static ambix_err_t _ambix_peaks_scan(ambix_t*ambix, float32_t*peaks, int64_t*positions) {
+  const uint32_t channels=ambix->channels;
+  ambix_err_t res=AMBIX_ERR_SUCCESS;
+  float32_t*buf;
+  int64_t pos, got, offset=0;
+  uint32_t c;
+
+  pos=_ambix_seek(ambix, 0, SEEK_CUR);
+  if(pos<0 || _ambix_seek(ambix, 0, SEEK_SET)<0)
+    return AMBIX_ERR_UNKNOWN;
+
+  buf=(float32_t*)malloc(PEAKS_SCANSIZE*channels*sizeof(float32_t));
+  if(buf) {
+    for(c=0; c<channels; c++) {
+      peaks[c]=0.;
+      positions[c]=0;
+    }
+    while((got=_ambix_readf_float32(ambix, buf, PEAKS_SCANSIZE))>0) {
+      const float32_t*src=buf;
+      int64_t f;
+      for(f=0; f<got; f++) {
+        for(c=0; c<channels; c++) {
+          const float32_t v=fabsf(*src++);
+          if(v>peaks[c]) {
+            peaks[c]=v;
+            positions[c]=offset+f;
+          }
+        }
+      }
+      offset+=got;
+    }
+    free(buf);
+  } else
+    res=AMBIX_ERR_UNKNOWN;
+
+  if(_ambix_seek(ambix, pos, SEEK_SET)!=pos)
+    res=AMBIX_ERR_UNKNOWN;
+  return res;
+}
+
+/* make sure the peaks are known: when reading, scan the file if needed */
+static ambix_err_t _ambix_peaks_ensure(ambix_t*ambix) {
+  const uint32_t channels=(ambix->channels>0)?ambix->channels:0;
+  float32_t*peaks;
+  int64_t*positions;
+  ambix_err_t res;
+  if(ambix->peaks || !channels)
+    return AMBIX_ERR_SUCCESS;
+  if(!(ambix->filemode & AMBIX_READ))
+    return AMBIX_ERR_UNKNOWN;
+
+  peaks=(float32_t*)calloc(channels, sizeof(float32_t));
+  positions=(int64_t*)calloc(channels, sizeof(int64_t));
+  if(!peaks || !positions)
+    res=AMBIX_ERR_UNKNOWN;
+  else
+    res=_ambix_peaks_scan(ambix, peaks, positions);
+  if(AMBIX_ERR_SUCCESS!=res) {
+    free(peaks);
+    free(positions);
+    return res;
+  }
+  ambix->peaks=peaks;
+  ambix->peak_positions=positions;
+  ambix->plan_dirty=1;
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t ambix_get_peaks(ambix_t*ambix, float32_t*peaks, uint32_t numchannels) {
+  const uint32_t channels=(ambix->channels>0)?ambix->channels:0;
+  ambix_err_t res=_ambix_peaks_ensure(ambix);
+  uint32_t c;
+  if(AMBIX_ERR_SUCCESS!=res)
+    return res;
+  for(c=0; c<numchannels; c++)
+    peaks[c]=(c<channels)?ambix->peaks[c]:0.;
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t ambix_get_peak_positions(ambix_t*ambix, int64_t*positions, uint32_t numchannels) {
+  const uint32_t channels=(ambix->channels>0)?ambix->channels:0;
+  ambix_err_t res=_ambix_peaks_ensure(ambix);
+  uint32_t c;
+  if(AMBIX_ERR_SUCCESS!=res)
+    return res;
+  for(c=0; c<numchannels; c++)
+    positions[c]=(c<channels)?ambix->peak_positions[c]:-1;
+  return AMBIX_ERR_SUCCESS;
+}
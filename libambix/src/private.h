@@ -47,6 +47,61 @@
 
 #include <ambix/ambix.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+# include <xmmintrin.h>
+# define AMBIX_HAVE_MXCSR 1
+#endif
+
+/** a reduced adaptor matrix, that skips the silent channels of a file */
+typedef struct ambix_matrixplan_t {
+  /** the adaptor matrix this plan was computed for */
+  const ambix_matrix_t*matrix;
+  /** the (non-zero) rows of the adaptor matrix that are computed */
+  uint32_t*rows;
+  /** the (non-silent) raw ambisonics channels that are used */
+  uint32_t*columns;
+  /** the adaptor matrix, reduced to the used rows and columns */
+  ambix_matrix_t compact;
+} ambix_matrixplan_t;
+
+/** a single resolution level of a waveform overview */
+typedef struct ambix_overviewlevel_t {
+  /** number of frames per bin */
+  uint32_t binsize;
+  /** the completed bins (numbins*channels, interleaved) */
+  ambix_overview_t*bins;
+  /** number of completed bins */
+  uint64_t numbins;
+  /** number of bins allocated */
+  uint64_t allocbins;
+  /** per-channel minimum of the bin that is being accumulated */
+  float32_t*curmin;
+  /** per-channel maximum of the bin that is being accumulated */
+  float32_t*curmax;
+  /** per-channel sum of squares of the bin that is being accumulated */
+  float64_t*cursumsq;
+  /** number of frames in the bin that is being accumulated */
+  uint64_t curframes;
+} ambix_overviewlevel_t;
+
+/** the directional energy index */
+typedef struct ambix_directionindex_t {
+  /** number of frames per block */
+  uint32_t blocksize;
+  /** the completed blocks */
+  ambix_direction_t*blocks;
+  /** number of completed blocks */
+  uint64_t numblocks;
+  /** number of blocks allocated */
+  uint64_t allocblocks;
+  /** sums of W*W, W*X, W*Y and W*Z of the block that is being accumulated */
+  float64_t cursum[4];
+  /** number of frames in the block that is being accumulated */
+  uint64_t curframes;
+  /** scratch space for the ambisonics channels of a single frame */
+  float32_t*frame;
+} ambix_directionindex_t;
+
 /** this is for passing data about the opened ambix file between the host application and the library */
 struct ambix_t_struct {
   /** private data by the actual backend */
@@ -63,6 +118,8 @@ struct ambix_t_struct {
 
   /** whether the file is byteswapped in relation to host */
   int byteswap;
+  /** whether chunk data (which is always big-endian) is byteswapped in relation to host */
+  int chunkswap;
 
   /** full number of channels in the file */
   int32_t channels;
@@ -78,6 +135,8 @@ struct ambix_t_struct {
   ambix_matrix_t matrix2;
   /** whether to use the matrix(1), the finalmatrix(2), or no matrix when decoding */
   int use_matrix;
+  /** the routing of the active adaptor matrix (for raw 24bit data), or NULL if it isn't a mere routing */
+  int32_t*route;
 
   /** buffer for adaptor signals */
   void*adaptorbuffer;
@@ -105,6 +164,61 @@ struct ambix_t_struct {
 
   /** whether we have pending headers to write */
   int pendingHeaders;
+
+  /** whether the library quantizes float data itself (rather than the backend) */
+  int use_dither;
+  /** the dither applied when quantizing */
+  ambix_dither_t dither;
+  /** state of the dither noise generator */
+  uint32_t dither_seed;
+  /** per-channel quantization error (for noise shaping) */
+  float64_t*dither_error;
+  /** per-channel blocks of scaled samples that are about to be quantized */
+  float64_t*dither_work;
+  /** per-channel blocks of quantized samples that are about to be packed */
+  int32_t*dither_samples;
+  /** number of samples clipped while quantizing */
+  uint64_t clipcount;
+
+  /** per-channel peaks of the file (or NULL if unknown) */
+  float32_t*peaks;
+  /** the frame at which each peak occurs (-1 if unknown) */
+  int64_t*peak_positions;
+  /** scratch buffer for the per-channel maxima of a block while writing */
+  float32_t*peak_block;
+  /** number of frames tracked for peaks so far (while writing) */
+  int64_t peak_offset;
+
+  /** the levels of the waveform overview (or NULL) */
+  ambix_overviewlevel_t*overview;
+  /** the number of overview levels */
+  uint32_t overview_levels;
+  /** whether the overview has been looked for in the file (when reading) */
+  int overview_loaded;
+  /** whether the overview had to be dropped while writing (e.g. out of memory) */
+  int overview_failed;
+
+  /** the directional energy index (or NULL) */
+  ambix_directionindex_t*direction;
+  /** whether the directional energy index has been looked for in the file (when reading) */
+  int direction_loaded;
+
+  /** the memory buffer backing an in-memory file (or NULL) */
+  struct ambix_memory_t*memory;
+  /** the queue of asynchronous reads (or NULL) */
+  struct ambix_async_t*async;
+  /** the unbuffered file backing an AMBIX_DIRECT file (or NULL) */
+  struct ambix_direct_t*direct;
+  /** number of frames between automatic header checkpoints (or 0) */
+  int64_t checkpoint_interval;
+  /** number of frames written since the last checkpoint */
+  int64_t checkpoint_frames;
+  /** whether the (stale) header was corrected when opening (AMBIX_RECOVER) */
+  int recovered;
+  /** adaptor matrix without the silent channels */
+  ambix_matrixplan_t plan;
+  /** whether the plan needs to be recomputed */
+  int plan_dirty;
 };
 
 
@@ -119,6 +233,18 @@ struct ambix_t_struct {
  * @return errorcode indicating success
  */
 ambix_err_t	_ambix_open	(ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo);
+/** @brief Do open an ambix file using virtual I/O
+ *
+ * this is implemented by the various backends (currently only libsndfile)
+ *
+ * @param ambix a pointer to an allocated ambix structure, that get's filled by this call
+ * @param vio the I/O callbacks
+ * @param userdata pointer passed to the callbacks
+ * @param mode open read/write
+ * @param ambixinfo struct to a valid ambixinfo structure
+ * @return errorcode indicating success
+ */
+ambix_err_t	_ambix_open_virtual	(ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo);
 /** @brief Do close an ambix file
  *
  * this is implemented by the various backends (currently only libsndfile)
@@ -145,6 +271,53 @@ int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int whence);
  */
 struct SNDFILE_tag*_ambix_get_sndfile	(ambix_t*ambix);
 
+/** @brief Do locate the audio data of the file on disk
+ *
+ * this is implemented by the various backends (currently only libsndfile, for
+ * CAF files opened for reading by path)
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param fd returns a new file descriptor for the file (to be closed by the caller)
+ * @param offset returns the byte offset of the first sample frame
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_get_datachunk (ambix_t*ambix, int*fd, int64_t*offset);
+
+/** @brief Do reserve disk space for the audio data yet to be written
+ *
+ * this is implemented by the various backends (currently only libsndfile, for
+ * files opened for writing by path); the space not used is released when the
+ * file is closed
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param bytes number of bytes to reserve beyond the current end of the file
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_reserve (ambix_t*ambix, int64_t bytes);
+
+/** @brief Do give the kernel hints about how the file is going to be read
+ *
+ * this is implemented by the various backends (currently only libsndfile, for
+ * files opened for reading by path)
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param advice the expected access pattern
+ * @param offset start of the range (in bytes, relative to the audio data)
+ * @param bytes length of the range (0 means until the end of the file)
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_advise (ambix_t*ambix, ambix_advice_t advice, int64_t offset, int64_t bytes);
+
+/** @brief Do update the size of the audio data in the header of a file being written
+ *
+ * this is implemented by the various backends (currently only libsndfile);
+ * the header is patched in place, to match the audio data written so far
+ *
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_checkpoint (ambix_t*ambix);
+
 /** @brief read 32bit float data from file
  * @param ambix a pointer to a valid ambix structure
  * @param data pointer to an float32_t array that can hold at least frames*channels values
@@ -164,6 +337,28 @@ int64_t _ambix_readf_int32   (ambix_t*ambix, int32_t*data, int64_t frames);
  * @remark this operates on 16bit integer data
  */
 int64_t _ambix_readf_int16   (ambix_t*ambix, int16_t*data, int64_t frames);
+/** @brief read raw (undecoded) sample data from file
+ *
+ * the data is returned in the byte order of the file
+ * (see ambix_t::byteswap)
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param data pointer to a buffer that can hold at least frames*framesize bytes
+ * @param frames number of sample frames to read
+ * @param framesize number of bytes per (interleaved) sample frame
+ * @return number of sample frames successfully read, or a negative value if
+ *         the backend cannot provide raw data
+ */
+int64_t _ambix_readf_raw   (ambix_t*ambix, void*data, int64_t frames, uint32_t framesize);
+/** @brief get the per-channel peaks as stored in the file (e.g. PEAK chunk)
+ *
+ * this does not scan the file
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param peaks pointer to an float32_t array that can hold ambix->channels values
+ * @return errorcode indicating success (AMBIX_ERR_UNKNOWN if the file has no peak information)
+ */
+ambix_err_t _ambix_get_peaks   (ambix_t*ambix, float32_t*peaks);
 
 /** @brief write 32bit float data to file
  * @param ambix a pointer to a valid ambix structure
@@ -184,6 +379,19 @@ int64_t _ambix_writef_int32   (ambix_t*ambix, const int32_t*data, int64_t frames
  * @remark this operates on 16bit integer data
  */
 int64_t _ambix_writef_int16   (ambix_t*ambix, const int16_t*data, int64_t frames);
+/** @brief write raw (encoded) sample data to file
+ *
+ * the data has to be in the byte order of the file
+ * (see ambix_t::byteswap)
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param data pointer to a buffer that holds frames*framesize bytes
+ * @param frames number of sample frames to write
+ * @param framesize number of bytes per (interleaved) sample frame
+ * @return number of sample frames successfully written, or a negative value if
+ *         the backend cannot write raw data
+ */
+int64_t _ambix_writef_raw   (ambix_t*ambix, const void*data, int64_t frames, uint32_t framesize);
 
 /** @brief Get UUID for ambix
  * @param ambix version
@@ -244,6 +452,17 @@ ambix_err_t _ambix_write_markersregions(ambix_t*ax);
  * @return error code indicating success
  */
 ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize);
+/** @brief write general chunk to file, following the audio data
+ * @param ambix valid ambix handle
+ * @param id four-character code identifying the chunk
+ * @param data pointer to memory holding the chunk
+ * @param datasize size of data
+ * @return error code indicating success
+ * @remark the chunk is appended to the file when it is closed (after the header
+ *         has been finalized), so the audio data is never moved;
+ *         streams only accept chunks before the first sample frame is written
+ */
+ambix_err_t _ambix_append_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize);
 /** @brief read general chunk to file
  * @param ambix valid ambix handle
  * @param id four-character code identifying the chunk
@@ -341,14 +560,263 @@ _ambix_matrix_invert_gaussjordan(ambix_matrix_t*matrix, ambix_matrix_t*result, f
 ambix_matrix_t*
 _ambix_matrix_pinvert_cholesky(const ambix_matrix_t*matrix, ambix_matrix_t*result, float32_t tolerance);
 
+/** @brief Pseudo-invert a matrix using SVD
+ *
+ * Calculate the Moore-Penrose pseudo-inverse of a matrix using a
+ * (one-sided Jacobi) singular value decomposition in double precision.
+ *
+ * @param matrix the matrix to invert
+ * @param result the result matrix (if NULL one will be allocated for you)
+ * @param tolerance singular values below tolerance*max(singularvalues) are
+ *   treated as zero; if 0, a default of max(rows,cols)*DBL_EPSILON is used
+ * @return a pointer to the result matrix (or NULL on failure)
+ */
+ambix_matrix_t*
+_ambix_matrix_pinvert_svd(const ambix_matrix_t*matrix, ambix_matrix_t*result, float64_t tolerance);
+
+/** @brief Lookup a pseudo-inverse in the process-wide cache
+ *
+ * @param matrix the matrix to invert
+ * @param result the result matrix (if NULL one will be allocated for you)
+ * @return a pointer to the result matrix (or NULL if the matrix is not cached)
+ */
+ambix_matrix_t*
+_ambix_matrix_pinv_cache_lookup(const ambix_matrix_t*matrix, ambix_matrix_t*result);
+/** @brief Store a pseudo-inverse in the process-wide cache
+ *
+ * @param matrix the original matrix
+ * @param pinv the pseudo-inverse of the matrix
+ */
+void
+_ambix_matrix_pinv_cache_store(const ambix_matrix_t*matrix, const ambix_matrix_t*pinv);
+
+/** @brief run a function for a number of work items on the worker pool
+ *
+ * the work items are distributed among the threads set with
+ * ambix_set_num_threads() (including the calling thread).
+ * if the pool is already busy with another job, all work items are processed
+ * by the calling thread (so independent callers never wait for each other).
+ * this blocks until all work items have been processed.
+ *
+ * @param function the function to call for each work item
+ * @param userdata opaque pointer passed to the function
+ * @param count number of work items (the function gets called with indices [0..count) )
+ */
+void _ambix_parallel_for(void(*function)(void*userdata, uint32_t index), void*userdata, uint32_t count);
+/** @brief process a block of frames in parallel
+ *
+ * split the frames into (contiguous) chunks and process them on the worker
+ * pool; if the block is too small to benefit from multiple threads, the
+ * function is simply called once for all frames.
+ *
+ * @param function the function to call for each chunk
+ * @param userdata opaque pointer passed to the function
+ * @param frames total number of frames
+ * @param framecost (approximate) number of multiply-adds per frame
+ */
+void _ambix_parallel_frames(void(*function)(void*userdata, int64_t offset, int64_t frames), void*userdata, int64_t frames, uint64_t framecost);
+
+/** @brief enable quantization (and dithering) of float data within the library
+ * @param ambix a pointer to a valid ambix structure
+ * @param dither the type of dither to apply
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_dither_init(ambix_t*ambix, ambix_dither_t dither);
+/** @brief free resources allocated by _ambix_dither_init()
+ * @param ambix a pointer to a valid ambix structure
+ */
+void _ambix_dither_deinit(ambix_t*ambix);
+
+/** @brief prepare the per-channel peaks
+ *
+ * when reading, the peaks are fetched from the file headers (if available);
+ * when writing, the peaks are reset so they can be tracked
+ *
+ * @param ambix a pointer to a valid ambix structure
+ */
+void _ambix_peaks_init(ambix_t*ambix);
+/** @brief update the peaks with (interleaved) data that is about to be written
+ *
+ * the data must hold ambix->channels channels; integer data is normalized
+ *
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @param data the interleaved samples as passed to the backend
+ * @param frames number of sample frames
+ */
+void _ambix_peaks_track_float32(ambix_t*ambix, const float32_t*data, int64_t frames);
+/* @see _ambix_peaks_track_float32 */
+void _ambix_peaks_track_float64(ambix_t*ambix, const float64_t*data, int64_t frames);
+/* @see _ambix_peaks_track_float32 */
+void _ambix_peaks_track_int32(ambix_t*ambix, const int32_t*data, int64_t frames);
+/* @see _ambix_peaks_track_float32 */
+void _ambix_peaks_track_int16(ambix_t*ambix, const int16_t*data, int64_t frames);
+/** @brief update the peaks with packed 24bit data (in host byte order)
+ * @see _ambix_peaks_track_float32
+ */
+void _ambix_peaks_track_pcm24(ambix_t*ambix, const unsigned char*data, int64_t frames);
+/** @brief free resources allocated for the waveform overview
+ * @param ambix a pointer to a valid ambix structure
+ */
+void _ambix_overview_deinit(ambix_t*ambix);
+/** @brief update the waveform overview with (interleaved) data that is about to be written
+ *
+ * the data must hold ambix->channels channels; integer data is normalized
+ *
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @param data the interleaved samples as passed to the backend
+ * @param frames number of sample frames
+ */
+void _ambix_overview_track_float32(ambix_t*ambix, const float32_t*data, int64_t frames);
+/* @see _ambix_overview_track_float32 */
+void _ambix_overview_track_float64(ambix_t*ambix, const float64_t*data, int64_t frames);
+/* @see _ambix_overview_track_float32 */
+void _ambix_overview_track_int32(ambix_t*ambix, const int32_t*data, int64_t frames);
+/* @see _ambix_overview_track_float32 */
+void _ambix_overview_track_int16(ambix_t*ambix, const int16_t*data, int64_t frames);
+/** @brief update the waveform overview with raw integer PCM data
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @param data the interleaved raw samples
+ * @param samplebytes the number of bytes per sample (2=PCM16, 3=PCM24)
+ * @param bigendian whether the raw samples are in big-endian byte order
+ * @param frames number of sample frames
+ */
+void _ambix_overview_track_pcm(ambix_t*ambix, const unsigned char*data, uint32_t samplebytes, int bigendian, int64_t frames);
+/** @brief write the waveform overview as a chunk
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_overview_write(ambix_t*ambix);
+/** @brief finish an in-memory file
+ *
+ * (when writing) hands the buffer over to the user; frees the memory handle
+ *
+ * @param ambix a pointer to a valid ambix structure (after the backend has been closed)
+ */
+void _ambix_memory_close(ambix_t*ambix);
+/** @brief open a file for unbuffered writing (AMBIX_DIRECT)
+ *
+ * @param path filename of the file to open
+ * @param mode the mode to open the file with (without AMBIX_DIRECT)
+ * @param ambixinfo as with ambix_open()
+ * @return A handle to the opened file (or NULL on failure)
+ */
+ambix_t*_ambix_open_direct(const char*path, const ambix_filemode_t mode, ambix_info_t*ambixinfo);
+/** @brief finish an unbuffered file
+ *
+ * writes the remaining data to disk and frees the handle
+ *
+ * @param ambix a pointer to a valid ambix structure (after the backend has been closed)
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_direct_close(ambix_t*ambix);
+/** @brief reserve disk space beyond the end of an unbuffered file
+ * @param ambix a pointer to a valid ambix structure opened with AMBIX_DIRECT
+ * @param bytes number of bytes to reserve
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_direct_reserve(ambix_t*ambix, int64_t bytes);
+/** @brief preallocate disk space for a file, without changing its size
+ * @param fd a file descriptor opened for writing
+ * @param offset where the reserved space starts (usually the end of the file)
+ * @param bytes number of bytes to reserve
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_preallocate(int fd, int64_t offset, int64_t bytes);
+/** @brief count written frames, and update the header if a checkpoint is due
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @param frames number of sample frames that have just been written
+ */
+void _ambix_checkpoint_track(ambix_t*ambix, int64_t frames);
+/** @brief cancel all pending asynchronous reads and free their resources
+ * @param ambix a pointer to a valid ambix structure
+ */
+void _ambix_async_deinit(ambix_t*ambix);
+/** @brief free resources allocated for the directional energy index
+ * @param ambix a pointer to a valid ambix structure
+ */
+void _ambix_direction_deinit(ambix_t*ambix);
+/** @brief update the directional energy index with (interleaved) data that is about to be written
+ *
+ * the data must hold ambix->channels channels (starting with the ambisonics channels as stored in the file)
+ *
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @param data the interleaved samples as passed to the backend
+ * @param frames number of sample frames
+ */
+void _ambix_direction_track_float32(ambix_t*ambix, const float32_t*data, int64_t frames);
+/* @see _ambix_direction_track_float32 */
+void _ambix_direction_track_float64(ambix_t*ambix, const float64_t*data, int64_t frames);
+/* @see _ambix_direction_track_float32 */
+void _ambix_direction_track_int32(ambix_t*ambix, const int32_t*data, int64_t frames);
+/* @see _ambix_direction_track_float32 */
+void _ambix_direction_track_int16(ambix_t*ambix, const int16_t*data, int64_t frames);
+/** @brief update the directional energy index with raw integer PCM data
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @param data the interleaved raw samples
+ * @param samplebytes the number of bytes per sample (2=PCM16, 3=PCM24)
+ * @param bigendian whether the raw samples are in big-endian byte order
+ * @param frames number of sample frames
+ */
+void _ambix_direction_track_pcm(ambix_t*ambix, const unsigned char*data, uint32_t samplebytes, int bigendian, int64_t frames);
+/** @brief write the directional energy index as a chunk
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_direction_write(ambix_t*ambix);
+/** @brief write the tracked peaks as a PEAK chunk
+ * @param ambix a pointer to a valid ambix structure opened for writing
+ * @return errorcode indicating success
+ */
+ambix_err_t _ambix_peaks_write(ambix_t*ambix);
+/** @brief free resources allocated for peaks and the matrix plan
+ * @param ambix a pointer to a valid ambix structure
+ */
+void _ambix_peaks_deinit(ambix_t*ambix);
+/** @brief get a plan for applying the adaptor matrix that skips silent channels
+ *
+ * the plan is (re)computed if the peaks or the matrix have changed
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param matrix the adaptor matrix that is going to be applied
+ * @return the plan, or NULL if no channels can be skipped (or the peaks are unknown)
+ */
+const ambix_matrixplan_t*_ambix_get_matrixplan(ambix_t*ambix, const ambix_matrix_t*matrix);
+
+/** @brief merge interleaved ambisonics and non-ambisonics channels into raw integer PCM data
+ *
+ * this is the same as _ambix_mergeAdaptormatrix_float32() (or
+ * _ambix_mergeAdaptor_float32() if matrix is NULL), but dithers, quantizes
+ * and packs the samples into raw PCM16/PCM24 data in the same pass.
+ * clipped samples are counted in ambix_t::clipcount.
+ *
+ * @param ambix a pointer to a valid ambix structure (holding the dither state)
+ * @param ambidata the interleaved ambisonics channels
+ * @param matrix the encoder-matrix (or NULL)
+ * @param ambichannels the number of ambisonics channels (if matrix is NULL)
+ * @param otherdata the interleaved non-ambisonics channels
+ * @param otherchannels the number of non-ambisonics channels
+ * @param destination the raw samplebuffer; must be big enough to hold frames*channels*samplebytes bytes
+ * @param samplebytes the number of bytes per sample (2=PCM16, 3=PCM24)
+ * @param bigendian whether the raw samples should be in big-endian byte order
+ * @param frames number of frames to merge
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_mergeAdaptor_quantize_float32(ambix_t*ambix, const float32_t*ambidata, const ambix_matrix_t*matrix, uint32_t ambichannels, const float32_t*otherdata, uint32_t otherchannels, void*destination, uint32_t samplebytes, int bigendian, int64_t frames);
+/* @see _ambix_mergeAdaptor_quantize_float32 */
+ambix_err_t _ambix_mergeAdaptor_quantize_float64(ambix_t*ambix, const float64_t*ambidata, const ambix_matrix_t*matrix, uint32_t ambichannels, const float64_t*otherdata, uint32_t otherchannels, void*destination, uint32_t samplebytes, int bigendian, int64_t frames);
+
 /** @brief byte-swap 32bit data
  * @param n a 32bit chunk in the wrong byte order
  * @return byte-swapped data
  */
 static inline uint32_t swap4(uint32_t n)
 {
+#if defined __GNUC__
+  return __builtin_bswap32(n);
+#else
   return (((n & 0xff) << 24) | ((n & 0xff00) << 8) |
           ((n & 0xff0000) >> 8) | ((n & 0xff000000) >> 24));
+#endif
 }
 /** @brief byte-swap 64bit data
  * @param n a 64bit chunk in the wrong byte order
@@ -356,6 +824,9 @@ static inline uint32_t swap4(uint32_t n)
  */
 static inline uint64_t swap8(uint64_t n)
 {
+#if defined __GNUC__
+  return __builtin_bswap64(n);
+#else
   return ((((n) & 0xff00000000000000ull) >> 56) |
           (((n) & 0x00ff000000000000ull) >> 40) |
           (((n) & 0x0000ff0000000000ull) >> 24) |
@@ -364,7 +835,177 @@ static inline uint64_t swap8(uint64_t n)
           (((n) & 0x0000000000ff0000ull) << 24) |
           (((n) & 0x000000000000ff00ull) << 40) |
           (((n) & 0x00000000000000ffull) << 56));
+#endif
+}
+/** @brief check the byte order of the host
+ * @return TRUE if the host is big-endian
+ */
+static inline int _ambix_is_bigendian(void)
+{
+  const union { uint32_t i; unsigned char c[4]; } u = { 0x01020304 };
+  return (0x01 == u.c[0]);
 }
+/** @brief whether denormals should be flushed to zero during processing
+ * @see ambix_set_flush_denormals
+ */
+extern int _ambix_flush_denormals;
+
+/** @brief saved floating point control state */
+typedef struct _ambix_fpstate {
+  /** whether the state has been changed (and needs to be restored) */
+  int changed;
+  /** the original control register */
+  unsigned long state;
+} ambix_fpstate_t;
+/** @brief enable flush-to-zero (and denormals-are-zero) for the current thread
+ *
+ * denormal numbers (e.g. in decaying reverb tails) can make floating point
+ * operations orders of magnitude slower.
+ * this sets the FTZ/DAZ bits (x86) resp. the FZ bit (ARM) of the current
+ * thread, until _ambix_denormals_restore() is called.
+ * does nothing if disabled with ambix_set_flush_denormals().
+ *
+ * @param fp storage for the previous state
+ */
+static inline void _ambix_denormals_protect(ambix_fpstate_t*fp) {
+  fp->changed=0;
+  fp->state=0;
+  if(!_ambix_flush_denormals)
+    return;
+#if defined AMBIX_HAVE_MXCSR
+  fp->state=_mm_getcsr();
+  /* FTZ (bit 15) and DAZ (bit 6) */
+  if((fp->state & 0x8040) != 0x8040) {
+    _mm_setcsr((unsigned int)(fp->state | 0x8040));
+    fp->changed=1;
+  }
+#elif defined __GNUC__ && defined __aarch64__
+  do {
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    fp->state=(unsigned long)fpcr;
+    /* FZ (bit 24) */
+    if(!(fpcr & (1<<24))) {
+      __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1<<24)));
+      fp->changed=1;
+    }
+  } while(0);
+#elif defined __GNUC__ && defined __arm__ && defined __ARM_FP
+  do {
+    uint32_t fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    fp->state=(unsigned long)fpscr;
+    /* FZ (bit 24) */
+    if(!(fpscr & (1<<24))) {
+      __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr | (1<<24)));
+      fp->changed=1;
+    }
+  } while(0);
+#endif
+}
+/** @brief restore the floating point state saved by _ambix_denormals_protect()
+ * @param fp the previous state
+ */
+static inline void _ambix_denormals_restore(const ambix_fpstate_t*fp) {
+  if(!fp->changed)
+    return;
+#if defined AMBIX_HAVE_MXCSR
+  _mm_setcsr((unsigned int)fp->state);
+#elif defined __GNUC__ && defined __aarch64__
+  __asm__ __volatile__("msr fpcr, %0" : : "r"((uint64_t)fp->state));
+#elif defined __GNUC__ && defined __arm__ && defined __ARM_FP
+  __asm__ __volatile__("vmsr fpscr, %0" : : "r"((uint32_t)fp->state));
+#endif
+}
+
+/** @brief force inlining of kernels that are specialized via constant arguments */
+#if defined __GNUC__
+# define AMBIX_ALWAYS_INLINE static inline __attribute__((always_inline))
+#else
+# define AMBIX_ALWAYS_INLINE static inline
+#endif
+/** @brief dispatch to a kernel specialized for a given channel count
+ *
+ * evaluates (and returns) 'expr' with 'N' being a compile-time constant for
+ * common channel counts: the full 3D sets up to 7th order (4, 9, 16, 25, 36,
+ * 49, 64) and the FuMa mixed-order sets (3, 5, 6, 7, 8, 11).
+ * if 'expr' calls an AMBIX_ALWAYS_INLINE kernel that uses 'N' as loop bound,
+ * the compiler can unroll the loops and keep accumulators in registers.
+ * other channel counts use the generic (non-constant) case.
+ */
+#define AMBIX_DISPATCH_CHANNELS(channels, N, expr)      \
+  switch(channels) {                                    \
+  case  3: { const uint32_t N= 3; return expr; }        \
+  case  4: { const uint32_t N= 4; return expr; }        \
+  case  5: { const uint32_t N= 5; return expr; }        \
+  case  6: { const uint32_t N= 6; return expr; }        \
+  case  7: { const uint32_t N= 7; return expr; }        \
+  case  8: { const uint32_t N= 8; return expr; }        \
+  case  9: { const uint32_t N= 9; return expr; }        \
+  case 11: { const uint32_t N=11; return expr; }        \
+  case 16: { const uint32_t N=16; return expr; }        \
+  case 25: { const uint32_t N=25; return expr; }        \
+  case 36: { const uint32_t N=36; return expr; }        \
+  case 49: { const uint32_t N=49; return expr; }        \
+  case 64: { const uint32_t N=64; return expr; }        \
+  default: { const uint32_t N=(channels); return expr; } \
+  }
+/** @brief dispatch to a kernel specialized for two channel counts
+ *
+ * like AMBIX_DISPATCH_CHANNELS(), but if both channel counts are the same
+ * (e.g. square matrices for rotations or channel reordering), 'A' and 'B' are
+ * both compile-time constants for the common sizes.
+ * otherwise only 'A' is specialized (so it should be the dimension of the
+ * innermost loop), and 'B' is generic.
+ */
+#define AMBIX_DISPATCH_CHANNELS2(a, b, A, B, expr)              \
+  if((a)==(b)) {                                                \
+    switch(a) {                                                 \
+    case  3: { const uint32_t A= 3, B= 3; return expr; }        \
+    case  4: { const uint32_t A= 4, B= 4; return expr; }        \
+    case  5: { const uint32_t A= 5, B= 5; return expr; }        \
+    case  6: { const uint32_t A= 6, B= 6; return expr; }        \
+    case  7: { const uint32_t A= 7, B= 7; return expr; }        \
+    case  8: { const uint32_t A= 8, B= 8; return expr; }        \
+    case  9: { const uint32_t A= 9, B= 9; return expr; }        \
+    case 11: { const uint32_t A=11, B=11; return expr; }        \
+    case 16: { const uint32_t A=16, B=16; return expr; }        \
+    case 25: { const uint32_t A=25, B=25; return expr; }        \
+    case 36: { const uint32_t A=36, B=36; return expr; }        \
+    case 49: { const uint32_t A=49, B=49; return expr; }        \
+    case 64: { const uint32_t A=64, B=64; return expr; }        \
+    default: break;                                             \
+    }                                                           \
+  }                                                             \
+  {                                                             \
+    const uint32_t B=(b);                                       \
+    AMBIX_DISPATCH_CHANNELS(a, A, expr);                        \
+  }
+
+/** @brief convert the (double precision) result of a multiplication to the sample type;
+ * integers are saturated */
+static inline float32_t _ambix_mtxmul_convert_float32(float64_t v) {
+  return (float32_t)v;
+}
+static inline float64_t _ambix_mtxmul_convert_float64(float64_t v) {
+  return v;
+}
+static inline int32_t _ambix_mtxmul_convert_int32(float64_t v) {
+  if(v >=  2147483647.) return  2147483647;
+  if(v <= -2147483648.) return (-2147483647-1);
+  return (int32_t)v;
+}
+static inline int16_t _ambix_mtxmul_convert_int16(float64_t v) {
+  if(v >=  32767.) return  32767;
+  if(v <= -32768.) return -32768;
+  return (int16_t)v;
+}
+
+/** @brief byte-swap arrays of 16bit data
+ * @param data a pointer to an array of 16bit data to be byteswapped
+ * @param datasize the size of the array
+ */
+void _ambix_swap2array(uint16_t*data, uint64_t datasize);
 /** @brief byte-swap arrays of 32bit data
  * @param data a pointer to an array of 32bit data to be byteswapped
  * @param datasize the size of the array
@@ -375,6 +1016,22 @@ void _ambix_swap4array(uint32_t*data, uint64_t datasize);
  * @param datasize the size of the array
  */
 void _ambix_swap8array(uint64_t*data, uint64_t datasize);
+/** @brief byte-swap arrays of packed 24bit data
+ * @param data a pointer to an array of 24bit (3 byte) data to be byteswapped
+ * @param datasize the size of the array (in samples)
+ */
+void _ambix_swap3array(unsigned char*data, uint64_t datasize);
+/** @brief byte-swap arrays of samples
+ * @param data a pointer to an array of raw samples to be byteswapped
+ * @param samplebytes the size of a single sample (2, 3, 4 or 8 bytes)
+ * @param samples the number of samples in the array
+ */
+void _ambix_swaparray(void*data, uint32_t samplebytes, uint64_t samples);
+/** @brief get the size of a single sample
+ * @param format the sampleformat
+ * @return number of bytes per sample as stored in the file (or 0 if unknown)
+ */
+uint32_t _ambix_samplebytes(ambix_sampleformat_t format);
 
 /** @brief resize adaptor buffer to given size
  *
@@ -442,6 +1099,145 @@ ambix_err_t _ambix_splitAdaptormatrix_int32(const int32_t*source, uint32_t sourc
 /* @see _ambix_splitAdaptormatrix_float32 */
 ambix_err_t _ambix_splitAdaptormatrix_int16(const int16_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, int16_t*dest_ambi, int16_t*dest_other, int64_t frames);
 
+/** @brief extract ambisonics and non-ambisonics channels from interleaved data using a reduced matrix
+ *
+ * this is the same as _ambix_splitAdaptormatrix_float32(), but only uses the
+ * rows and columns of the plan: source channels that are not in the plan are
+ * known to be silent, and ambisonics channels that are not in the plan are
+ * set to zero.
+ *
+ * @param source the interleaved samplebuffer to read from
+ * @param sourcechannels the number of channels in the source
+ * @param rawambichannels the number of ambisonics channels in the source
+ * @param plan the reduced adaptor matrix
+ * @param fullambichannels the number of ambisonics channels to extract
+ * @param dest_ambi the ambisonics channels (interleaved)
+ * @param dest_other the non-ambisonics channels (interleaved)
+ * @param frames number of frames to extract
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_splitAdaptorplan_float32(const float32_t*source, uint32_t sourcechannels, uint32_t rawambichannels, const ambix_matrixplan_t*plan, uint32_t fullambichannels, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_float32 */
+ambix_err_t _ambix_splitAdaptorplan_float64(const float64_t*source, uint32_t sourcechannels, uint32_t rawambichannels, const ambix_matrixplan_t*plan, uint32_t fullambichannels, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_float32 */
+ambix_err_t _ambix_splitAdaptorplan_int32(const int32_t*source, uint32_t sourcechannels, uint32_t rawambichannels, const ambix_matrixplan_t*plan, uint32_t fullambichannels, int32_t*dest_ambi, int32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_float32 */
+ambix_err_t _ambix_splitAdaptorplan_int16(const int16_t*source, uint32_t sourcechannels, uint32_t rawambichannels, const ambix_matrixplan_t*plan, uint32_t fullambichannels, int16_t*dest_ambi, int16_t*dest_other, int64_t frames);
+
+/** @brief multi-threaded variant of _ambix_splitAdaptormatrix_float32()
+ *
+ * for large blocks, the frames are distributed among the worker pool.
+ * if a plan is given, _ambix_splitAdaptorplan_float32() is used instead.
+ * @see ambix_set_num_threads
+ */
+ambix_err_t _ambix_splitAdaptormatrix_mt_float32(const float32_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptormatrix_mt_float32 */
+ambix_err_t _ambix_splitAdaptormatrix_mt_float64(const float64_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptormatrix_mt_float32 */
+ambix_err_t _ambix_splitAdaptormatrix_mt_int32(const int32_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, int32_t*dest_ambi, int32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptormatrix_mt_float32 */
+ambix_err_t _ambix_splitAdaptormatrix_mt_int16(const int16_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, int16_t*dest_ambi, int16_t*dest_other, int64_t frames);
+
+/** @brief extract ambisonics and non-ambisonics channels from raw integer PCM data using matrix operations
+ *
+ * this is the same as _ambix_splitAdaptormatrix_float32(), but decodes the
+ * raw samples on the fly, so no intermediate buffer with converted samples
+ * is needed.
+ * integer samples are normalized to [-1..+1) like libsndfile does.
+ *
+ * @param source the interleaved raw samplebuffer (in native byte order) to read from
+ * @param samplebytes the number of bytes per sample (2=PCM16, 3=PCM24)
+ * @param sourcechannels the number of channels in the source
+ * @param matrix the adaptor matrix
+ * @param dest_ambi the ambisonics channels (interleaved)
+ * @param dest_other the non-ambisonics channels (interleaved)
+ * @param frames number of frames to extract
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_splitAdaptormatrix_pcm_float32(const void*source, uint32_t samplebytes, uint32_t sourcechannels, const ambix_matrix_t*matrix, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptormatrix_pcm_float32 */
+ambix_err_t _ambix_splitAdaptormatrix_pcm_float64(const void*source, uint32_t samplebytes, uint32_t sourcechannels, const ambix_matrix_t*matrix, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+/** @brief extract ambisonics and non-ambisonics channels from raw integer PCM data using a reduced matrix
+ * @see _ambix_splitAdaptormatrix_pcm_float32
+ * @see _ambix_splitAdaptorplan_float32
+ */
+ambix_err_t _ambix_splitAdaptorplan_pcm_float32(const void*source, uint32_t samplebytes, uint32_t sourcechannels, uint32_t rawambichannels, const ambix_matrixplan_t*plan, uint32_t fullambichannels, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_pcm_float32 */
+ambix_err_t _ambix_splitAdaptorplan_pcm_float64(const void*source, uint32_t samplebytes, uint32_t sourcechannels, uint32_t rawambichannels, const ambix_matrixplan_t*plan, uint32_t fullambichannels, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+/** @brief multi-threaded variant of _ambix_splitAdaptormatrix_pcm_float32()
+ *
+ * if a plan is given, _ambix_splitAdaptorplan_pcm_float32() is used instead.
+ * raw samples that are not in native byte order (see the bigendian flag)
+ * are byte-swapped in place first.
+ */
+ambix_err_t _ambix_splitAdaptormatrix_pcm_mt_float32(void*source, uint32_t samplebytes, int bigendian, uint32_t sourcechannels, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptormatrix_pcm_mt_float32 */
+ambix_err_t _ambix_splitAdaptormatrix_pcm_mt_float64(void*source, uint32_t samplebytes, int bigendian, uint32_t sourcechannels, const ambix_matrix_t*matrix, const ambix_matrixplan_t*plan, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+
+
+/** @brief extract an arbitrary subset of channels from interleaved data
+ *
+ * pick the requested (presented) channels from the source, multiplying only
+ * those rows of the matrix that are actually requested.
+ * channel indices [0..matrix.rows) denote the (decoded) ambisonics channels,
+ * channel indices [matrix.rows..) denote the non-ambisonics channels.
+ * if matrix is NULL, the channel indices map directly to the source channels.
+ * the channel indices must have been validated by the caller.
+ *
+ * @param source the interleaved samplebuffer to read from
+ * @param sourcechannels the number of channels in the source
+ * @param matrix the adaptor matrix (or NULL)
+ * @param channels the indices of the channels to extract
+ * @param numchannels the number of channels to extract
+ * @param dest the selected channels (interleaved)
+ * @param frames number of frames to extract
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_splitAdaptorchannels_float32(const float32_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const uint32_t*channels, uint32_t numchannels, float32_t*dest, int64_t frames);
+/* @see _ambix_splitAdaptorchannels_float32 */
+ambix_err_t _ambix_splitAdaptorchannels_float64(const float64_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const uint32_t*channels, uint32_t numchannels, float64_t*dest, int64_t frames);
+/* @see _ambix_splitAdaptorchannels_float32 */
+ambix_err_t _ambix_splitAdaptorchannels_int32(const int32_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const uint32_t*channels, uint32_t numchannels, int32_t*dest, int64_t frames);
+/* @see _ambix_splitAdaptorchannels_float32 */
+ambix_err_t _ambix_splitAdaptorchannels_int16(const int16_t*source, uint32_t sourcechannels, const ambix_matrix_t*matrix, const uint32_t*channels, uint32_t numchannels, int16_t*dest, int64_t frames);
+
+/** @brief get the routing described by a matrix
+ *
+ * a routing matrix has at most a single non-zero element in each row, which
+ * must be 1. such a matrix (e.g. a permutation matrix) can be applied by
+ * simply copying samples, without doing any arithmetics.
+ *
+ * @param matrix the matrix to analyse
+ * @param route an array of matrix.rows elements that is filled with the
+ *        column each row copies from (or -1 if the row is all zero)
+ * @return TRUE if the matrix describes a routing, FALSE otherwise
+ */
+int _ambix_matrix_get_routing(const ambix_matrix_t*matrix, int32_t*route);
+/** @brief (re)compute the cached routing of the active adaptor matrix
+ *
+ * must be called whenever the adaptor matrix in use changes
+ *
+ * @param ambix the handle to update the ambix->route of
+ */
+void _ambix_update_routing(ambix_t*ambix);
+
+/** @brief extract ambisonics and non-ambisonics channels from interleaved packed 24bit data
+ *
+ * the samples are copied as they are (so any byte order will do)
+ *
+ * @param source the interleaved samplebuffer to read from
+ * @param sourcechannels the number of channels in the source
+ * @param rawambichannels the number of ambisonics channels in the source
+ * @param route the routing (as returned by _ambix_matrix_get_routing()) to
+ *        apply to the ambisonics channels, or NULL
+ * @param ambichannels the number of ambisonics channels to extract (the
+ *        number of elements in route)
+ * @param dest_ambi the ambisonics channels (interleaved)
+ * @param dest_other the non-ambisonics channels (interleaved)
+ * @param frames number of frames to extract
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_splitAdaptor_pcm24(const unsigned char*source, uint32_t sourcechannels, uint32_t rawambichannels, const int32_t*route, uint32_t ambichannels, unsigned char*dest_ambi, unsigned char*dest_other, int64_t frames);
 
 /** @brief merge two separate interleaved (32bit floating point) audio data blocks into one
  *
@@ -469,6 +1265,24 @@ ambix_err_t _ambix_mergeAdaptor_int32(const int32_t*source1, uint32_t source1cha
  */
 ambix_err_t _ambix_mergeAdaptor_int16(const int16_t*source1, uint32_t source1channels, const int16_t*source2, uint32_t source2channels, int16_t*destination, int64_t frames);
 
+/** @brief merge interleaved ambisonics and non-ambisonics packed 24bit data into one
+ *
+ * the samples are copied as they are (so any byte order will do)
+ *
+ * @param ambidata the interleaved ambisonics channels
+ * @param fullambichannels the number of channels in ambidata
+ * @param route the routing (as returned by _ambix_matrix_get_routing()) to
+ *        apply to the ambisonics channels, or NULL
+ * @param ambixchannels the number of ambisonics channels to write (the number
+ *        of elements in route)
+ * @param otherdata the interleaved non-ambisonics channels
+ * @param otherchannels the number of non-ambisonics channels
+ * @param destination the samplebuffer to merge the data into; must be big
+ *        enough to hold frames*(ambixchannels+otherchannels) samples
+ * @param frames number of frames to merge
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_mergeAdaptor_pcm24(const unsigned char*ambidata, uint32_t fullambichannels, const int32_t*route, uint32_t ambixchannels, const unsigned char*otherdata, uint32_t otherchannels, unsigned char*destination, int64_t frames);
 
 /** @brief merge interleaved ambisonics and interleaved non-ambisonics channels into a single interleaved audio data block using matrix operations
  *
@@ -491,6 +1305,18 @@ ambix_err_t _ambix_mergeAdaptormatrix_float64(const float64_t*source1, const amb
 ambix_err_t _ambix_mergeAdaptormatrix_int32(const int32_t*source1, const ambix_matrix_t*matrix, const int32_t*source2, uint32_t source2channels, int32_t*destination, int64_t frames);
 /* @see _ambix_mergeAdaptormatrix_float32 */
 ambix_err_t _ambix_mergeAdaptormatrix_int16(const int16_t*source1, const ambix_matrix_t*matrix, const int16_t*source2, uint32_t source2channels, int16_t*destination, int64_t frames);
+/** @brief multi-threaded variant of _ambix_mergeAdaptormatrix_float32()
+ *
+ * for large blocks, the frames are distributed among the worker pool
+ * @see ambix_set_num_threads
+ */
+ambix_err_t _ambix_mergeAdaptormatrix_mt_float32(const float32_t*source1, const ambix_matrix_t*matrix, const float32_t*source2, uint32_t source2channels, float32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptormatrix_mt_float32 */
+ambix_err_t _ambix_mergeAdaptormatrix_mt_float64(const float64_t*source1, const ambix_matrix_t*matrix, const float64_t*source2, uint32_t source2channels, float64_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptormatrix_mt_float32 */
+ambix_err_t _ambix_mergeAdaptormatrix_mt_int32(const int32_t*source1, const ambix_matrix_t*matrix, const int32_t*source2, uint32_t source2channels, int32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptormatrix_mt_float32 */
+ambix_err_t _ambix_mergeAdaptormatrix_mt_int16(const int16_t*source1, const ambix_matrix_t*matrix, const int16_t*source2, uint32_t source2channels, int16_t*destination, int64_t frames);
 
 
 /** @brief debugging printout for ambix_info_t
@@ -0,0 +1,79 @@
+/* reserve.c -  preallocate disk space              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/* fallocate() is a GNU extension */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include "private.h"
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <errno.h>
+
+/* the space is reserved beyond the end of the file, without changing its size
+ * (libsndfile does not know about the reservation, and would otherwise leave
+ * it behind as garbage after the last chunk).
+ * truncating the file to its own size when closing releases whatever was not
+ * used.
+ */
+
+ambix_err_t _ambix_preallocate(int fd, int64_t offset, int64_t bytes) {
+#if defined HAVE_FALLOCATE && defined FALLOC_FL_KEEP_SIZE
+  int err;
+  do {
+    err=fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)offset, (off_t)bytes);
+  } while(err && EINTR==errno);
+  return err?AMBIX_ERR_UNKNOWN:AMBIX_ERR_SUCCESS;
+#elif defined F_PREALLOCATE
+  /* allocates from the physical end of the file */
+  fstore_t store={F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)bytes, 0};
+  if(-1!=fcntl(fd, F_PREALLOCATE, &store))
+    return AMBIX_ERR_SUCCESS;
+  store.fst_flags=F_ALLOCATEALL;
+  return (-1!=fcntl(fd, F_PREALLOCATE, &store))?AMBIX_ERR_SUCCESS:AMBIX_ERR_UNKNOWN;
+#else
+  return AMBIX_ERR_UNKNOWN;
+#endif
+}
+
+ambix_err_t ambix_reserve(ambix_t*ambix, int64_t frames) {
+  int64_t bytes;
+  if(NULL==ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!(ambix->filemode & AMBIX_WRITE) || (ambix->filemode & AMBIX_STREAM))
+    return AMBIX_ERR_INVALID_FILE;
+  if(frames<0)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  bytes=frames*ambix->channels*_ambix_samplebytes(ambix->realinfo.sampleformat);
+  if(bytes<1)
+    return AMBIX_ERR_SUCCESS;
+  if(ambix->direct)
+    return _ambix_direct_reserve(ambix, bytes);
+  return _ambix_reserve(ambix, bytes);
+}
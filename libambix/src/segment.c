@@ -0,0 +1,320 @@
+/* segment.c -  segmented recording              -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#ifdef HAVE_PTHREADS
+# include <pthread.h>
+#endif /* HAVE_PTHREADS */
+
+/* a segmented file is a sequence of ordinary ambix files.
+ * a worker thread opens the next segment ahead of time and finalizes the
+ * segments that are full, so the writing thread only ever swaps handles
+ * (it only has to wait if the worker has not managed to open the next segment
+ * by the time the current one is full).
+ */
+
+struct ambix_segmented_t_struct {
+  /** filename pattern (with a single integer conversion for the index) */
+  char*pattern;
+  ambix_filemode_t mode;
+  ambix_info_t info;
+  /** the adaptor matrix written into each segment (or NULL) */
+  ambix_matrix_t*matrix;
+  /** maximum number of sample frames per segment */
+  int64_t segmentframes;
+
+  /** the segment being written, and the number of frames written to it */
+  ambix_t*current;
+  int64_t written;
+  /** index of the current segment */
+  uint32_t index;
+
+  /** the next segment (opened ahead of time), or NULL */
+  ambix_t*next;
+  /** whether opening the next segment failed */
+  int nextfailed;
+  /** a full segment waiting to be finalized, or NULL */
+  ambix_t*retired;
+  /** the first error that occurred while finalizing a segment */
+  ambix_err_t error;
+#ifdef HAVE_PTHREADS
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int running;
+  int quit;
+#endif /* HAVE_PTHREADS */
+};
+
+/* the pattern must contain exactly one integer conversion (and no other) */
+static int segment_checkpattern(const char*pattern) {
+  int conversions=0;
+  const char*s;
+  for(s=pattern; *s; s++) {
+    if('%'!=*s)
+      continue;
+    s++;
+    if('%'==*s)
+      continue;
+    while(*s && strchr("-0+ ", *s))
+      s++;
+    while(*s>='0' && *s<='9')
+      s++;
+    if('d'!=*s && 'i'!=*s && 'u'!=*s)
+      return 0;
+    conversions++;
+  }
+  return (1==conversions);
+}
+
+/* the filename of a segment (to be freed by the caller) */
+static char*segment_path(ambix_segmented_t*seg, uint32_t index) {
+  char*path;
+  int len=snprintf(NULL, 0, seg->pattern, index);
+  if(len<0)
+    return NULL;
+  path=(char*)malloc(len+1);
+  if(path)
+    snprintf(path, len+1, seg->pattern, index);
+  return path;
+}
+
+static ambix_t*segment_open(ambix_segmented_t*seg, uint32_t index) {
+  ambix_info_t info;
+  ambix_t*ambix;
+  char*path=segment_path(seg, index);
+  if(!path)
+    return NULL;
+  memcpy(&info, &seg->info, sizeof(info));
+  ambix=ambix_open(path, seg->mode, &info);
+  free(path);
+  if(!ambix)
+    return NULL;
+  if(seg->matrix && AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, seg->matrix)) {
+    ambix_close(ambix);
+    return NULL;
+  }
+  /* a segment is always filled completely (except for the last one) */
+  if(seg->segmentframes>0 && seg->segmentframes<INT64_MAX)
+    ambix_reserve(ambix, seg->segmentframes);
+  return ambix;
+}
+static void segment_finalize(ambix_segmented_t*seg, ambix_t*ambix) {
+  ambix_err_t err=ambix_close(ambix);
+  if(AMBIX_ERR_SUCCESS!=err && AMBIX_ERR_SUCCESS==seg->error)
+    seg->error=err;
+}
+/* close a segment that was never written to, and remove its file */
+static void segment_discard(ambix_segmented_t*seg, ambix_t*ambix, uint32_t index) {
+  char*path=segment_path(seg, index);
+  ambix_close(ambix);
+  if(path)
+    remove(path);
+  free(path);
+}
+
+#ifdef HAVE_PTHREADS
+static void*segment_thread(void*userdata) {
+  ambix_segmented_t*seg=(ambix_segmented_t*)userdata;
+  pthread_mutex_lock(&seg->mutex);
+  while(!seg->quit) {
+    if(seg->retired) {
+      ambix_t*ambix=seg->retired;
+      seg->retired=NULL;
+      pthread_mutex_unlock(&seg->mutex);
+      segment_finalize(seg, ambix);
+      pthread_mutex_lock(&seg->mutex);
+    } else if(!seg->next && !seg->nextfailed) {
+      const uint32_t index=seg->index+1;
+      ambix_t*ambix;
+      pthread_mutex_unlock(&seg->mutex);
+      ambix=segment_open(seg, index);
+      pthread_mutex_lock(&seg->mutex);
+      seg->next=ambix;
+      seg->nextfailed=(NULL==ambix);
+      pthread_cond_broadcast(&seg->cond);
+    } else
+      pthread_cond_wait(&seg->cond, &seg->mutex);
+  }
+  pthread_mutex_unlock(&seg->mutex);
+  return NULL;
+}
+#endif /* HAVE_PTHREADS */
+
+/* switch to the next segment */
+static int segment_rollover(ambix_segmented_t*seg) {
+  ambix_t*next=NULL;
+#ifdef HAVE_PTHREADS
+  if(seg->running) {
+    pthread_mutex_lock(&seg->mutex);
+    while(!seg->next && !seg->nextfailed)
+      pthread_cond_wait(&seg->cond, &seg->mutex);
+    next=seg->next;
+    if(next) {
+      seg->retired=seg->current;
+      seg->current=next;
+      seg->next=NULL;
+      seg->index++;
+      seg->written=0;
+      pthread_cond_broadcast(&seg->cond);
+    }
+    pthread_mutex_unlock(&seg->mutex);
+    return (NULL!=next);
+  }
+#endif /* HAVE_PTHREADS */
+  next=segment_open(seg, seg->index+1);
+  if(!next)
+    return 0;
+  segment_finalize(seg, seg->current);
+  seg->current=next;
+  seg->index++;
+  seg->written=0;
+  return 1;
+}
+
+ambix_segmented_t*ambix_segmented_open(const char*pattern, const ambix_filemode_t mode, const ambix_info_t*ambixinfo,
+                                       const ambix_matrix_t*matrix, int64_t maxframes, int64_t maxbytes) {
+  ambix_segmented_t*seg=NULL;
+  int64_t framesize;
+  if(!pattern || !segment_checkpattern(pattern))
+    return NULL;
+  if(!(mode & AMBIX_WRITE) || (mode & (AMBIX_READ | AMBIX_STREAM)))
+    return NULL;
+  if(maxframes<0 || maxbytes<0)
+    return NULL;
+
+  seg=(ambix_segmented_t*)calloc(1, sizeof(*seg));
+  if(!seg)
+    return NULL;
+  seg->mode=mode;
+  memcpy(&seg->info, ambixinfo, sizeof(seg->info));
+  seg->info.frames=0;
+  seg->pattern=(char*)malloc(strlen(pattern)+1);
+  if(matrix)
+    seg->matrix=ambix_matrix_copy(matrix, NULL);
+  if(!seg->pattern || (matrix && !seg->matrix)) {
+    ambix_segmented_close(seg);
+    return NULL;
+  }
+  strcpy(seg->pattern, pattern);
+
+  seg->current=segment_open(seg, 0);
+  if(!seg->current) {
+    ambix_segmented_close(seg);
+    return NULL;
+  }
+  /* the size of a frame is only known once the backend has settled on a format */
+  seg->info.sampleformat=seg->current->realinfo.sampleformat;
+  framesize=seg->current->channels*_ambix_samplebytes(seg->current->realinfo.sampleformat);
+  seg->segmentframes=INT64_MAX;
+  if(maxframes>0)
+    seg->segmentframes=maxframes;
+  if(maxbytes>0 && framesize>0 && maxbytes/framesize<seg->segmentframes)
+    seg->segmentframes=maxbytes/framesize;
+  if(seg->segmentframes<1 || framesize<1) {
+    segment_discard(seg, seg->current, 0);
+    seg->current=NULL;
+    ambix_segmented_close(seg);
+    return NULL;
+  }
+  if(seg->segmentframes<INT64_MAX)
+    ambix_reserve(seg->current, seg->segmentframes);
+#ifdef HAVE_PTHREADS
+  pthread_mutex_init(&seg->mutex, NULL);
+  pthread_cond_init(&seg->cond, NULL);
+  seg->running=!pthread_create(&seg->thread, NULL, segment_thread, seg);
+  if(!seg->running) {
+    pthread_cond_destroy(&seg->cond);
+    pthread_mutex_destroy(&seg->mutex);
+  }
+#endif /* HAVE_PTHREADS */
+  return seg;
+}
+
+int64_t ambix_segmented_writef_float32(ambix_segmented_t*seg, const float32_t*ambidata, const float32_t*otherdata, int64_t frames) {
+  int64_t done=0;
+  if(!seg || !seg->current)
+    return -AMBIX_ERR_INVALID_HANDLE;
+  while(done<frames) {
+    int64_t n=frames-done, got;
+    if(seg->written>=seg->segmentframes) {
+      if(!segment_rollover(seg))
+        return done?done:-AMBIX_ERR_INVALID_FILE;
+    }
+    if(n>seg->segmentframes-seg->written)
+      n=seg->segmentframes-seg->written;
+    got=ambix_writef_float32(seg->current,
+                             ambidata?(ambidata+done*seg->info.ambichannels):NULL,
+                             otherdata?(otherdata+done*seg->info.extrachannels):NULL,
+                             n);
+    if(got<0)
+      return done?done:got;
+    seg->written+=got;
+    done+=got;
+    if(got<n)
+      break;
+  }
+  return done;
+}
+
+uint32_t ambix_segmented_get_index(ambix_segmented_t*seg) {
+  return seg?seg->index:0;
+}
+
+ambix_err_t ambix_segmented_close(ambix_segmented_t*seg) {
+  ambix_err_t res;
+  if(!seg)
+    return AMBIX_ERR_INVALID_HANDLE;
+#ifdef HAVE_PTHREADS
+  if(seg->running) {
+    pthread_mutex_lock(&seg->mutex);
+    seg->quit=1;
+    pthread_cond_broadcast(&seg->cond);
+    pthread_mutex_unlock(&seg->mutex);
+    pthread_join(seg->thread, NULL);
+    pthread_cond_destroy(&seg->cond);
+    pthread_mutex_destroy(&seg->mutex);
+  }
+#endif /* HAVE_PTHREADS */
+  if(seg->retired)
+    segment_finalize(seg, seg->retired);
+  if(seg->current)
+    segment_finalize(seg, seg->current);
+  /* the segment opened ahead of time was never written to */
+  if(seg->next)
+    segment_discard(seg, seg->next, seg->index+1);
+  res=seg->error;
+  if(seg->matrix)
+    ambix_matrix_destroy(seg->matrix);
+  free(seg->pattern);
+  free(seg);
+  return res;
+}
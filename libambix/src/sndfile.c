@@ -38,6 +38,12 @@
 #ifdef HAVE_SNDFILE_H
 # include <sndfile.h>
 #endif /* HAVE_SNDFILE_H */
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
 
 #ifdef _MSC_VER
 # define snprintf _snprintf
@@ -59,6 +65,43 @@ typedef struct ambixsndfile_private_t {
   uint32_t sf_numchunks;
 #elif defined HAVE_SF_UUID_INFO
 #endif
+  /** user-supplied callbacks (for virtual I/O) */
+  ambix_virtual_io_t vio;
+  /** user-supplied data for the callbacks */
+  void*vio_userdata;
+  /** offset of the audio data in a virtual file (streaming) */
+  sf_count_t vio_offset;
+
+  /** whether we are reading/writing a stream (AMBIX_STREAM): SFM_READ resp. SFM_WRITE */
+  int stream;
+  /** file descriptor of the stream (or -1 for virtual I/O) */
+  int stream_fd;
+  /** whether the stream owns the file descriptor */
+  int stream_closefd;
+  /** header chunks collected until the stream is started (resp. found before the audio data) */
+  unsigned char*stream_header;
+  size_t stream_headersize;
+  /** frames left to read from the stream (or -1 if the length is unknown) */
+  int64_t stream_frames;
+
+  /** the file opened by path (for asynchronous reads, preallocation resp. checkpoints), or NULL */
+  char*path;
+  /** our own file descriptor of a file opened for writing (holding the preallocated space, and for checkpoints), or -1 */
+  int write_fd;
+  /** our own file descriptor of a file opened for reading by path, or -1
+   * (libsndfile reads from it, unless the SNDFILE handle was handed out before) */
+  int file_fd;
+  /** whether the SNDFILE handle has been handed out (and thus must not be replaced) */
+  int sf_exported;
+  /** byte offset of the audio data in the file (or 0 if not known yet) */
+  int64_t file_dataoffset;
+  /** byte offset of the size of the 'data' chunk to correct when reading (or 0 if the header is fine) */
+  int64_t file_sizeoffset;
+  /** the corrected size of the 'data' chunk (big-endian) */
+  unsigned char file_size[8];
+  /** chunks to append to the file after the audio data, once libsndfile has finished it */
+  unsigned char*trailer;
+  size_t trailersize;
 }ambixsndfile_private_t;
 static inline ambixsndfile_private_t*PRIVATE(ambix_t*ax) { return ((ambixsndfile_private_t*)(ax->private_data)); }
 
@@ -116,8 +159,20 @@ sndfile2ambix_info(const SF_INFO*sfinfo, ambix_info_t*axinfo) {
   axinfo->sampleformat=sndfile2ambix_sampleformat(sfinfo->format & SF_FORMAT_SUBMASK);
 }
 
+static const unsigned char*stream_find_chunk(ambixsndfile_private_t*priv, const char id[4], uint32_t index, int64_t*datasize);
 static int
 read_uuidchunk(ambix_t*ax) {
+  if(PRIVATE(ax)->stream) {
+    const unsigned char*data;
+    int64_t datalen;
+    uint32_t index;
+    for(index=0; NULL!=(data=stream_find_chunk(PRIVATE(ax), "uuid", index, &datalen)); index++) {
+      if(datalen>=16 && 1==_ambix_checkUUID((const char*)data) &&
+         _ambix_uuid1_to_matrix(((const char*)data+16), datalen-16, &ax->matrix, ax->chunkswap))
+        return AMBIX_ERR_SUCCESS;
+    }
+    return AMBIX_ERR_UNKNOWN;
+  }
 #if defined HAVE_SF_GET_CHUNK_ITERATOR && defined (HAVE_SF_CHUNK_INFO)
   int                           err ;
   SF_CHUNK_INFO chunk_info ;
@@ -155,7 +210,7 @@ read_uuidchunk(ambix_t*ax) {
 
     chunkver=_ambix_checkUUID((const char*)chunk_info.data);
     if(1==chunkver) {
-      if(_ambix_uuid1_to_matrix(((const char*)chunk_info.data+16), chunk_info.datalen-16, &ax->matrix, ax->byteswap)) {
+      if(_ambix_uuid1_to_matrix(((const char*)chunk_info.data+16), chunk_info.datalen-16, &ax->matrix, ax->chunkswap)) {
         free(chunk_info.data);
         return AMBIX_ERR_SUCCESS;
       }
@@ -175,7 +230,7 @@ read_uuidchunk(ambix_t*ax) {
   strncpy(uuid.id, _ambix_getUUID(1), 16);
   if ( !sf_command(file, SFC_GET_UUID, &uuid, sizeof(uuid)) )   {
     // extended
-    if(_ambix_uuid1_to_matrix(uuid.data, uuid.data_size, &ax->matrix, ax->byteswap)) {
+    if(_ambix_uuid1_to_matrix(uuid.data, uuid.data_size, &ax->matrix, ax->chunkswap)) {
       return AMBIX_ERR_SUCCESS;
     }
   }
@@ -186,29 +241,399 @@ read_uuidchunk(ambix_t*ax) {
 
 
 
-ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
-  int sfmode=0;
-  int caf=0;
-  int is_ambix=0;
+/* trampolines from libsndfile's virtual I/O to the user-supplied callbacks */
+static sf_count_t vio_get_filelen(void*user) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user;
+  sf_count_t len=priv->vio.get_filelen(priv->vio_userdata);
+  return (len<0)?len:len-priv->vio_offset;
+}
+static sf_count_t vio_seek(sf_count_t offset, int whence, void*user) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user;
+  sf_count_t pos=priv->vio.seek(offset+((SEEK_SET==whence)?priv->vio_offset:0), whence, priv->vio_userdata);
+  return (pos<0)?pos:pos-priv->vio_offset;
+}
+static sf_count_t vio_read(void*ptr, sf_count_t count, void*user) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user;
+  return priv->vio.read?priv->vio.read(ptr, count, priv->vio_userdata):0;
+}
+static sf_count_t vio_write(const void*ptr, sf_count_t count, void*user) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user;
+  return priv->vio.write?priv->vio.write(ptr, count, priv->vio_userdata):0;
+}
+static sf_count_t vio_tell(void*user) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user;
+  sf_count_t pos=priv->vio.tell(priv->vio_userdata);
+  return (pos<0)?pos:pos-priv->vio_offset;
+}
+static void sndfile_vio(SF_VIRTUAL_IO*sfvio) {
+  sfvio->get_filelen=vio_get_filelen;
+  sfvio->seek=vio_seek;
+  sfvio->read=vio_read;
+  sfvio->write=vio_write;
+  sfvio->tell=vio_tell;
+}
 
-  ambix->private_data=calloc(1, sizeof(ambixsndfile_private_t));
-  ambix2sndfile_info(ambixinfo, &PRIVATE(ambix)->sf_info);
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+/* virtual I/O on a file descriptor of our own (for patching the header) */
+static int64_t fd_get_filelen(void*user) {
+  const int fd=*(int*)user;
+  off_t pos=lseek(fd, 0, SEEK_CUR), len=lseek(fd, 0, SEEK_END);
+  if(pos<0 || lseek(fd, pos, SEEK_SET)<0)
+    return -1;
+  return (int64_t)len;
+}
+static int64_t fd_seek(int64_t offset, int whence, void*user) {
+  return (int64_t)lseek(*(int*)user, (off_t)offset, whence);
+}
+static int64_t fd_read(void*ptr, int64_t count, void*user) {
+  return (int64_t)read(*(int*)user, ptr, (size_t)count);
+}
+static int64_t fd_write(const void*ptr, int64_t count, void*user) {
+  return (int64_t)write(*(int*)user, ptr, (size_t)count);
+}
+static int64_t fd_tell(void*user) {
+  return (int64_t)lseek(*(int*)user, 0, SEEK_CUR);
+}
+static const ambix_virtual_io_t fd_vio={fd_get_filelen, fd_seek, fd_read, fd_write, fd_tell};
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H && defined HAVE_PREAD
+/* reading a file with a stale header (see sndfile_recover()):
+ * libsndfile reads the file through these, which present the corrected size
+ * of the 'data' chunk */
+static sf_count_t recover_get_filelen(void*user) {
+  return fd_get_filelen(&((ambixsndfile_private_t*)user)->file_fd);
+}
+static sf_count_t recover_seek(sf_count_t offset, int whence, void*user) {
+  return fd_seek(offset, whence, &((ambixsndfile_private_t*)user)->file_fd);
+}
+static sf_count_t recover_read(void*ptr, sf_count_t count, void*user) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user;
+  const int64_t pos=fd_tell(&priv->file_fd);
+  int64_t got=fd_read(ptr, count, &priv->file_fd), i;
+  for(i=0; i<8; i++) {
+    const int64_t at=priv->file_sizeoffset+i-pos;
+    if(pos>=0 && at>=0 && at<got)
+      ((unsigned char*)ptr)[at]=priv->file_size[i];
+  }
+  return (got<0)?0:got;
+}
+static sf_count_t recover_write(const void*ptr, sf_count_t count, void*user) {
+  return 0;
+}
+static sf_count_t recover_tell(void*user) {
+  return fd_tell(&((ambixsndfile_private_t*)user)->file_fd);
+}
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H && HAVE_PREAD */
+
+
+/* streaming (AMBIX_STREAM):
+ * libsndfile needs to seek back to fix the CAF header, so we write the CAF
+ * header ourselves (with a 'data' chunk of unknown size), and then let
+ * libsndfile append the sample frames as headerless RAW data.
+ * likewise, when reading we parse the CAF header up to the 'data' chunk
+ * ourselves, and let libsndfile read the sample frames as RAW data
+ * (chunks following the audio data are not available)
+ */
+static void stream_putbe(unsigned char*dest, uint64_t value, int bytes) {
+  while(bytes--) {
+    dest[bytes]=(unsigned char)(value & 0xFF);
+    value>>=8;
+  }
+}
+static uint64_t stream_getbe(const unsigned char*src, int bytes) {
+  uint64_t value=0;
+  while(bytes--)
+    value=(value<<8) | *src++;
+  return value;
+}
+/* the largest chunk before the audio data of a stream we are willing to keep in memory */
+#define STREAM_MAXCHUNKSIZE (64*1024*1024)
+/* grow a buffer of 'size' bytes, so it can hold another chunk of 'chunksize' bytes (plus the chunk header);
+ * returns NULL (leaving the buffer untouched) if the chunk is larger than 'maxchunksize' or doesn't fit into memory */
+static unsigned char*chunks_grow(unsigned char*buffer, size_t size, int64_t chunksize, int64_t maxchunksize) {
+  if(chunksize<0 || chunksize>maxchunksize || (uint64_t)chunksize > (uint64_t)((size_t)-1 - 12 - size))
+    return NULL;
+  return (unsigned char*)realloc(buffer, size+12+(size_t)chunksize);
+}
+static int stream_read(ambixsndfile_private_t*priv, unsigned char*data, size_t size) {
+  while(size) {
+    int64_t got=-1;
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+    if(priv->stream_fd>=0)
+      got=read(priv->stream_fd, data, size);
+    else
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+    if(priv->vio.read)
+      got=priv->vio.read(data, size, priv->vio_userdata);
+    if(got<=0)
+      return 0;
+    data+=got;
+    size-=got;
+  }
+  return 1;
+}
+static int stream_write(ambixsndfile_private_t*priv, const unsigned char*data, size_t size) {
+  while(size) {
+    int64_t written=-1;
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+    if(priv->stream_fd>=0)
+      written=write(priv->stream_fd, data, size);
+    else
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+    if(priv->vio.write)
+      written=priv->vio.write(data, size, priv->vio_userdata);
+    if(written<=0)
+      return 0;
+    data+=written;
+    size-=written;
+  }
+  return 1;
+}
+/* find the index'th chunk 'id' in the header of the stream */
+static const unsigned char*stream_find_chunk(ambixsndfile_private_t*priv, const char id[4], uint32_t index, int64_t*datasize) {
+  size_t offset=0;
+  while(offset+12<=priv->stream_headersize) {
+    const unsigned char*chunk=priv->stream_header+offset;
+    const int64_t size=(int64_t)stream_getbe(chunk+4, 8);
+    if(!memcmp(chunk, id, 4) && !index--) {
+      *datasize=size;
+      return chunk+12;
+    }
+    offset+=12+size;
+  }
+  *datasize=0;
+  return NULL;
+}
+static ambix_err_t stream_add_chunk(ambix_t*ambix, const char id[4], const void*data, int64_t datasize) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  unsigned char*header;
+  /* too late: the header has been written already */
+  if(priv->sf_file)
+    return AMBIX_ERR_UNKNOWN;
+  header=chunks_grow(priv->stream_header, priv->stream_headersize, datasize, INT64_MAX);
+  if(!header)
+    return AMBIX_ERR_UNKNOWN;
+  memcpy(header+priv->stream_headersize, id, 4);
+  stream_putbe(header+priv->stream_headersize+4, datasize, 8);
+  memcpy(header+priv->stream_headersize+12, data, datasize);
+  priv->stream_header=header;
+  priv->stream_headersize+=12+datasize;
+  return AMBIX_ERR_SUCCESS;
+}
+/* let libsndfile handle the RAW sample frames (following the header) */
+static int stream_open_sndfile(ambixsndfile_private_t*priv) {
+  if(priv->stream_fd>=0) {
+    priv->sf_file=sf_open_fd(priv->stream_fd, priv->stream, &priv->sf_info, priv->stream_closefd);
+    if(priv->sf_file)
+      priv->stream_fd=-1;
+  } else {
+    SF_VIRTUAL_IO sfvio;
+    sndfile_vio(&sfvio);
+    priv->vio_offset=priv->vio.tell(priv->vio_userdata);
+    if(priv->vio_offset<0)
+      priv->vio_offset=0;
+    priv->sf_file=sf_open_virtual(&sfvio, priv->stream, &priv->sf_info, priv);
+  }
+  return (NULL!=priv->sf_file);
+}
+static ambix_err_t stream_read_header(ambixsndfile_private_t*priv) {
+  SF_INFO*info=&priv->sf_info;
+  unsigned char chunk[32];
+  uint32_t bytesperframe=0;
+
+  if(!stream_read(priv, chunk, 8) || memcmp(chunk, "caff", 4))
+    return AMBIX_ERR_INVALID_FILE;
+
+  while(stream_read(priv, chunk, 12)) {
+    const int64_t size=(int64_t)stream_getbe(chunk+4, 8);
+    if(!memcmp(chunk, "data", 4)) {
+      /* skip the edit count */
+      if(!bytesperframe || !stream_read(priv, chunk, 4))
+        return AMBIX_ERR_INVALID_FILE;
+      /* a size of -1 means: until the end of the file */
+      priv->stream_frames=(size<4)?-1:(size-4)/bytesperframe;
+      return AMBIX_ERR_SUCCESS;
+    } else if(!memcmp(chunk, "desc", 4)) {
+      union { float64_t f; uint64_t u; } samplerate;
+      uint32_t flags, channels, bits;
+      int subformat=0;
+      if(32!=size || !stream_read(priv, chunk, 32) || memcmp(chunk+8, "lpcm", 4))
+        return AMBIX_ERR_INVALID_FILE;
+      samplerate.u=stream_getbe(chunk, 8);
+      flags=(uint32_t)stream_getbe(chunk+12, 4);
+      bytesperframe=(uint32_t)stream_getbe(chunk+16, 4);
+      channels=(uint32_t)stream_getbe(chunk+24, 4);
+      bits=(uint32_t)stream_getbe(chunk+28, 4);
+      switch(bits) {
+      case 16: subformat=(flags&1)?0:SF_FORMAT_PCM_16; break;
+      case 24: subformat=(flags&1)?0:SF_FORMAT_PCM_24; break;
+      case 32: subformat=(flags&1)?SF_FORMAT_FLOAT:SF_FORMAT_PCM_32; break;
+      case 64: subformat=(flags&1)?SF_FORMAT_DOUBLE:0; break;
+      default: break;
+      }
+      if(!subformat || !channels || bytesperframe!=channels*bits/8)
+        return AMBIX_ERR_INVALID_FILE;
+      info->samplerate=(int)samplerate.f;
+      info->channels=channels;
+      info->format=SF_FORMAT_RAW | subformat | ((flags&2)?SF_ENDIAN_LITTLE:SF_ENDIAN_BIG);
+    } else {
+      /* keep all other chunks (adaptor matrix, markers,...), unless they are bogus */
+      unsigned char*header=chunks_grow(priv->stream_header, priv->stream_headersize, size, STREAM_MAXCHUNKSIZE);
+      if(!header)
+        return AMBIX_ERR_INVALID_FILE;
+      priv->stream_header=header;
+      memcpy(header+priv->stream_headersize, chunk, 12);
+      if(!stream_read(priv, header+priv->stream_headersize+12, size))
+        return AMBIX_ERR_INVALID_FILE;
+      priv->stream_headersize+=12+size;
+    }
+  }
+  return AMBIX_ERR_INVALID_FILE;
+}
+static ambix_err_t stream_start(ambix_t*ambix) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  SF_INFO*info=&priv->sf_info;
+  const int subformat=info->format & SF_FORMAT_SUBMASK;
+  const int isfloat=(SF_FORMAT_FLOAT==subformat || SF_FORMAT_DOUBLE==subformat);
+  uint32_t bits=32, flags=0;
+  unsigned char*header=NULL, *h;
+  union { float64_t f; uint64_t u; } samplerate;
+  int ok;
+
+  if(priv->sf_file)
+    return AMBIX_ERR_SUCCESS;
+  if(SFM_WRITE!=priv->stream)
+    return AMBIX_ERR_INVALID_FILE;
+
+  switch(subformat) {
+  case SF_FORMAT_PCM_16: bits=16; break;
+  case SF_FORMAT_PCM_24: bits=24; break;
+  case SF_FORMAT_DOUBLE: bits=64; break;
+  default: break;
+  }
+  if(isfloat)
+    flags|=1; /* kCAFLinearPCMFormatFlagIsFloat */
+  if(!ambix->byteswap && !_ambix_is_bigendian())
+    flags|=2; /* kCAFLinearPCMFormatFlagIsLittleEndian */
+  samplerate.f=info->samplerate;
+
+  /* 'caff' file header, 'desc' chunk, the collected chunks, 'data' chunk header */
+  header=(unsigned char*)calloc(8+44+priv->stream_headersize+16, 1);
+  if(!header)
+    return AMBIX_ERR_UNKNOWN;
+  h=header;
+  memcpy(h, "caff", 4); stream_putbe(h+4, 1, 2); stream_putbe(h+6, 0, 2); h+=8;
+  memcpy(h, "desc", 4); stream_putbe(h+4, 32, 8); h+=12;
+  stream_putbe(h, samplerate.u, 8);
+  memcpy(h+8, "lpcm", 4);
+  stream_putbe(h+12, flags, 4);
+  stream_putbe(h+16, info->channels*bits/8, 4);
+  stream_putbe(h+20, 1, 4);
+  stream_putbe(h+24, info->channels, 4);
+  stream_putbe(h+28, bits, 4);
+  h+=32;
+  if(priv->stream_headersize)
+    memcpy(h, priv->stream_header, priv->stream_headersize);
+  h+=priv->stream_headersize;
+  /* a size of -1 means: until the end of the file */
+  memcpy(h, "data", 4); stream_putbe(h+4, (uint64_t)-1, 8); stream_putbe(h+12, 0, 4); h+=16;
+
+  ok=stream_write(priv, header, h-header);
+  free(header);
+  free(priv->stream_header);
+  priv->stream_header=NULL;
+  priv->stream_headersize=0;
+  if(!ok)
+    return AMBIX_ERR_UNKNOWN;
+
+  /* libsndfile only appends headerless sample frames from now on */
+  info->format=SF_FORMAT_RAW | subformat | ((flags&2)?SF_ENDIAN_LITTLE:SF_ENDIAN_BIG);
+  if(!stream_open_sndfile(priv)) {
+    priv->stream=0;
+    return AMBIX_ERR_UNKNOWN;
+  }
+  return AMBIX_ERR_SUCCESS;
+}
+static SNDFILE*stream_sndfile(ambix_t*ambix) {
+  if(!PRIVATE(ambix)->sf_file)
+    stream_start(ambix);
+  return PRIVATE(ambix)->sf_file;
+}
+/* never read beyond the audio data of a stream */
+static sf_count_t stream_readable(ambix_t*ambix, int64_t frames) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  if(SFM_READ==priv->stream && priv->stream_frames>=0 && frames>priv->stream_frames)
+    return (sf_count_t)priv->stream_frames;
+  return (sf_count_t)frames;
+}
+static int64_t stream_consumed(ambix_t*ambix, sf_count_t frames) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  if(SFM_READ==priv->stream && priv->stream_frames>0 && frames>0)
+    priv->stream_frames-=frames;
+  return (int64_t)frames;
+}
+/* the part of opening a stream that is common to files and virtual I/O */
+static ambix_err_t _ambix_open_stream (ambix_t*ambix, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  ambix->chunkswap=!_ambix_is_bigendian();
+  ambix->is_AMBIX=1;
+  ambix->format=AMBIX_BASIC;
+
+  if(mode & AMBIX_READ) {
+    ambix_err_t err;
+    priv->stream=SFM_READ;
+    err=stream_read_header(priv);
+    if(AMBIX_ERR_SUCCESS!=err || !stream_open_sndfile(priv)) {
+      priv->stream=0;
+      return AMBIX_ERR_INVALID_FILE;
+    }
+    memset(&ambix->realinfo, 0, sizeof(*ambixinfo));
+    sndfile2ambix_info(&priv->sf_info, &ambix->realinfo);
+    ambix->realinfo.frames=(priv->stream_frames<0)?INT64_MAX:priv->stream_frames;
+    ambix->byteswap=(sf_command(priv->sf_file, SFC_RAW_DATA_NEEDS_ENDSWAP, NULL, 0) == SF_TRUE);
+    ambix->channels = priv->sf_info.channels;
+    if(read_uuidchunk(ambix) == AMBIX_ERR_SUCCESS)
+      ambix->format=AMBIX_EXTENDED;
+    return AMBIX_ERR_SUCCESS;
+  }
+
+  memset(&ambix->realinfo, 0, sizeof(*ambixinfo));
+  sndfile2ambix_info(&priv->sf_info, &ambix->realinfo);
+  ambix->byteswap=(mode & AMBIX_NATIVEENDIAN)?0:!_ambix_is_bigendian();
+  ambix->channels = priv->sf_info.channels;
+
+  priv->stream=SFM_WRITE;
+  return AMBIX_ERR_SUCCESS;
+}
 
+static int
+ambix2sndfile_mode(const ambix_filemode_t mode) {
   if((mode & AMBIX_READ) && (mode & AMBIX_WRITE))
-    sfmode=     SFM_RDWR;
+    return SFM_RDWR;
   else if (mode & AMBIX_WRITE)
-    sfmode=     SFM_WRITE;
+    return SFM_WRITE;
   else if (mode & AMBIX_READ)
-    sfmode=     SFM_READ;
+    return SFM_READ;
+  return 0;
+}
+
+/* the part of opening that is common to files and virtual I/O */
+static ambix_err_t _ambix_open_sndfile (ambix_t*ambix, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  int caf=0;
+  int is_ambix=0;
 
-  PRIVATE(ambix)->sf_file=sf_open(path, sfmode, &PRIVATE(ambix)->sf_info) ;
   if(!PRIVATE(ambix)->sf_file)
     return AMBIX_ERR_INVALID_FILE;
 
   memset(&ambix->realinfo, 0, sizeof(*ambixinfo));
   sndfile2ambix_info(&PRIVATE(ambix)->sf_info, &ambix->realinfo);
 
+  /* libambix tracks the peaks itself (for all sample formats), and writes its own PEAK chunk */
+  if(mode & AMBIX_WRITE)
+    sf_command(PRIVATE(ambix)->sf_file, SFC_SET_ADD_PEAK_CHUNK, NULL, SF_FALSE);
   ambix->byteswap=(sf_command(PRIVATE(ambix)->sf_file, SFC_RAW_DATA_NEEDS_ENDSWAP, NULL, 0) == SF_TRUE);
+  ambix->chunkswap=!_ambix_is_bigendian();
   ambix->channels = PRIVATE(ambix)->sf_info.channels;
 
   caf=((SF_FORMAT_CAF == (SF_FORMAT_TYPEMASK & PRIVATE(ambix)->sf_info.format)) != 0);
@@ -294,11 +719,207 @@ ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t
   return AMBIX_ERR_SUCCESS;
 }
 
+/* the number of bytes per frame of a (PCM) file */
+static uint32_t sndfile_framebytes(const SF_INFO*info) {
+  return info->channels*_ambix_samplebytes(sndfile2ambix_sampleformat(info->format & SF_FORMAT_SUBMASK));
+}
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H && defined HAVE_PREAD
+/* a recording that was interrupted before its first checkpoint leaves a
+ * 'data' chunk that only holds the edit count (4 bytes), a stream one of
+ * unknown size (-1): unless another chunk follows the audio data, the size
+ * is taken from the length of the file instead.
+ * (any other size was written by a checkpoint, and is trusted)
+ * returns TRUE if the header of file_fd needs to be corrected */
+static int sndfile_recover_fd(ambixsndfile_private_t*priv) {
+  ambixsndfile_private_t header;
+  unsigned char chunk[12];
+  const int64_t filelen=fd_get_filelen(&priv->file_fd);
+  int64_t dataoffset=-1, datasize=-1, end, i;
+  uint32_t framebytes=0;
+
+  /* the CAF header is parsed just like the header of a stream */
+  memset(&header, 0, sizeof(header));
+  header.stream_fd=priv->file_fd;
+  if(AMBIX_ERR_SUCCESS==stream_read_header(&header)) {
+    dataoffset=fd_tell(&priv->file_fd);
+    framebytes=sndfile_framebytes(&header.sf_info);
+  }
+  free(header.stream_header);
+  if(lseek(priv->file_fd, 0, SEEK_SET) || !framebytes || dataoffset<16 || filelen<dataoffset
+     || 12!=pread(priv->file_fd, chunk, 12, dataoffset-16))
+    return 0;
+  datasize=(int64_t)stream_getbe(chunk+4, 8);
+  if(4!=datasize && -1!=datasize)
+    return 0;
+
+  /* (the size includes the 4 bytes of the edit count) */
+  end=dataoffset+datasize-4;
+  if(4==datasize && end==filelen)
+    return 0;
+  if(4==datasize && end<filelen && 12==pread(priv->file_fd, chunk, 12, end)) {
+    int64_t size=(int64_t)stream_getbe(chunk+4, 8);
+    for(i=0; i<4; i++)
+      if(chunk[i]<0x20 || chunk[i]>0x7e)
+        break;
+    if(4==i && size>=0 && size<=filelen-end-12)
+      return 0;
+  }
+
+  priv->file_sizeoffset=dataoffset-12;
+  stream_putbe(priv->file_size, (filelen-dataoffset)/framebytes*framebytes+4, 8);
+  return 1;
+}
+/* returns TRUE if the file needs to be read with a corrected header (through file_fd) */
+static int sndfile_recover(ambixsndfile_private_t*priv, const char*path) {
+  priv->file_fd=open(path, O_RDONLY);
+  if(priv->file_fd<0)
+    return 0;
+  if(sndfile_recover_fd(priv))
+    return 1;
+  close(priv->file_fd);
+  priv->file_fd=-1;
+  return 0;
+}
+static void recover_vio(SF_VIRTUAL_IO*sfvio) {
+  sfvio->get_filelen=recover_get_filelen;
+  sfvio->seek=recover_seek;
+  sfvio->read=recover_read;
+  sfvio->write=recover_write;
+  sfvio->tell=recover_tell;
+}
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H && HAVE_PREAD */
+
+ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  ambix->private_data=calloc(1, sizeof(ambixsndfile_private_t));
+  PRIVATE(ambix)->stream_fd=-1;
+  PRIVATE(ambix)->write_fd=-1;
+  PRIVATE(ambix)->file_fd=-1;
+  ambix2sndfile_info(ambixinfo, &PRIVATE(ambix)->sf_info);
+  if((mode & AMBIX_WRITE) && (mode & AMBIX_NATIVEENDIAN))
+    PRIVATE(ambix)->sf_info.format |= SF_ENDIAN_CPU;
+
+  if(mode & AMBIX_STREAM) {
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+    if(strcmp(path, "-")) {
+      if(mode & AMBIX_WRITE)
+        PRIVATE(ambix)->stream_fd=open(path, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+      else
+        PRIVATE(ambix)->stream_fd=open(path, O_RDONLY);
+      PRIVATE(ambix)->stream_closefd=1;
+    } else
+      PRIVATE(ambix)->stream_fd=(mode & AMBIX_WRITE)?STDOUT_FILENO:STDIN_FILENO;
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+    if(PRIVATE(ambix)->stream_fd<0)
+      return AMBIX_ERR_INVALID_FILE;
+    return _ambix_open_stream(ambix, mode, ambixinfo);
+  }
+
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H && defined HAVE_PREAD
+  /* only on request, as this parses the header a second time */
+  if(ambix2sndfile_mode(mode) == SFM_READ && (mode & AMBIX_RECOVER) && sndfile_recover(PRIVATE(ambix), path)) {
+    SF_VIRTUAL_IO sfvio;
+    recover_vio(&sfvio);
+    PRIVATE(ambix)->sf_file=sf_open_virtual(&sfvio, SFM_READ, &PRIVATE(ambix)->sf_info, PRIVATE(ambix));
+    ambix->recovered=(NULL!=PRIVATE(ambix)->sf_file);
+  } else
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H && HAVE_PREAD */
+    PRIVATE(ambix)->sf_file=sf_open(path, ambix2sndfile_mode(mode), &PRIVATE(ambix)->sf_info) ;
+  PRIVATE(ambix)->path=(char*)malloc(strlen(path)+1);
+  if(PRIVATE(ambix)->path)
+    strcpy(PRIVATE(ambix)->path, path);
+  return _ambix_open_sndfile(ambix, mode, ambixinfo);
+}
+
+ambix_err_t _ambix_open_virtual (ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  SF_VIRTUAL_IO sfvio;
+  ambix->private_data=calloc(1, sizeof(ambixsndfile_private_t));
+  PRIVATE(ambix)->stream_fd=-1;
+  PRIVATE(ambix)->write_fd=-1;
+  PRIVATE(ambix)->file_fd=-1;
+  ambix2sndfile_info(ambixinfo, &PRIVATE(ambix)->sf_info);
+  if((mode & AMBIX_WRITE) && (mode & AMBIX_NATIVEENDIAN))
+    PRIVATE(ambix)->sf_info.format |= SF_ENDIAN_CPU;
+
+  PRIVATE(ambix)->vio=*vio;
+  PRIVATE(ambix)->vio_userdata=userdata;
+  if(mode & AMBIX_STREAM)
+    return _ambix_open_stream(ambix, mode, ambixinfo);
+  sndfile_vio(&sfvio);
+  PRIVATE(ambix)->sf_file=sf_open_virtual(&sfvio, ambix2sndfile_mode(mode), &PRIVATE(ambix)->sf_info, PRIVATE(ambix)) ;
+  return _ambix_open_sndfile(ambix, mode, ambixinfo);
+}
+
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+/* libsndfile doesn't expose its file descriptor, so we use our own */
+static int sndfile_write_fd(ambixsndfile_private_t*priv) {
+  if(priv->write_fd<0 && priv->path)
+    priv->write_fd=open(priv->path, O_RDWR);
+  return priv->write_fd;
+}
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+/* the I/O to patch (resp. append to) the file being written by libsndfile:
+ * files opened by path get a file descriptor of our own */
+static int sndfile_write_vio(ambixsndfile_private_t*priv, const ambix_virtual_io_t**vio, void**userdata) {
+  *vio=&priv->vio;
+  *userdata=priv->vio_userdata;
+  if(!priv->path)
+    return (NULL!=priv->vio.write);
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+  if(sndfile_write_fd(priv)<0)
+    return 0;
+  *vio=&fd_vio;
+  *userdata=&priv->write_fd;
+  return 1;
+#else
+  return 0;
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+}
+/* libsndfile puts all chunks it knows about into the header, and rewrites
+ * the header in place when closing (so chunks added late would overwrite the
+ * audio data); instead we append them to the finished file ourselves */
+static ambix_err_t sndfile_write_trailer(ambixsndfile_private_t*priv) {
+  const ambix_virtual_io_t*vio=NULL;
+  void*userdata=NULL;
+  if(!priv->trailersize)
+    return AMBIX_ERR_SUCCESS;
+  if(!sndfile_write_vio(priv, &vio, &userdata))
+    return AMBIX_ERR_INVALID_FILE;
+  if(vio->seek(0, SEEK_END, userdata)<0
+     || (int64_t)priv->trailersize!=vio->write(priv->trailer, priv->trailersize, userdata))
+    return AMBIX_ERR_UNKNOWN;
+  return AMBIX_ERR_SUCCESS;
+}
+
 ambix_err_t     _ambix_close    (ambix_t*ambix) {
+  ambix_err_t res=AMBIX_ERR_SUCCESS;
   int i;
+  /* a stream without any sample frames still gets its header */
+  if(SFM_WRITE==PRIVATE(ambix)->stream)
+    stream_start(ambix);
   if(PRIVATE(ambix)->sf_file)
     sf_close(PRIVATE(ambix)->sf_file);
   PRIVATE(ambix)->sf_file=NULL;
+  if(AMBIX_ERR_SUCCESS!=sndfile_write_trailer(PRIVATE(ambix)))
+    res=AMBIX_ERR_UNKNOWN;
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+  if(PRIVATE(ambix)->stream_fd>=0 && PRIVATE(ambix)->stream_closefd)
+    close(PRIVATE(ambix)->stream_fd);
+  if(PRIVATE(ambix)->file_fd>=0)
+    close(PRIVATE(ambix)->file_fd);
+  if(PRIVATE(ambix)->write_fd>=0) {
+#ifdef HAVE_FTRUNCATE
+    /* release the preallocated space that was not used
+     * (if this fails, the file is still complete: it just occupies more disk space) */
+    off_t size=lseek(PRIVATE(ambix)->write_fd, 0, SEEK_END);
+    if(size>=0 && ftruncate(PRIVATE(ambix)->write_fd, size)) {
+    }
+#endif /* HAVE_FTRUNCATE */
+    close(PRIVATE(ambix)->write_fd);
+  }
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+  free(PRIVATE(ambix)->stream_header);
+  free(PRIVATE(ambix)->trailer);
+  free(PRIVATE(ambix)->path);
 
 #if defined HAVE_SF_SET_CHUNK && defined (HAVE_SF_CHUNK_INFO)
   if((PRIVATE(ambix)->sf_chunk).data)
@@ -311,7 +932,7 @@ ambix_err_t     _ambix_close    (ambix_t*ambix) {
 #endif
 
   free(PRIVATE(ambix));
-  return AMBIX_ERR_SUCCESS;
+  return res;
 }
 
 int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int bias) {
@@ -327,40 +948,250 @@ int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int bias) {
   whence |= (bias & SEEK_CUR);
   whence |= (bias & SEEK_END);
 
+  /* streams cannot seek */
+  if(PRIVATE(ambix)->stream)
+    return -1;
   if(PRIVATE(ambix)->sf_file)
     return (int64_t)sf_seek(PRIVATE(ambix)->sf_file, (sf_count_t)frames, whence);
   return -1;
 }
 
 SNDFILE*_ambix_get_sndfile      (ambix_t*ambix) {
+  PRIVATE(ambix)->sf_exported=1;
   return PRIVATE(ambix)->sf_file;
 }
+ambix_err_t _ambix_get_datachunk (ambix_t*ambix, int*fd, int64_t*offset) {
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+  ambixsndfile_private_t header;
+  ambix_err_t err;
+  if(!PRIVATE(ambix)->path || (ambix->filemode & AMBIX_WRITE) || SF_FORMAT_CAF != (SF_FORMAT_TYPEMASK & PRIVATE(ambix)->sf_info.format))
+    return AMBIX_ERR_INVALID_FILE;
+  /* the CAF header is parsed just like the header of a stream */
+  memset(&header, 0, sizeof(header));
+  header.stream_fd=open(PRIVATE(ambix)->path, O_RDONLY);
+  if(header.stream_fd<0)
+    return AMBIX_ERR_INVALID_FILE;
+  err=stream_read_header(&header);
+  free(header.stream_header);
+  *offset=(AMBIX_ERR_SUCCESS==err)?(int64_t)lseek(header.stream_fd, 0, SEEK_CUR):-1;
+  if(*offset<0) {
+    close(header.stream_fd);
+    return AMBIX_ERR_INVALID_FILE;
+  }
+  *fd=header.stream_fd;
+  return AMBIX_ERR_SUCCESS;
+#else
+  return AMBIX_ERR_INVALID_FILE;
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+}
+ambix_err_t _ambix_reserve (ambix_t*ambix, int64_t bytes) {
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+  off_t size;
+  if(sndfile_write_fd(PRIVATE(ambix))<0)
+    return AMBIX_ERR_INVALID_FILE;
+  size=lseek(PRIVATE(ambix)->write_fd, 0, SEEK_END);
+  if(size<0)
+    return AMBIX_ERR_INVALID_FILE;
+  return _ambix_preallocate(PRIVATE(ambix)->write_fd, size, bytes);
+#else
+  return AMBIX_ERR_INVALID_FILE;
+#endif /* HAVE_UNISTD_H && HAVE_FCNTL_H */
+}
+#if defined HAVE_POSIX_FADVISE && defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+/* hints apply to a file descriptor (not just the file), but libsndfile doesn't
+ * expose its own: so when the first hint is given, we open the file once more
+ * and let libsndfile continue reading from our file descriptor.
+ * if the SNDFILE handle has been handed out with ambix_get_sndfile(), it must
+ * stay valid: then the hints only go to our own descriptor */
+static int sndfile_read_fd(ambix_t*ambix) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  SNDFILE*sf_file=NULL;
+  SF_INFO info;
+  sf_count_t pos;
+  int64_t dataoffset=0;
+  int fd=-1;
+  if(priv->file_fd>=0)
+    return priv->file_fd;
+  if(!priv->sf_file || AMBIX_ERR_SUCCESS!=_ambix_get_datachunk(ambix, &fd, &dataoffset))
+    return -1;
+  if(priv->sf_exported) {
+    priv->file_fd=fd;
+    priv->file_dataoffset=dataoffset;
+    return fd;
+  }
+  memset(&info, 0, sizeof(info));
+  pos=sf_seek(priv->sf_file, 0, SEEK_CUR);
+  if(pos>=0 && 0==lseek(fd, 0, SEEK_SET))
+    sf_file=sf_open_fd(fd, SFM_READ, &info, 0);
+  if(!sf_file || pos!=sf_seek(sf_file, pos, SEEK_SET)) {
+    if(sf_file)
+      sf_close(sf_file);
+    close(fd);
+    return -1;
+  }
+  sf_close(priv->sf_file);
+  priv->sf_file=sf_file;
+  priv->file_fd=fd;
+  priv->file_dataoffset=dataoffset;
+  return fd;
+}
+#endif /* HAVE_POSIX_FADVISE && HAVE_UNISTD_H && HAVE_FCNTL_H */
+ambix_err_t _ambix_advise (ambix_t*ambix, ambix_advice_t advice, int64_t offset, int64_t bytes) {
+#if defined HAVE_POSIX_FADVISE && defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+  int fadvice=POSIX_FADV_NORMAL;
+  switch(advice) {
+  case AMBIX_ADVISE_NORMAL:     fadvice=POSIX_FADV_NORMAL; break;
+  case AMBIX_ADVISE_SEQUENTIAL: fadvice=POSIX_FADV_SEQUENTIAL; break;
+  case AMBIX_ADVISE_RANDOM:     fadvice=POSIX_FADV_RANDOM; break;
+  case AMBIX_ADVISE_WILLNEED:   fadvice=POSIX_FADV_WILLNEED; break;
+  case AMBIX_ADVISE_DONTNEED:   fadvice=POSIX_FADV_DONTNEED; break;
+  default:
+    return AMBIX_ERR_UNKNOWN;
+  }
+  if(sndfile_read_fd(ambix)<0)
+    return AMBIX_ERR_INVALID_FILE;
+  if(AMBIX_ADVISE_WILLNEED==advice || AMBIX_ADVISE_DONTNEED==advice) {
+    /* ranges are relative to the audio data */
+    if(!PRIVATE(ambix)->file_dataoffset) {
+      int fd=-1;
+      int64_t dataoffset=0;
+      if(AMBIX_ERR_SUCCESS!=_ambix_get_datachunk(ambix, &fd, &dataoffset))
+        return AMBIX_ERR_INVALID_FILE;
+      close(fd);
+      PRIVATE(ambix)->file_dataoffset=dataoffset;
+    }
+    offset+=PRIVATE(ambix)->file_dataoffset;
+  } else {
+    /* the access pattern applies to the entire file */
+    offset=bytes=0;
+  }
+  return posix_fadvise(PRIVATE(ambix)->file_fd, (off_t)offset, (off_t)bytes, fadvice)?AMBIX_ERR_UNKNOWN:AMBIX_ERR_SUCCESS;
+#else
+  return AMBIX_ERR_UNKNOWN;
+#endif /* HAVE_POSIX_FADVISE && HAVE_UNISTD_H && HAVE_FCNTL_H */
+}
+ambix_err_t _ambix_checkpoint (ambix_t*ambix) {
+  ambixsndfile_private_t*priv=PRIVATE(ambix);
+  const ambix_virtual_io_t*vio=NULL;
+  void*userdata=NULL;
+  const int64_t framebytes=sndfile_framebytes(&priv->sf_info);
+  unsigned char size[8];
+  int64_t pos, filelen;
+  ambix_err_t err=AMBIX_ERR_SUCCESS;
+  /* a stream announces a 'data' chunk that extends to the end of the file */
+  if(priv->stream)
+    return AMBIX_ERR_SUCCESS;
+  if(!priv->sf_file || SF_FORMAT_CAF != (SF_FORMAT_TYPEMASK & priv->sf_info.format) || framebytes<1)
+    return AMBIX_ERR_INVALID_FILE;
+  if(!sndfile_write_vio(priv, &vio, &userdata) || !vio->read)
+    return AMBIX_ERR_INVALID_FILE;
+  pos=vio->tell(userdata);
+  if(pos<0)
+    return AMBIX_ERR_INVALID_FILE;
+
+  /* the header doesn't change once the first frame has been written */
+  if(!priv->file_dataoffset) {
+    ambixsndfile_private_t header;
+    memset(&header, 0, sizeof(header));
+    header.stream_fd=-1;
+    header.vio=*vio;
+    header.vio_userdata=userdata;
+    if(0==vio->seek(0, SEEK_SET, userdata) && AMBIX_ERR_SUCCESS==stream_read_header(&header))
+      priv->file_dataoffset=vio->tell(userdata);
+    free(header.stream_header);
+  }
+  /* only the size of the 'data' chunk is patched (it includes the edit count) */
+  filelen=vio->get_filelen(userdata);
+  if(priv->file_dataoffset<16 || filelen<priv->file_dataoffset) {
+    err=AMBIX_ERR_INVALID_FILE;
+  } else {
+    stream_putbe(size, (filelen-priv->file_dataoffset)/framebytes*framebytes+4, 8);
+    if(vio->seek(priv->file_dataoffset-12, SEEK_SET, userdata)<0 || 8!=vio->write(size, 8, userdata))
+      err=AMBIX_ERR_UNKNOWN;
+  }
+  /* libsndfile expects to find the file where it left it */
+  if(pos!=vio->seek(pos, SEEK_SET, userdata))
+    err=AMBIX_ERR_UNKNOWN;
+  return err;
+}
 int64_t _ambix_readf_int16   (ambix_t*ambix, int16_t*data, int64_t frames) {
-  return (int64_t)sf_readf_short(PRIVATE(ambix)->sf_file, (short*)data, frames) ;
+  return stream_consumed(ambix, sf_readf_short(PRIVATE(ambix)->sf_file, (short*)data, stream_readable(ambix, frames)));
 }
 int64_t _ambix_readf_int32   (ambix_t*ambix, int32_t*data, int64_t frames) {
-  return (int64_t)sf_readf_int(PRIVATE(ambix)->sf_file, (int*)data, frames) ;
+  return stream_consumed(ambix, sf_readf_int(PRIVATE(ambix)->sf_file, (int*)data, stream_readable(ambix, frames)));
 }
 int64_t _ambix_readf_float32   (ambix_t*ambix, float32_t*data, int64_t frames) {
-  return (int64_t)sf_readf_float(PRIVATE(ambix)->sf_file, (float*)data, frames) ;
+  return stream_consumed(ambix, sf_readf_float(PRIVATE(ambix)->sf_file, (float*)data, stream_readable(ambix, frames)));
 }
 int64_t _ambix_readf_float64   (ambix_t*ambix, float64_t*data, int64_t frames) {
-  return (int64_t)sf_readf_double(PRIVATE(ambix)->sf_file, (double*)data, frames) ;
+  return stream_consumed(ambix, sf_readf_double(PRIVATE(ambix)->sf_file, (double*)data, stream_readable(ambix, frames)));
+}
+int64_t _ambix_readf_raw   (ambix_t*ambix, void*data, int64_t frames, uint32_t framesize) {
+  sf_count_t bytes;
+  if(framesize<1)
+    return -1;
+  bytes=sf_read_raw(PRIVATE(ambix)->sf_file, data, stream_readable(ambix, frames)*framesize);
+  if(bytes<0)
+    return -1;
+  return stream_consumed(ambix, bytes/framesize);
+}
+ambix_err_t _ambix_get_peaks   (ambix_t*ambix, float32_t*peaks) {
+  const uint32_t channels=ambix->channels;
+  ambix_err_t res=AMBIX_ERR_UNKNOWN;
+  double*dpeaks;
+  uint32_t c;
+  if(channels<1 || !PRIVATE(ambix)->sf_file)
+    return AMBIX_ERR_UNKNOWN;
+  dpeaks=(double*)calloc(channels, sizeof(double));
+  if(!dpeaks)
+    return AMBIX_ERR_UNKNOWN;
+  /* this only succeeds if the file has a PEAK chunk */
+  if(SF_TRUE == sf_command(PRIVATE(ambix)->sf_file, SFC_GET_MAX_ALL_CHANNELS, dpeaks, channels*sizeof(double))) {
+    for(c=0; c<channels; c++)
+      peaks[c]=(float32_t)dpeaks[c];
+    res=AMBIX_ERR_SUCCESS;
+  }
+  free(dpeaks);
+  return res;
 }
 
 int64_t _ambix_writef_int16   (ambix_t*ambix, const int16_t*data, int64_t frames) {
-  return (int64_t)sf_writef_short(PRIVATE(ambix)->sf_file, (short*)data, frames) ;
+  SNDFILE*sf_file=stream_sndfile(ambix);
+  if(!sf_file)
+    return -1;
+  return (int64_t)sf_writef_short(sf_file, (short*)data, frames) ;
 }
 int64_t _ambix_writef_int32   (ambix_t*ambix, const int32_t*data, int64_t frames) {
-  return (int64_t)sf_writef_int(PRIVATE(ambix)->sf_file, (int*)data, frames) ;
+  SNDFILE*sf_file=stream_sndfile(ambix);
+  if(!sf_file)
+    return -1;
+  return (int64_t)sf_writef_int(sf_file, (int*)data, frames) ;
 }
 int64_t _ambix_writef_float32   (ambix_t*ambix, const float32_t*data, int64_t frames) {
-  return (int64_t)sf_writef_float(PRIVATE(ambix)->sf_file, (float*)data, frames) ;
+  SNDFILE*sf_file=stream_sndfile(ambix);
+  if(!sf_file)
+    return -1;
+  return (int64_t)sf_writef_float(sf_file, (float*)data, frames) ;
 }
 int64_t _ambix_writef_float64   (ambix_t*ambix, const float64_t*data, int64_t frames) {
-  return (int64_t)sf_writef_double(PRIVATE(ambix)->sf_file, (double*)data, frames) ;
+  SNDFILE*sf_file=stream_sndfile(ambix);
+  if(!sf_file)
+    return -1;
+  return (int64_t)sf_writef_double(sf_file, (double*)data, frames) ;
+}
+int64_t _ambix_writef_raw   (ambix_t*ambix, const void*data, int64_t frames, uint32_t framesize) {
+  sf_count_t bytes;
+  SNDFILE*sf_file=stream_sndfile(ambix);
+  if(framesize<1 || !sf_file)
+    return -1;
+  bytes=sf_write_raw(sf_file, data, (sf_count_t)(frames*framesize));
+  if(bytes<0)
+    return -1;
+  return (int64_t)(bytes/framesize);
 }
 ambix_err_t _ambix_write_uuidchunk(ambix_t*ax, const void*data, int64_t datasize) {
+  if(PRIVATE(ax)->stream)
+    return stream_add_chunk(ax, "uuid", data, datasize);
 #if defined HAVE_SF_SET_CHUNK && defined (HAVE_SF_CHUNK_INFO)
   int                           err ;
   SF_CHUNK_INFO*chunk=&PRIVATE(ax)->sf_chunk;
@@ -394,6 +1225,8 @@ ambix_err_t _ambix_write_uuidchunk(ambix_t*ax, const void*data, int64_t datasize
   return  AMBIX_ERR_UNKNOWN;
 }
 ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize) {
+  if(PRIVATE(ax)->stream)
+    return stream_add_chunk(ax, (const char*)&id, data, datasize);
 #if defined (HAVE_SF_SET_CHUNK)
   int err ;
   int64_t datasize4 = datasize>>2;
@@ -437,7 +1270,36 @@ ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t
 #endif
   return  AMBIX_ERR_UNKNOWN;
 }
+ambix_err_t _ambix_append_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize) {
+  ambixsndfile_private_t*priv=PRIVATE(ax);
+  unsigned char*trailer;
+  /* the 'data' chunk of a stream extends to the end of the file */
+  if(priv->stream)
+    return stream_add_chunk(ax, (const char*)&id, data, datasize);
+  if(!priv->sf_file || SF_FORMAT_CAF != (SF_FORMAT_TYPEMASK & priv->sf_info.format) || datasize<0)
+    return AMBIX_ERR_INVALID_FILE;
+  trailer=chunks_grow(priv->trailer, priv->trailersize, datasize, INT64_MAX);
+  if(!trailer)
+    return AMBIX_ERR_UNKNOWN;
+  memcpy(trailer+priv->trailersize, &id, 4);
+  stream_putbe(trailer+priv->trailersize+4, datasize, 8);
+  memcpy(trailer+priv->trailersize+12, data, datasize);
+  priv->trailer=trailer;
+  priv->trailersize+=12+datasize;
+  return AMBIX_ERR_SUCCESS;
+}
 void* _ambix_read_chunk(ambix_t*ax, uint32_t id, uint32_t chunk_it, int64_t *datasize) {
+  if (PRIVATE(ax)->stream) {
+    void*data=NULL;
+    const unsigned char*chunk=(SFM_READ==PRIVATE(ax)->stream)?stream_find_chunk(PRIVATE(ax), (const char*)&id, chunk_it, datasize):NULL;
+    if (chunk && *datasize>0)
+      data = malloc(*datasize); // has to be freed later by the caller!
+    if (data)
+      memcpy(data, chunk, *datasize);
+    else
+      *datasize = 0;
+    return data;
+  }
 #if defined HAVE_SF_GET_CHUNK_ITERATOR
   int err;
   SF_CHUNK_INFO	chunk_info;
@@ -0,0 +1,209 @@
+/* threads.c -  a small worker pool for parallel processing           -*- c -*-
+
+   Copyright © 2012 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#ifdef HAVE_PTHREADS
+# include <pthread.h>
+#endif /* HAVE_PTHREADS */
+
+/* never spawn more than this many workers */
+#define AMBIX_MAX_THREADS 64
+
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t s_pool_mutex=PTHREAD_MUTEX_INITIALIZER;
+#endif /* HAVE_PTHREADS */
+
+/* the number of threads to use (including the calling thread); protected by s_pool_mutex */
+static uint32_t s_numthreads=1;
+
+void ambix_set_num_threads(uint32_t numthreads) {
+  if(!numthreads) {
+    long ncpu=1;
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    ncpu=sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    numthreads=(ncpu>1)?(uint32_t)ncpu:1;
+  }
+  if(numthreads>AMBIX_MAX_THREADS)
+    numthreads=AMBIX_MAX_THREADS;
+#ifdef HAVE_PTHREADS
+  pthread_mutex_lock(&s_pool_mutex);
+  s_numthreads=numthreads;
+  pthread_mutex_unlock(&s_pool_mutex);
+#else
+  s_numthreads=numthreads;
+#endif
+}
+uint32_t ambix_get_num_threads(void) {
+#ifdef HAVE_PTHREADS
+  uint32_t numthreads;
+  pthread_mutex_lock(&s_pool_mutex);
+  numthreads=s_numthreads;
+  pthread_mutex_unlock(&s_pool_mutex);
+  return numthreads;
+#else
+  return 1;
+#endif
+}
+
+#ifdef HAVE_PTHREADS
+typedef struct _ambix_job {
+  void(*function)(void*userdata, uint32_t index);
+  void*userdata;
+  uint32_t count;     /* number of work items */
+  uint32_t next;      /* next work item to be picked up */
+  uint32_t remaining; /* number of work items not yet finished */
+} ambix_job_t;
+
+/* only a single job can be processed at any time (others run in the calling thread) */
+static pthread_mutex_t s_pool_submit=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_pool_work=PTHREAD_COND_INITIALIZER;
+static pthread_cond_t s_pool_done=PTHREAD_COND_INITIALIZER;
+static pthread_t s_pool_threads[AMBIX_MAX_THREADS];
+static uint32_t s_pool_size=0;
+static int s_pool_quit=0;
+static ambix_job_t*s_pool_job=NULL;
+
+/* run work items of the current job until there are none left; called with s_pool_mutex held */
+static void _ambix_pool_work(ambix_job_t*job) {
+  while(job->next < job->count) {
+    const uint32_t index=job->next++;
+    ambix_fpstate_t fp;
+    pthread_mutex_unlock(&s_pool_mutex);
+    /* the FPU state is per thread, so the workers need their own protection */
+    _ambix_denormals_protect(&fp);
+    job->function(job->userdata, index);
+    _ambix_denormals_restore(&fp);
+    pthread_mutex_lock(&s_pool_mutex);
+    if(!--job->remaining)
+      pthread_cond_signal(&s_pool_done);
+  }
+}
+static void*_ambix_pool_thread(void*dummy) {
+  pthread_mutex_lock(&s_pool_mutex);
+  while(!s_pool_quit) {
+    if(s_pool_job && s_pool_job->next < s_pool_job->count)
+      _ambix_pool_work(s_pool_job);
+    else
+      pthread_cond_wait(&s_pool_work, &s_pool_mutex);
+  }
+  pthread_mutex_unlock(&s_pool_mutex);
+  return dummy;
+}
+/* make sure there are (at least) numworkers threads in the pool; called with s_pool_mutex held */
+static void _ambix_pool_grow(uint32_t numworkers) {
+  while(s_pool_size < numworkers) {
+    if(pthread_create(s_pool_threads+s_pool_size, NULL, _ambix_pool_thread, NULL))
+      break;
+    s_pool_size++;
+  }
+}
+# ifdef __GNUC__
+/* stop the workers when the library is unloaded */
+static void __attribute__((destructor)) _ambix_pool_free(void) {
+  uint32_t i;
+  pthread_mutex_lock(&s_pool_mutex);
+  s_pool_quit=1;
+  pthread_cond_broadcast(&s_pool_work);
+  pthread_mutex_unlock(&s_pool_mutex);
+  for(i=0; i<s_pool_size; i++)
+    pthread_join(s_pool_threads[i], NULL);
+  s_pool_size=0;
+}
+# endif /* __GNUC__ */
+#endif /* HAVE_PTHREADS */
+
+void _ambix_parallel_for(void(*function)(void*userdata, uint32_t index), void*userdata, uint32_t count) {
+#ifdef HAVE_PTHREADS
+  ambix_job_t job;
+  const uint32_t numthreads=(count>1)?ambix_get_num_threads():1;
+  /* if the pool is busy with another job, don't wait for it */
+  if(numthreads>1 && !pthread_mutex_trylock(&s_pool_submit)) {
+    job.function=function;
+    job.userdata=userdata;
+    job.count=count;
+    job.next=0;
+    job.remaining=count;
+    pthread_mutex_lock(&s_pool_mutex);
+    _ambix_pool_grow(numthreads-1);
+    s_pool_job=&job;
+    pthread_cond_broadcast(&s_pool_work);
+    /* the calling thread does its share of the work as well */
+    _ambix_pool_work(&job);
+    while(job.remaining)
+      pthread_cond_wait(&s_pool_done, &s_pool_mutex);
+    s_pool_job=NULL;
+    pthread_mutex_unlock(&s_pool_mutex);
+    pthread_mutex_unlock(&s_pool_submit);
+    return;
+  }
+#endif /* HAVE_PTHREADS */
+  do {
+    uint32_t i;
+    for(i=0; i<count; i++)
+      function(userdata, i);
+  } while(0);
+}
+
+/* only split work into chunks of at least this many multiply-adds */
+#define AMBIX_PARALLEL_THRESHOLD (1<<16)
+
+typedef struct _ambix_framejob {
+  void(*function)(void*userdata, int64_t offset, int64_t frames);
+  void*userdata;
+  int64_t frames;
+  uint32_t chunks;
+} ambix_framejob_t;
+static void _ambix_framejob(void*userdata, uint32_t index) {
+  ambix_framejob_t*job=(ambix_framejob_t*)userdata;
+  const int64_t start=job->frames* index   /job->chunks;
+  const int64_t stop =job->frames*(index+1)/job->chunks;
+  job->function(job->userdata, start, stop-start);
+}
+void _ambix_parallel_frames(void(*function)(void*userdata, int64_t offset, int64_t frames), void*userdata, int64_t frames, uint64_t framecost) {
+  const uint32_t numthreads=ambix_get_num_threads();
+  uint64_t chunks=1;
+  if(numthreads>1 && frames>1) {
+    chunks=((uint64_t)frames*(framecost?framecost:1))/AMBIX_PARALLEL_THRESHOLD;
+    if(chunks>numthreads)
+      chunks=numthreads;
+    if(chunks>(uint64_t)frames)
+      chunks=frames;
+  }
+  if(chunks>1) {
+    ambix_framejob_t job;
+    job.function=function;
+    job.userdata=userdata;
+    job.frames=frames;
+    job.chunks=(uint32_t)chunks;
+    _ambix_parallel_for(_ambix_framejob, &job, job.chunks);
+  } else
+    function(userdata, 0, frames);
+}
@@ -25,6 +25,30 @@
 #include <math.h>
 #include <stdio.h>
 
+/* the byteswapping uses SSSE3 if the compiler may use it unconditionally;
+ * otherwise (on x86) the SSSE3 variants are only used if the CPU has it */
+#if defined __SSSE3__
+# define AMBIX_SWAP_SSSE3 1
+# define AMBIX_SSSE3_TARGET
+# define _ambix_have_ssse3() 1
+#elif (defined __x86_64__ || defined __i386__) && defined __GNUC__
+# define AMBIX_SWAP_SSSE3 1
+# define AMBIX_SSSE3_TARGET __attribute__((target("ssse3")))
+# define _ambix_have_ssse3() __builtin_cpu_supports("ssse3")
+#endif
+#if defined AMBIX_SWAP_SSSE3
+# include <tmmintrin.h>
+#elif defined __SSE2__
+# include <emmintrin.h>
+#elif defined __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+int _ambix_flush_denormals=1;
+void ambix_set_flush_denormals(int flush) {
+  _ambix_flush_denormals=!!flush;
+}
+
 uint32_t ambix_order2channels(uint32_t order) {
   /* L=(N+1)^2 */
   return (order+1)*(order+1);
@@ -122,18 +146,127 @@ void _ambix_print_ambix(const ambix_t*ambix) {
   printf("  startedWriting\t: %d\n", ambix->startedWriting);
 }
 
+uint32_t _ambix_samplebytes(ambix_sampleformat_t format) {
+  switch(format) {
+  case AMBIX_SAMPLEFORMAT_PCM16:   return 2;
+  case AMBIX_SAMPLEFORMAT_PCM24:   return 3;
+  case AMBIX_SAMPLEFORMAT_PCM32:   return 4;
+  case AMBIX_SAMPLEFORMAT_FLOAT32: return 4;
+  case AMBIX_SAMPLEFORMAT_FLOAT64: return 8;
+  default: break;
+  }
+  return 0;
+}
 
+/* the byteswapping functions process 16 bytes at once where possible;
+ * (unaligned) data is handled in SIMD registers (SSE2/SSSE3 or NEON), the
+ * remaining tail (and everything on other architectures) is swapped one
+ * element at a time
+ */
+#if defined AMBIX_SWAP_SSSE3
+static AMBIX_SSSE3_TARGET uint64_t _ambix_swap4array_ssse3(uint32_t*data, uint64_t datasize) {
+  const __m128i mask=_mm_set_epi8(12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3);
+  uint64_t i=0;
+  for(; i+4<=datasize; i+=4) {
+    __m128i v=_mm_loadu_si128((const __m128i*)(data+i));
+    _mm_storeu_si128((__m128i*)(data+i), _mm_shuffle_epi8(v, mask));
+  }
+  return i;
+}
+static AMBIX_SSSE3_TARGET uint64_t _ambix_swap8array_ssse3(uint64_t*data, uint64_t datasize) {
+  const __m128i mask=_mm_set_epi8(8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7);
+  uint64_t i=0;
+  for(; i+2<=datasize; i+=2) {
+    __m128i v=_mm_loadu_si128((const __m128i*)(data+i));
+    _mm_storeu_si128((__m128i*)(data+i), _mm_shuffle_epi8(v, mask));
+  }
+  return i;
+}
+static AMBIX_SSSE3_TARGET uint64_t _ambix_swap3array_ssse3(unsigned char*data, uint64_t datasize) {
+  /* 5 samples (15 bytes) per register; the 16th byte is left untouched */
+  const __m128i mask=_mm_set_epi8(15, 12,13,14, 9,10,11, 6,7,8, 3,4,5, 0,1,2);
+  uint64_t i=0;
+  for(; i+6<=datasize; i+=5, data+=15) {
+    __m128i v=_mm_loadu_si128((const __m128i*)data);
+    _mm_storeu_si128((__m128i*)data, _mm_shuffle_epi8(v, mask));
+  }
+  return i;
+}
+#endif
+
+void _ambix_swap2array(uint16_t*data, uint64_t datasize) {
+  uint64_t i=0;
+#if defined __SSE2__
+  for(; i+8<=datasize; i+=8) {
+    __m128i v=_mm_loadu_si128((const __m128i*)(data+i));
+    _mm_storeu_si128((__m128i*)(data+i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+  }
+#elif defined __ARM_NEON
+  for(; i+8<=datasize; i+=8)
+    vst1q_u8((uint8_t*)(data+i), vrev16q_u8(vld1q_u8((const uint8_t*)(data+i))));
+#endif
+  for(; i<datasize; i++) {
+    uint16_t v=data[i];
+    data[i]=(uint16_t)((v<<8) | (v>>8));
+  }
+}
 void _ambix_swap4array(uint32_t*data, uint64_t datasize) {
-  uint64_t i;
-  for(i=0; i<datasize; i++) {
-    uint32_t v=*data;
-    *data++=swap4(v);
+  uint64_t i=0;
+#if defined AMBIX_SWAP_SSSE3
+  if(_ambix_have_ssse3())
+    i=_ambix_swap4array_ssse3(data, datasize);
+#elif defined __ARM_NEON
+  for(; i+4<=datasize; i+=4)
+    vst1q_u8((uint8_t*)(data+i), vrev32q_u8(vld1q_u8((const uint8_t*)(data+i))));
+#endif
+  for(; i<datasize; i++) {
+    uint32_t v=data[i];
+    data[i]=swap4(v);
   }
 }
 void _ambix_swap8array(uint64_t*data, uint64_t datasize) {
-  uint64_t i;
-  for(i=0; i<datasize; i++) {
-    uint64_t v=*data;
-    *data++=swap8(v);
+  uint64_t i=0;
+#if defined AMBIX_SWAP_SSSE3
+  if(_ambix_have_ssse3())
+    i=_ambix_swap8array_ssse3(data, datasize);
+#elif defined __ARM_NEON
+  for(; i+2<=datasize; i+=2)
+    vst1q_u8((uint8_t*)(data+i), vrev64q_u8(vld1q_u8((const uint8_t*)(data+i))));
+#endif
+  for(; i<datasize; i++) {
+    uint64_t v=data[i];
+    data[i]=swap8(v);
+  }
+}
+void _ambix_swap3array(unsigned char*data, uint64_t datasize) {
+  uint64_t i=0;
+#if defined AMBIX_SWAP_SSSE3
+  if(_ambix_have_ssse3()) {
+    i=_ambix_swap3array_ssse3(data, datasize);
+    data+=3*i;
+  }
+#elif defined __ARM_NEON
+  for(; i+16<=datasize; i+=16, data+=48) {
+    uint8x16x3_t v=vld3q_u8(data);
+    uint8x16_t tmp=v.val[0];
+    v.val[0]=v.val[2];
+    v.val[2]=tmp;
+    vst3q_u8(data, v);
+  }
+#endif
+  for(; i<datasize; i++) {
+    unsigned char v=data[0];
+    data[0]=data[2];
+    data[2]=v;
+    data+=3;
+  }
+}
+void _ambix_swaparray(void*data, uint32_t samplebytes, uint64_t samples) {
+  switch(samplebytes) {
+  case 2: _ambix_swap2array((uint16_t*)data, samples); break;
+  case 3: _ambix_swap3array((unsigned char*)data, samples); break;
+  case 4: _ambix_swap4array((uint32_t*)data, samples); break;
+  case 8: _ambix_swap8array((uint64_t*)data, samples); break;
+  default: break;
   }
 }
@@ -0,0 +1,94 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+static int check_advise(const char*path) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=20000, ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata, *resultambi, *resultother;
+  struct SNDFILE_tag*sndfile=NULL;
+  ambix_err_t err;
+  int64_t err64;
+  float32_t diff;
+
+  STARTTEST("\n");
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+  ambix=ambixtest_create(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  /* hints are only for reading */
+  if(fail_if((AMBIX_ERR_INVALID_FILE!=ambix_advise(ambix, AMBIX_ADVISE_SEQUENTIAL, 0, 0)), __LINE__, "could give hints for a file opened for writing"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  err=ambix_advise(ambix, AMBIX_ADVISE_SEQUENTIAL, 0, 0);
+  if(skip_if((AMBIX_ERR_UNKNOWN==err), __LINE__, "no access pattern hints on this system"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=err), __LINE__, "sequential hint failed with %d", err))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_advise(ambix, AMBIX_ADVISE_RANDOM, 0, 0)), __LINE__, "random hint failed"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_advise(ambix, AMBIX_ADVISE_DONTNEED, 0, 0)), __LINE__, "dropping the file failed"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_advise(ambix, AMBIX_ADVISE_WILLNEED, 1000, 5000)), __LINE__, "loading a range failed"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_advise(ambix, AMBIX_ADVISE_NORMAL, 0, 0)), __LINE__, "normal hint failed"))return 1;
+  if(fail_if((AMBIX_ERR_INVALID_DIMENSION!=ambix_advise(ambix, AMBIX_ADVISE_WILLNEED, -1, 10)), __LINE__, "negative offset accepted"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_preload(ambix, 4096)), __LINE__, "preloading failed"))return 1;
+
+  /* hints don't change what is read */
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize/2);
+  if(fail_if((err64!=framesize/2), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize/2))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_preload(ambix, framesize)), __LINE__, "preloading beyond the end failed"))return 1;
+  if(fail_if((framesize/2!=ambix_seek(ambix, 0, SEEK_CUR)), __LINE__, "preloading moved the read position"))return 1;
+  err64=ambix_readf_float32(ambix, resultambi+framesize/2*ambichannels, resultother+framesize/2*extrachannels, framesize-framesize/2);
+  if(fail_if((err64!=framesize-framesize/2), __LINE__, "read only %d frames of %d", (int)err64, (int)(framesize-framesize/2)))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "otherdata diff %f > %f", diff, 1e-7))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* hints don't invalidate a libsndfile handle that has been handed out */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  sndfile=ambix_get_sndfile(ambix);
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_advise(ambix, AMBIX_ADVISE_SEQUENTIAL, 0, 0)), __LINE__, "sequential hint failed"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_preload(ambix, 4096)), __LINE__, "preloading failed"))return 1;
+  if(fail_if((sndfile!=ambix_get_sndfile(ambix)), __LINE__, "libsndfile handle changed from %p to %p", sndfile, ambix_get_sndfile(ambix)))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* streams cannot be hinted */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ | AMBIX_STREAM, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix stream '%s' for reading", path))return 1;
+  if(fail_if((AMBIX_ERR_INVALID_FILE!=ambix_advise(ambix, AMBIX_ADVISE_SEQUENTIAL, 0, 0)), __LINE__, "could give hints for a stream"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix stream %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_advise(path), __LINE__, "access pattern hints failed");
+  return pass();
+}
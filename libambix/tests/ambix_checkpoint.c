@@ -0,0 +1,171 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/* the size of the 'data' chunk as found in the header (or -2) */
+static int64_t datachunk_size(const char*path) {
+  unsigned char chunk[12];
+  int64_t size=-2, offset=8;
+  FILE*f=fopen(path, "rb");
+  if(!f)
+    return -2;
+  while(!fseek(f, (long)offset, SEEK_SET) && 12==fread(chunk, 1, 12, f)) {
+    int i;
+    int64_t chunksize=0;
+    for(i=4; i<12; i++)
+      chunksize=(chunksize<<8) | chunk[i];
+    if(!memcmp(chunk, "data", 4)) {
+      size=chunksize;
+      break;
+    }
+    offset+=12+chunksize;
+  }
+  fclose(f);
+  return size;
+}
+
+/* open the file for reading (while it might still be written to), and check its contents */
+static int check_contents(const char*path, ambix_filemode_t mode, int recovered, const float32_t*ambidata, const float32_t*otherdata,
+                          uint32_t ambichannels, uint32_t extrachannels, int64_t frames) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  float32_t*resultambi, *resultother;
+  int64_t err64;
+  float32_t diff;
+  resultambi=(float32_t*)calloc(ambichannels*(frames+1), sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*(frames+1), sizeof(float32_t));
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, mode, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((frames!=info.frames), __LINE__, "got %d frames, expected %d", (int)info.frames, (int)frames))return 1;
+  if(fail_if((recovered!=ambix_is_recovered(ambix)), __LINE__, "file %s recovered", recovered?"not":"wrongly"))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, frames+1);
+  if(fail_if((err64!=frames), __LINE__, "read %d frames, expected %d", (int)err64, (int)frames))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*frames, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*frames, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "otherdata diff %f > %f", diff, 1e-7))return 1;
+  /* only files opened for writing have checkpoints */
+  if(fail_if((AMBIX_ERR_INVALID_FILE!=ambix_checkpoint(ambix)), __LINE__, "checkpoint in a file opened for reading"))return 1;
+  if(fail_if((AMBIX_ERR_INVALID_FILE!=ambix_set_checkpoint(ambix, 1.)), __LINE__, "checkpoints in a file opened for reading"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+static int check_checkpoint(const char*path, ambix_filemode_t mode) {
+  ambix_t*ambix=NULL;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=20000, blocksize=1000, ambichannels=4, extrachannels=2;
+  uint32_t framebytes=(ambichannels+extrachannels)*sizeof(float32_t);
+  float32_t*ambidata, *otherdata;
+  int64_t err64, f;
+
+  STARTTEST("mode=%d\n", mode);
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  ambix=ambixtest_create(path, mode, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_INVALID_DIMENSION!=ambix_set_checkpoint(ambix, -1.)), __LINE__, "accepted a negative interval"))return 1;
+  /* nothing to save yet */
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_checkpoint(ambix)), __LINE__, "checkpoint before writing failed"))return 1;
+
+  /* an explicit checkpoint */
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, 3*blocksize);
+  if(fail_if((err64!=3*blocksize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)(3*blocksize)))return 1;
+  /* (unbuffered files only write the frames (and the header) in large blocks) */
+  if(!(mode & AMBIX_DIRECT)) {
+    /* no checkpoint yet: the frames can only be recovered on request */
+    if(check_contents(path, AMBIX_READ, 0, ambidata, otherdata, ambichannels, extrachannels, 0))return 1;
+    if(check_contents(path, AMBIX_READ | AMBIX_RECOVER, 1, ambidata, otherdata, ambichannels, extrachannels, 3*blocksize))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_checkpoint(ambix)), __LINE__, "checkpoint failed"))return 1;
+  if(!(mode & AMBIX_DIRECT)) {
+    if(fail_if((datachunk_size(path)!=3*blocksize*framebytes+4), __LINE__, "'data' chunk has %d bytes after checkpoint, expected %d",
+               (int)datachunk_size(path), (int)(3*blocksize*framebytes+4)))return 1;
+    if(check_contents(path, AMBIX_READ, 0, ambidata, otherdata, ambichannels, extrachannels, 3*blocksize))return 1;
+  }
+
+  /* a checkpoint every 0.05 seconds (2205 frames, so after every 3rd block) */
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_checkpoint(ambix, 0.05)), __LINE__, "setting checkpoints failed"))return 1;
+  for(f=3*blocksize; f<framesize; f+=blocksize) {
+    err64=ambix_writef_float32(ambix, ambidata+f*ambichannels, otherdata+f*extrachannels, blocksize);
+    if(fail_if((err64!=blocksize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)blocksize))return 1;
+    if(mode & AMBIX_DIRECT)
+      continue;
+    /* the last checkpoint was after (3+3*n) blocks */
+    if(fail_if((datachunk_size(path)!=((f/blocksize+1)/3*3)*blocksize*framebytes+4), __LINE__, "'data' chunk has %d bytes after %d frames",
+               (int)datachunk_size(path), (int)(f+blocksize)))return 1;
+    /* the header of the last checkpoint is trusted */
+    if(check_contents(path, AMBIX_READ | AMBIX_RECOVER, 0, ambidata, otherdata, ambichannels, extrachannels, ((f/blocksize+1)/3*3)*blocksize))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  if(fail_if((datachunk_size(path)!=framesize*framebytes+4), __LINE__, "'data' chunk has %d bytes after closing, expected %d",
+             (int)datachunk_size(path), (int)(framesize*framebytes+4)))return 1;
+  if(check_contents(path, AMBIX_READ, 0, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+/* files that are not stale must not be 'recovered' */
+static int check_recover(const char*path) {
+  ambix_t*ambix=NULL;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=5000, ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata;
+  unsigned char freechunk[12+8]={'f', 'r', 'e', 'e', 0, 0, 0, 0, 0, 0, 0, 8};
+  int64_t err64;
+  FILE*f;
+
+  STARTTEST("\n");
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  /* a stream has a 'data' chunk of unknown size */
+  ambix=ambixtest_create(path, AMBIX_STREAM, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_checkpoint(ambix)), __LINE__, "checkpoint in a stream failed"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix stream %p", ambix))return 1;
+  if(fail_if((datachunk_size(path)!=-1), __LINE__, "stream has a 'data' chunk of %d bytes", (int)datachunk_size(path)))return 1;
+  if(check_contents(path, AMBIX_READ, 0, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+  if(check_contents(path, AMBIX_READ | AMBIX_RECOVER, 1, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+
+  /* a chunk following the audio data */
+  if(ambixtest_writefile(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambidata, ambichannels, otherdata, extrachannels, framesize))return 1;
+  f=fopen(path, "ab");
+  if(fail_if((NULL==f), __LINE__, "couldn't append to '%s'", path))return 1;
+  fwrite(freechunk, 1, sizeof(freechunk), f);
+  fclose(f);
+  if(check_contents(path, AMBIX_READ | AMBIX_RECOVER, 0, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if((AMBIX_ERR_INVALID_HANDLE!=ambix_checkpoint(NULL)), __LINE__, "checkpoint without a file");
+  fail_if((0!=ambix_is_recovered(NULL)), __LINE__, "recovered without a file");
+  fail_if(check_checkpoint(path, 0), __LINE__, "checkpoints failed");
+  fail_if(check_checkpoint(path, AMBIX_DIRECT), __LINE__, "checkpoints in an unbuffered file failed");
+  fail_if(check_recover(path), __LINE__, "recovering files failed");
+  return pass();
+}
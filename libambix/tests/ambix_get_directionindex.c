@@ -0,0 +1,116 @@
+#include "common.h"
+
+#include <string.h>
+#include <math.h>
+
+static int check_blocks(ambix_t*ambix, uint32_t blocksize, int64_t numblocks, float32_t eps) {
+  ambix_direction_t*blocks=(ambix_direction_t*)calloc(numblocks+1, sizeof(*blocks));
+  int64_t*found=(int64_t*)calloc(numblocks+1, sizeof(*found));
+  int64_t got, b;
+
+  if(fail_if((blocksize!=ambix_get_directionindex_blocksize(ambix)), __LINE__, "blocksize is %d, expected %d", ambix_get_directionindex_blocksize(ambix), blocksize))return 1;
+  got=ambix_get_directionindex(ambix, 0, blocks, numblocks+1);
+  if(fail_if((got!=numblocks), __LINE__, "got %d blocks, expected %d", (int)got, (int)numblocks))return 1;
+  for(b=0; b<numblocks; b++) {
+    /* a single plane wave: the intensity has the magnitude of the energy and points to the source */
+    const float32_t*I=blocks[b].intensity;
+    const float32_t x=(b<numblocks/2)?0.:1.;
+    const float32_t y=(b<numblocks/2)?1.:0.;
+    if(fail_if((blocks[b].energy<0.1), __LINE__, "block#%d has energy %f", (int)b, blocks[b].energy))return 1;
+    if(fail_if((fabs(I[0]-x*blocks[b].energy)>eps || fabs(I[1]-y*blocks[b].energy)>eps || fabs(I[2])>eps), __LINE__,
+               "block#%d has intensity [%f %f %f] with energy %f", (int)b, I[0], I[1], I[2], blocks[b].energy))return 1;
+  }
+
+  /* the first half comes from the left, the second half from the front */
+  got=ambix_find_direction(ambix, M_PI/2., 0., 0.1, 0.01, found, numblocks+1);
+  if(fail_if((got!=numblocks/2), __LINE__, "found %d blocks from the left, expected %d", (int)got, (int)numblocks/2))return 1;
+  for(b=0; b<got; b++)
+    if(fail_if((found[b]!=b), __LINE__, "found block#%d, expected %d", (int)found[b], (int)b))return 1;
+  got=ambix_find_direction(ambix, 0., 0., 0.1, 0.01, found, numblocks+1);
+  if(fail_if((got!=numblocks/2), __LINE__, "found %d blocks from the front, expected %d", (int)got, (int)numblocks/2))return 1;
+  for(b=0; b<got; b++)
+    if(fail_if((found[b]!=numblocks/2+b), __LINE__, "found block#%d, expected %d", (int)found[b], (int)(numblocks/2+b)))return 1;
+  got=ambix_find_direction(ambix, M_PI, 0., 0.5, 0.01, found, numblocks+1);
+  if(fail_if((0!=got), __LINE__, "found %d blocks from the back", (int)got))return 1;
+  got=ambix_find_direction(ambix, 0., 0., 0.1, 10., found, numblocks+1);
+  if(fail_if((0!=got), __LINE__, "found %d blocks above the threshold", (int)got))return 1;
+  got=ambix_find_direction(ambix, 0., 0., 0.1, 0.01, found, 1);
+  if(fail_if((1!=got), __LINE__, "found %d blocks, but asked for 1", (int)got))return 1;
+
+  free(blocks);
+  free(found);
+  return 0;
+}
+
+static int check_direction(const char*path, ambix_sampleformat_t format, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=8192, blocksize=1024;
+  uint32_t ambichannels=4, extrachannels=1;
+  float32_t*ambidata, *otherdata, *resultambi, *resultother;
+  ambix_direction_t block;
+  int64_t err64;
+  uint32_t f;
+
+  STARTTEST("format=%d\n", format);
+  /* a plane wave from the left (ACN#1), then from the front (ACN#3) */
+  ambidata=(float32_t*)calloc(framesize*ambichannels, sizeof(float32_t));
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  for(f=0; f<framesize; f++) {
+    const float32_t s=0.5*sin(f*2.*M_PI*441./44100.);
+    ambidata[f*ambichannels+0]=s;
+    ambidata[f*ambichannels+((f<framesize/2)?1:3)]=s;
+  }
+  mtx=ambix_matrix_init(ambichannels, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  ambix=ambixtest_create(path, 0, format, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_directionindex(ambix, blocksize)), __LINE__, "couldn't enable directional energy index"))return 1;
+  if(AMBIX_SAMPLEFORMAT_PCM16==format || AMBIX_SAMPLEFORMAT_PCM24==format)
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_dither(ambix, AMBIX_DITHER_NONE)), __LINE__, "couldn't set dither"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS==ambix_set_directionindex(ambix, 0)), __LINE__, "could change directional energy index after writing"))return 1;
+  if(check_blocks(ambix, blocksize, framesize/blocksize, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(check_blocks(ambix, blocksize, framesize/blocksize, eps))return 1;
+  /* the index must not displace the sample frames */
+  resultambi=(float32_t*)calloc(blocksize*ambichannels, sizeof(float32_t));
+  resultother=(float32_t*)calloc(blocksize*extrachannels, sizeof(float32_t));
+  err64=ambix_readf_float32(ambix, resultambi, resultother, blocksize);
+  if(fail_if((err64!=blocksize), __LINE__, "read %d frames, expected %d", (int)err64, (int)blocksize))return 1;
+  if(fail_if((data_diff(__LINE__, FLOAT32, ambidata, resultambi, blocksize*ambichannels, eps)>eps), __LINE__, "ambidata differs"))return 1;
+  if(fail_if((data_diff(__LINE__, FLOAT32, otherdata, resultother, blocksize*extrachannels, eps)>eps), __LINE__, "otherdata differs"))return 1;
+  free(resultambi);
+  free(resultother);
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* files written without an index don't have one */
+  if(ambixtest_writefile(path, 0, format, mtx, ambidata, ambichannels, otherdata, extrachannels, blocksize))return 1;
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((0!=ambix_get_directionindex_blocksize(ambix)), __LINE__, "file without index has a blocksize"))return 1;
+  if(fail_if((ambix_get_directionindex(ambix, 0, &block, 1)>=0), __LINE__, "got index of file without index"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_direction(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1e-5), __LINE__, "FLOAT32 directional energy index failed");
+  fail_if(check_direction(path, AMBIX_SAMPLEFORMAT_PCM16, 1e-4), __LINE__, "PCM16 directional energy index failed");
+  fail_if(check_direction(path, AMBIX_SAMPLEFORMAT_PCM24, 1e-5), __LINE__, "PCM24 directional energy index failed");
+  return pass();
+}
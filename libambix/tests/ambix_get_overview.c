@@ -0,0 +1,161 @@
+#include "common.h"
+
+#include <string.h>
+#include <math.h>
+
+static ambix_overview_t expected_bin(const float32_t*ambidata, uint32_t ambichannels, const float32_t*otherdata, uint32_t extrachannels,
+                                     uint32_t channel, uint64_t start, uint64_t stop) {
+  ambix_overview_t bin;
+  float64_t sumsq=0.;
+  uint64_t f;
+  bin.min= 1e30;
+  bin.max=-1e30;
+  for(f=start; f<stop; f++) {
+    float32_t v=(channel<ambichannels)?ambidata[f*ambichannels+channel]:otherdata[f*extrachannels+channel-ambichannels];
+    if(v<bin.min)bin.min=v;
+    if(v>bin.max)bin.max=v;
+    sumsq+=(float64_t)v*v;
+  }
+  bin.rms=(float32_t)sqrt(sumsq/(float64_t)(stop-start));
+  return bin;
+}
+
+static int check_bins(ambix_t*ambix, const float32_t*ambidata, uint32_t ambichannels, const float32_t*otherdata, uint32_t extrachannels,
+                      uint64_t frames, int partial, float32_t eps) {
+  const uint32_t channels=ambichannels+extrachannels;
+  ambix_overview_t*bins=NULL;
+  uint32_t level, c;
+  for(level=0; ; level++) {
+    uint32_t binsize=ambix_get_overview_binsize(ambix, level);
+    int64_t numbins, got, b;
+    if(!binsize)
+      break;
+    numbins=partial?((frames+binsize-1)/binsize):(frames/binsize);
+    bins=(ambix_overview_t*)realloc(bins, (numbins+1)*sizeof(*bins));
+    for(c=0; c<channels; c++) {
+      got=ambix_get_overview(ambix, c, level, 0, bins, numbins+1);
+      if(fail_if((got!=numbins), __LINE__, "level#%d channel#%d has %d bins, expected %d", level, c, (int)got, (int)numbins))return 1;
+      for(b=0; b<numbins; b++) {
+        uint64_t stop=(b+1)*binsize;
+        ambix_overview_t exp=expected_bin(ambidata, ambichannels, otherdata, extrachannels, c, b*binsize, (stop>frames)?frames:stop);
+        if(fail_if((fabs(bins[b].min-exp.min)>eps), __LINE__, "level#%d channel#%d bin#%d: min %f, expected %f", level, c, (int)b, bins[b].min, exp.min))return 1;
+        if(fail_if((fabs(bins[b].max-exp.max)>eps), __LINE__, "level#%d channel#%d bin#%d: max %f, expected %f", level, c, (int)b, bins[b].max, exp.max))return 1;
+        if(fail_if((fabs(bins[b].rms-exp.rms)>eps), __LINE__, "level#%d channel#%d bin#%d: rms %f, expected %f", level, c, (int)b, bins[b].rms, exp.rms))return 1;
+      }
+    }
+    /* an offset beyond the end yields no bins */
+    got=ambix_get_overview(ambix, 0, level, numbins, bins, 1);
+    if(fail_if((0!=got), __LINE__, "level#%d has %d bins beyond the end", level, (int)got))return 1;
+  }
+  if(fail_if((level<3), __LINE__, "only %d overview levels", level))return 1;
+  if(fail_if((ambix_get_overview(ambix, channels, 0, 0, bins, 1)>=0), __LINE__, "got bins for non-existing channel"))return 1;
+  free(bins);
+  return 0;
+}
+
+/* the overview is written when closing the file, and must not displace the sample frames */
+static int check_frames(ambix_t*ambix, const float32_t*ambidata, uint32_t ambichannels, const float32_t*otherdata, uint32_t extrachannels,
+                        int64_t frames, float32_t eps) {
+  float32_t*resultambi=(float32_t*)calloc(ambichannels*frames, sizeof(float32_t));
+  float32_t*resultother=(float32_t*)calloc(extrachannels*frames, sizeof(float32_t));
+  float32_t diff;
+  int64_t err64=ambix_readf_float32(ambix, resultambi, resultother, frames);
+  if(fail_if((err64!=frames), __LINE__, "read %d frames, expected %d", (int)err64, (int)frames))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*frames, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*frames, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+static int check_overview(const char*path, ambix_sampleformat_t format, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_overview_t bin;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=70000;
+  uint32_t ambichannels=4, extrachannels=1;
+  float32_t*ambidata, *otherdata;
+  int64_t err64;
+
+  STARTTEST("format=%d\n", format);
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 50);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(ambichannels, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  ambix=ambixtest_create(path, 0, format, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_overview(ambix, 1)), __LINE__, "couldn't enable overview"))return 1;
+  if(AMBIX_SAMPLEFORMAT_PCM16==format || AMBIX_SAMPLEFORMAT_PCM24==format)
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_dither(ambix, AMBIX_DITHER_NONE)), __LINE__, "couldn't set dither"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS==ambix_set_overview(ambix, 0)), __LINE__, "could change overview after writing"))return 1;
+  /* while writing, only the completed bins are available */
+  if(check_bins(ambix, ambidata, ambichannels, otherdata, extrachannels, framesize, 0, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(check_bins(ambix, ambidata, ambichannels, otherdata, extrachannels, framesize, 1, eps))return 1;
+  if(check_frames(ambix, ambidata, ambichannels, otherdata, extrachannels, 1024, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* files written without an overview don't have one */
+  if(ambixtest_writefile(path, 0, format, mtx, ambidata, ambichannels, otherdata, extrachannels, 1000))return 1;
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((0!=ambix_get_overview_binsize(ambix, 0)), __LINE__, "file without overview has a binsize"))return 1;
+  if(fail_if((ambix_get_overview(ambix, 0, 0, 0, &bin, 1)>=0), __LINE__, "got overview of file without overview"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+/* long files get a coarser overview, rather than an unbounded one */
+static int check_decimated(const char*path, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  uint32_t framesize=16384*256+300000;
+  float32_t*ambidata;
+  int64_t err64;
+
+  STARTTEST("\n");
+  ambidata=data_sine(FLOAT32, framesize, 1, 50);
+  ambix=ambixtest_create(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, NULL, 1, 0);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_overview(ambix, 1)), __LINE__, "couldn't enable overview"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, NULL, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((512!=ambix_get_overview_binsize(ambix, 0)), __LINE__, "binsize is %d, expected 512", ambix_get_overview_binsize(ambix, 0)))return 1;
+  if(check_bins(ambix, ambidata, 1, NULL, 0, framesize, 0, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(check_bins(ambix, ambidata, 1, NULL, 0, framesize, 1, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  free(ambidata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_overview(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1e-5), __LINE__, "FLOAT32 overview failed");
+  fail_if(check_overview(path, AMBIX_SAMPLEFORMAT_PCM16, 1.01/32768.), __LINE__, "PCM16 overview failed");
+  fail_if(check_overview(path, AMBIX_SAMPLEFORMAT_PCM24, 1e-5), __LINE__, "PCM24 overview failed");
+  fail_if(check_decimated(path, 1e-5), __LINE__, "decimated overview failed");
+  return pass();
+}
@@ -0,0 +1,130 @@
+#include "common.h"
+
+#include <string.h>
+#include <math.h>
+
+static int check_peaks(const char*path, ambix_sampleformat_t format, float32_t eps, float32_t peakeps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=4096, half=1000;
+  uint32_t ambichannels=4, extrachannels=1;
+  uint32_t fullchannels;
+  float32_t*ambidata, *otherdata, *refambi, *refother, *resultambi, *resultother;
+  float32_t peaks[6], expected[5];
+  int64_t positions[6], expectedpos[5];
+  uint32_t f, c;
+  int64_t err64;
+  float32_t diff;
+
+  STARTTEST("format=%d\n", format);
+
+  /* a horizontal-only recording: the Z-channel (ACN#2) is empty */
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  for(f=0; f<framesize; f++)
+    ambidata[f*ambichannels+2]=0.;
+
+  /* 2nd order from 1st order; row#2 only depends on Z */
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  for(f=0; f<mtx->rows; f++)
+    for(c=0; c<mtx->cols; c++)
+      mtx->data[f][c]=(float32_t)(f+1)/(float32_t)(c+3)/8.;
+  for(c=0; c<mtx->cols; c++)
+    mtx->data[2][c]=(2==c)?1.:0.;
+  fullchannels=mtx->rows;
+
+  ambix=ambixtest_create(path, 0, format, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+
+  /* the peaks are tracked while writing (and stored when closing) */
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_get_peaks(ambix, expected, 5)), __LINE__, "couldn't get peaks while writing"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_get_peak_positions(ambix, expectedpos, 5)), __LINE__, "couldn't get peak positions while writing"))return 1;
+  for(c=0; c<ambichannels+extrachannels; c++) {
+    float32_t peak=0.;
+    int64_t pos=0;
+    for(f=0; f<framesize; f++) {
+      float32_t v=(c<ambichannels)?ambidata[f*ambichannels+c]:otherdata[f*extrachannels+c-ambichannels];
+      v=(v<0)?-v:v;
+      if(v>peak) {
+        peak=v;
+        pos=f;
+      }
+    }
+    /* quantization might shift the values a bit (and thus the positions) */
+    if(fail_if((fabs(expected[c]-peak)>peakeps), __LINE__, "written peak#%d is %f, expected %f", c, expected[c], peak))return 1;
+    if(AMBIX_SAMPLEFORMAT_FLOAT32==format)
+      if(fail_if((expectedpos[c]!=pos), __LINE__, "written peak#%d at %d, expected %d", c, (int)expectedpos[c], (int)pos))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  refambi=(float32_t*)calloc(fullchannels*framesize, sizeof(float32_t));
+  refother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  resultambi=(float32_t*)calloc(fullchannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+
+  /* reference: decode with the full matrix */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((fullchannels!=info.ambichannels), __LINE__, "got %d ambichannels, expected %d", info.ambichannels, fullchannels))return 1;
+  err64=ambix_readf_float32(ambix, refambi, refother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* querying the peaks in the middle of reading must not disturb the read position */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, half);
+  if(fail_if((err64!=half), __LINE__, "read only %d frames of %d", (int)err64, (int)half))return 1;
+
+  for(c=0; c<6; c++)
+    peaks[c]=-1.;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_get_peaks(ambix, peaks, 6)), __LINE__, "couldn't get peaks"))return 1;
+  for(c=0; c<ambichannels+extrachannels; c++) {
+    if(2==c) {
+      if(fail_if((0.!=peaks[c]), __LINE__, "silent channel#%d has peak %f", c, peaks[c]))return 1;
+    } else {
+      if(fail_if((peaks[c]<=0. || peaks[c]>1.), __LINE__, "channel#%d has peak %f", c, peaks[c]))return 1;
+    }
+    if(fail_if((expected[c]!=peaks[c]), __LINE__, "read peak#%d is %f, written %f", c, peaks[c], expected[c]))return 1;
+  }
+  if(fail_if((0.!=peaks[5]), __LINE__, "excess peak is %f", peaks[5]))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_get_peak_positions(ambix, positions, 6)), __LINE__, "couldn't get peak positions"))return 1;
+  for(c=0; c<ambichannels+extrachannels; c++)
+    if(fail_if((positions[c]>=0 && positions[c]!=expectedpos[c]), __LINE__, "read peak#%d at %d, written at %d", c, (int)positions[c], (int)expectedpos[c]))return 1;
+  if(fail_if((-1!=positions[5]), __LINE__, "excess peak position is %d", (int)positions[5]))return 1;
+
+  /* the rest is decoded with the silent column (and the row that only depends on it) skipped */
+  err64=ambix_readf_float32(ambix, resultambi+half*fullchannels, resultother+half*extrachannels, framesize-half);
+  if(fail_if((err64!=framesize-half), __LINE__, "read only %d frames of %d", (int)err64, (int)(framesize-half)))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  diff=data_diff(__LINE__, FLOAT32, refambi, resultambi, fullchannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, refother, resultother, extrachannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(refambi);
+  free(refother);
+  free(resultambi);
+  free(resultother);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_peaks(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1e-7, 0.), __LINE__, "FLOAT32 peaks failed");
+  fail_if(check_peaks(path, AMBIX_SAMPLEFORMAT_PCM16, 1e-7, 1.01/32768.), __LINE__, "PCM16 peaks failed");
+  fail_if(check_peaks(path, AMBIX_SAMPLEFORMAT_PCM24, 1e-7, 1.01/8388608.), __LINE__, "PCM24 peaks failed");
+  return pass();
+}
@@ -0,0 +1,88 @@
+#include "common.h"
+
+#include <string.h>
+
+static int check_endianness(const char*path, ambix_filemode_t flags, ambix_sampleformat_t format, const unsigned char*data,
+                            uint32_t samplesize, uint32_t channels, uint32_t frames) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  const ambix_matrix_t*rmtx=NULL;
+  ambix_marker_t marker;
+  float32_t*fdata=(float32_t*)calloc(channels*frames, sizeof(float32_t));
+  float32_t*rdata=(float32_t*)calloc(channels*frames, sizeof(float32_t));
+  unsigned char*raw=(unsigned char*)calloc(channels*frames, samplesize);
+  int64_t err64;
+  float32_t diff;
+  uint32_t i;
+
+  STARTTEST("flags=0x%x format=%d\n", flags, format);
+  for(i=0; i<channels*frames; i++)
+    fdata[i]=(float32_t)((int)i%1999 - 999)/1024.;
+
+  mtx=ambix_matrix_init(ambix_order2channels(2), channels, mtx);
+  for(i=0; i<mtx->rows; i++)
+    mtx->data[i][i%channels]=(float32_t)(i+1)/8.;
+  memset(&marker, 0, sizeof(marker));
+  marker.position=42.;
+  strncpy(marker.name, "mark", 255);
+
+  ambix=ambixtest_create(path, flags, format, mtx, channels, 0);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_add_marker(ambix, &marker)), __LINE__, "failed adding marker"))return 1;
+  if(data)
+    err64=ambix_writef_pcm24_raw(ambix, data, NULL, frames);
+  else
+    err64=ambix_writef_float32(ambix, fdata, NULL, frames);
+  if(fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* headers (matrix, markers) are independent of the sample byte order */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  rmtx=ambix_get_adaptormatrix(ambix);
+  if(fail_if((NULL==rmtx), __LINE__, "failed reading adaptor matrix"))return 1;
+  diff=matrix_diff(__LINE__, mtx, rmtx, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "adaptormatrix diff %f > %f", diff, 1e-7))return 1;
+  if(fail_if((1!=ambix_get_num_markers(ambix)), __LINE__, "got %d markers", ambix_get_num_markers(ambix)))return 1;
+  if(fail_if((42.!=ambix_get_marker(ambix, 0)->position), __LINE__, "marker position mismatch %f", ambix_get_marker(ambix, 0)->position))return 1;
+
+  if(data) {
+    err64=ambix_readf_pcm24_raw(ambix, raw, NULL, frames);
+    if(fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames))return 1;
+    if(fail_if(memcmp(data, raw, channels*frames*samplesize), __LINE__, "raw data mismatch"))return 1;
+  } else {
+    err64=ambix_readf_float32(ambix, rdata, NULL, frames);
+    if(fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames))return 1;
+    diff=data_diff(__LINE__, FLOAT32, fdata, rdata, channels*frames, 1e-7);
+    if(fail_if((diff>1e-7), __LINE__, "data diff %f > %f", diff, 1e-7))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(fdata);
+  free(rdata);
+  free(raw);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  /* odd sizes, so that SIMD loops have some tail to process */
+  const uint32_t channels=3, frames=1001;
+  unsigned char*data=(unsigned char*)malloc(3*channels*frames);
+  uint32_t i;
+  for(i=0; i<3*channels*frames; i++)
+    data[i]=(unsigned char)(i*7+(i>>8));
+
+  fail_if(check_endianness(path, 0, AMBIX_SAMPLEFORMAT_PCM24, data, 3, channels, frames), __LINE__, "default endianness (PCM24) failed");
+  fail_if(check_endianness(path, AMBIX_NATIVEENDIAN, AMBIX_SAMPLEFORMAT_PCM24, data, 3, channels, frames), __LINE__, "native endianness (PCM24) failed");
+  fail_if(check_endianness(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, NULL, 4, channels, frames), __LINE__, "default endianness (FLOAT32) failed");
+  fail_if(check_endianness(path, AMBIX_NATIVEENDIAN, AMBIX_SAMPLEFORMAT_FLOAT32, NULL, 4, channels, frames), __LINE__, "native endianness (FLOAT32) failed");
+
+  free(data);
+  return pass();
+}
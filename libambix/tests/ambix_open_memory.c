@@ -0,0 +1,100 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+static int check_read(ambix_t*ambix, ambix_info_t*info, const float32_t*ambidata, const float32_t*otherdata,
+                      uint32_t ambichannels, uint32_t extrachannels, uint32_t framesize, float32_t eps) {
+  float32_t*resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  float32_t*resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  int64_t err64;
+  float32_t diff;
+  if(fail_if((ambichannels!=info->ambichannels), __LINE__, "got %d ambichannels, expected %d", info->ambichannels, ambichannels))return 1;
+  if(fail_if((extrachannels!=info->extrachannels), __LINE__, "got %d extrachannels, expected %d", info->extrachannels, extrachannels))return 1;
+  if(fail_if((framesize!=info->frames), __LINE__, "got %d frames, expected %d", (int)info->frames, (int)framesize))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+static int check_memory(const char*path, ambix_sampleformat_t format, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=1000;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata;
+  void*buffer=(void*)&buffer;
+  size_t size=1;
+  int64_t err64;
+  FILE*f;
+
+  STARTTEST("format=%d\n", format);
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  /* write into memory */
+  ambix=ambix_open_memory_write(&buffer, &size, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't create in-memory ambix file"))return 1;
+  if(fail_if((NULL!=buffer || 0!=size), __LINE__, "buffer %p[%d] handed out before closing", buffer, (int)size))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)), __LINE__, "failed setting adaptor matrix"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  if(fail_if((NULL==buffer || 0==size), __LINE__, "no buffer after closing"))return 1;
+
+  /* read it back from memory */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open_memory(buffer, size, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open in-memory ambix file"))return 1;
+  if(check_read(ambix, &info, ambidata, otherdata, ambichannels, extrachannels, framesize, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* the buffer is an ordinary ambix file */
+  f=fopen(path, "wb");
+  if(fail_if((NULL==f), __LINE__, "couldn't open '%s'", path))return 1;
+  if(fail_if((size!=fwrite(buffer, 1, size, f)), __LINE__, "couldn't write '%s'", path))return 1;
+  fclose(f);
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(check_read(ambix, &info, ambidata, otherdata, ambichannels, extrachannels, framesize, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* garbage is rejected */
+  memset(buffer, 0, size);
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open_memory(buffer, size, &info);
+  if(fail_if((NULL!=ambix), __LINE__, "opened garbage as ambix file"))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(buffer);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_memory(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1e-7), __LINE__, "FLOAT32 in-memory file failed");
+  fail_if(check_memory(path, AMBIX_SAMPLEFORMAT_PCM16, 1./32768.), __LINE__, "PCM16 in-memory file failed");
+  return pass();
+}
@@ -0,0 +1,133 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/* a growable memory buffer as virtual file */
+typedef struct membuf_t {
+  unsigned char*data;
+  int64_t size;
+  int64_t allocated;
+  int64_t pos;
+} membuf_t;
+
+static int64_t mem_get_filelen(void*user) {
+  return ((membuf_t*)user)->size;
+}
+static int64_t mem_seek(int64_t offset, int whence, void*user) {
+  membuf_t*buf=(membuf_t*)user;
+  switch(whence) {
+  case SEEK_SET: break;
+  case SEEK_CUR: offset+=buf->pos; break;
+  case SEEK_END: offset+=buf->size; break;
+  default: return -1;
+  }
+  if(offset<0)
+    return -1;
+  buf->pos=offset;
+  return buf->pos;
+}
+static int64_t mem_read(void*ptr, int64_t count, void*user) {
+  membuf_t*buf=(membuf_t*)user;
+  if(buf->pos>=buf->size)
+    return 0;
+  if(count>buf->size-buf->pos)
+    count=buf->size-buf->pos;
+  memcpy(ptr, buf->data+buf->pos, count);
+  buf->pos+=count;
+  return count;
+}
+static int64_t mem_write(const void*ptr, int64_t count, void*user) {
+  membuf_t*buf=(membuf_t*)user;
+  if(buf->pos+count>buf->allocated) {
+    int64_t allocated=2*(buf->pos+count);
+    unsigned char*data=(unsigned char*)realloc(buf->data, allocated);
+    if(!data)
+      return 0;
+    buf->data=data;
+    buf->allocated=allocated;
+  }
+  memcpy(buf->data+buf->pos, ptr, count);
+  buf->pos+=count;
+  if(buf->pos>buf->size)
+    buf->size=buf->pos;
+  return count;
+}
+static int64_t mem_tell(void*user) {
+  return ((membuf_t*)user)->pos;
+}
+
+static int check_virtual(ambix_sampleformat_t format, float32_t eps) {
+  ambix_virtual_io_t vio={mem_get_filelen, mem_seek, mem_read, mem_write, mem_tell};
+  membuf_t buf;
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=1000;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata, *resultambi, *resultother;
+  int64_t err64;
+  float32_t diff;
+
+  STARTTEST("format=%d\n", format);
+  memset(&buf, 0, sizeof(buf));
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  /* callbacks are mandatory */
+  if(fail_if((NULL!=ambix_open_virtual(NULL, AMBIX_WRITE, &info, &buf)), __LINE__, "opened virtual file without callbacks"))return 1;
+
+  ambix=ambix_open_virtual(&vio, AMBIX_WRITE, &info, &buf);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't create virtual ambix file for writing"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)), __LINE__, "failed setting adaptor matrix"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  if(fail_if((buf.size<=0), __LINE__, "nothing written to the virtual file"))return 1;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  buf.pos=0;
+  ambix=ambix_open_virtual(&vio, AMBIX_READ, &info, &buf);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open virtual ambix file for reading"))return 1;
+  if(fail_if((AMBIX_EXTENDED!=info.fileformat), __LINE__, "got fileformat %d, expected %d", info.fileformat, AMBIX_EXTENDED))return 1;
+  if(fail_if((ambichannels!=info.ambichannels), __LINE__, "got %d ambichannels, expected %d", info.ambichannels, ambichannels))return 1;
+  if(fail_if((extrachannels!=info.extrachannels), __LINE__, "got %d extrachannels, expected %d", info.extrachannels, extrachannels))return 1;
+  if(fail_if((framesize!=info.frames), __LINE__, "got %d frames, expected %d", (int)info.frames, (int)framesize))return 1;
+  if(fail_if((NULL==ambix_get_adaptormatrix(ambix)), __LINE__, "no adaptor matrix"))return 1;
+  diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), mtx, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "adaptor matrix diff %f > %f", diff, 1e-7))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  free(buf.data);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  fail_if(check_virtual(AMBIX_SAMPLEFORMAT_FLOAT32, 1e-7), __LINE__, "FLOAT32 virtual I/O failed");
+  fail_if(check_virtual(AMBIX_SAMPLEFORMAT_PCM24, 1./8388608.), __LINE__, "PCM24 virtual I/O failed");
+  return pass();
+}
@@ -0,0 +1,119 @@
+#include "common.h"
+
+#include <string.h>
+
+/* pack a 24bit value into 3 bytes of host byte order */
+static void pack24(unsigned char*dest, int32_t value) {
+  const union { uint32_t i; unsigned char c[4]; } u = { 0x01020304 };
+  if(0x01 == u.c[0]) {
+    dest[0]=(value>>16)&0xFF; dest[1]=(value>>8)&0xFF; dest[2]=value&0xFF;
+  } else {
+    dest[0]=value&0xFF; dest[1]=(value>>8)&0xFF; dest[2]=(value>>16)&0xFF;
+  }
+}
+
+static int32_t testvalue(uint32_t frame, uint32_t channel) {
+  /* some 24bit value (with varying sign) that is unique per frame and channel */
+  return ((int32_t)(frame*37 + channel*1000003) % 0x7FFFFF) * ((frame&1)?-1:1);
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=1000;
+  uint32_t ambichannels=4, extrachannels=2;
+  unsigned char*ambidata, *otherdata, *resultambi, *resultother;
+  int32_t*intambi, *intother;
+  uint32_t f, c;
+  int64_t err64;
+  /* swap X and Y, W stays, Z gets zeroed */
+  float32_t swapXY[]={
+    1, 0, 0, 0,
+    0, 0, 0, 1,
+    0, 0, 0, 0,
+    0, 1, 0, 0,
+  };
+
+  ambidata=(unsigned char*)calloc(3*ambichannels, framesize);
+  otherdata=(unsigned char*)calloc(3*extrachannels, framesize);
+  resultambi=(unsigned char*)calloc(3*ambichannels, framesize);
+  resultother=(unsigned char*)calloc(3*extrachannels, framesize);
+  intambi=(int32_t*)calloc(ambichannels*framesize, sizeof(int32_t));
+  intother=(int32_t*)calloc(extrachannels*framesize, sizeof(int32_t));
+  for(f=0; f<framesize; f++) {
+    for(c=0; c<ambichannels; c++)
+      pack24(ambidata+3*(f*ambichannels+c), testvalue(f, c));
+    for(c=0; c<extrachannels; c++)
+      pack24(otherdata+3*(f*extrachannels+c), testvalue(f, ambichannels+c));
+  }
+
+  mtx=ambix_matrix_init(ambichannels, ambichannels, mtx);
+  fail_if((NULL==mtx), __LINE__, "couldn't create matrix");
+  ambix_matrix_fill_data(mtx, swapXY);
+
+  ambix=ambixtest_create(path, 0, AMBIX_SAMPLEFORMAT_PCM24, mtx, ambichannels, extrachannels);
+  err64=ambix_writef_pcm24_raw(ambix, ambidata, otherdata, framesize);
+  fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* read back packed data as EXTENDED: must be unchanged */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  err64=ambix_readf_pcm24_raw(ambix, resultambi, resultother, framesize);
+  fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize);
+  fail_if(memcmp(ambidata, resultambi, 3*ambichannels*framesize), __LINE__, "ambisonics data mismatch");
+  fail_if(memcmp(otherdata, resultother, 3*extrachannels*framesize), __LINE__, "non-ambisonics data mismatch");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* read back as 32bit integers: must be the same values */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  err64=ambix_readf_int32(ambix, intambi, intother, framesize);
+  fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  for(f=0; f<framesize; f++) {
+    for(c=0; c<ambichannels; c++)
+      fail_if((intambi[f*ambichannels+c]>>8 != testvalue(f, c)), __LINE__, "ambisonics sample mismatch @ %d/%d", f, c);
+    for(c=0; c<extrachannels; c++)
+      fail_if((intother[f*extrachannels+c]>>8 != testvalue(f, ambichannels+c)), __LINE__, "non-ambisonics sample mismatch @ %d/%d", f, c);
+  }
+
+  /* read back as BASIC: the routing matrix is applied to the packed data */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  err64=ambix_readf_pcm24_raw(ambix, resultambi, resultother, framesize);
+  fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  for(f=0; f<framesize; f++) {
+    unsigned char expected[3];
+    for(c=0; c<ambichannels; c++) {
+      const unsigned char*got=resultambi+3*(f*ambichannels+c);
+      switch(c) {
+      case 0: pack24(expected, testvalue(f, 0)); break;
+      case 1: pack24(expected, testvalue(f, 3)); break;
+      case 2: pack24(expected, 0); break;
+      case 3: pack24(expected, testvalue(f, 1)); break;
+      }
+      fail_if(memcmp(expected, got, 3), __LINE__, "routed sample mismatch @ %d/%d", f, c);
+    }
+  }
+  fail_if(memcmp(otherdata, resultother, 3*extrachannels*framesize), __LINE__, "non-ambisonics data mismatch");
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  free(intambi);
+  free(intother);
+  ambixtest_rmfile(path);
+  return pass();
+}
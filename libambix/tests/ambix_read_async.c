@@ -0,0 +1,138 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+static int check_async(const char*path, ambix_fileformat_t fileformat, uint32_t framesize) {
+  const uint32_t blocksize=1000, numblocks=framesize/blocksize;
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_completion_t completions[40];
+  float32_t*refambi, *refother, *resultambi, *resultother;
+  uint32_t ambichannels, extrachannels, got=0, b;
+  int64_t err64;
+  float32_t diff;
+
+  /* read the file synchronously as a reference */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=fileformat;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  ambichannels=info.ambichannels;
+  extrachannels=info.extrachannels;
+  refambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  refother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  err64=ambix_readf_float32(ambix, refambi, refother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=fileformat;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  /* nothing to reap yet */
+  if(fail_if((0!=ambix_read_reap(ambix, completions, 40, 1)), __LINE__, "reaped requests that were never submitted"))return 1;
+
+  /* submit all blocks (backwards) */
+  for(b=numblocks; b--; ) {
+    ambix_err_t err=ambix_read_submit(ambix, b*blocksize, resultambi+b*blocksize*ambichannels, resultother+b*blocksize*extrachannels,
+                                      blocksize, (void*)(resultambi+b*blocksize*ambichannels));
+    if(fail_if((AMBIX_ERR_SUCCESS!=err), __LINE__, "submitting block#%d failed with %d", b, err))return 1;
+  }
+  /* the synchronous read position is not affected */
+  if(fail_if((0!=ambix_seek(ambix, 0, SEEK_CUR)), __LINE__, "submitting moved the read position"))return 1;
+
+  while(got<numblocks) {
+    int64_t i, count=ambix_read_reap(ambix, completions, 3, 1);
+    if(fail_if((count<1 || count>3), __LINE__, "reaped %d requests", (int)count))return 1;
+    for(i=0; i<count; i++) {
+      const float32_t*data=(const float32_t*)completions[i].userdata;
+      if(fail_if((data<resultambi || data>=resultambi+framesize*ambichannels), __LINE__, "got bogus userdata %p", completions[i].userdata))return 1;
+      if(fail_if((completions[i].frames!=blocksize), __LINE__, "request read %d frames, expected %d", (int)completions[i].frames, (int)blocksize))return 1;
+    }
+    got+=count;
+  }
+  if(fail_if((0!=ambix_read_reap(ambix, completions, 40, 1)), __LINE__, "reaped more requests than submitted"))return 1;
+  diff=data_diff(__LINE__, FLOAT32, refambi, resultambi, ambichannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  diff=data_diff(__LINE__, FLOAT32, refother, resultother, extrachannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "otherdata diff %f > %f", diff, 1e-7))return 1;
+
+  /* requests are clipped to the audio data */
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_read_submit(ambix, framesize-100, resultambi, resultother, blocksize, NULL)), __LINE__, "submitting the last block failed"))return 1;
+  if(fail_if((1!=ambix_read_reap(ambix, completions, 1, 1)), __LINE__, "couldn't reap the last block"))return 1;
+  if(fail_if((100!=completions[0].frames), __LINE__, "read %d frames at the end, expected 100", (int)completions[0].frames))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_read_submit(ambix, framesize, resultambi, resultother, blocksize, NULL)), __LINE__, "submitting beyond the end failed"))return 1;
+  if(fail_if((1!=ambix_read_reap(ambix, completions, 1, 1)), __LINE__, "couldn't reap the block beyond the end"))return 1;
+  if(fail_if((0!=completions[0].frames), __LINE__, "read %d frames beyond the end", (int)completions[0].frames))return 1;
+
+  /* the queue is limited */
+  for(b=0; b<40; b++) {
+    if(AMBIX_ERR_SUCCESS!=ambix_read_submit(ambix, 0, resultambi, resultother, 10, NULL))
+      break;
+  }
+  if(fail_if((b>=40), __LINE__, "could submit %d requests", b))return 1;
+  if(fail_if((b<4), __LINE__, "could only submit %d requests", b))return 1;
+  /* closing cancels the pending requests */
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  free(refambi);
+  free(refother);
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+static int check_read_async(const char*path, ambix_sampleformat_t format) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=8000;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata;
+  void*buffer=NULL;
+  size_t size=0;
+  FILE*f;
+
+  STARTTEST("format=%d\n", format);
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+  if(ambixtest_writefile(path, 0, format, mtx, ambidata, ambichannels, otherdata, extrachannels, framesize))return 1;
+
+  /* raw channels, and with the adaptor matrix applied */
+  if(check_async(path, AMBIX_EXTENDED, framesize))return 1;
+  if(check_async(path, AMBIX_BASIC, framesize))return 1;
+
+  /* in-memory files cannot be read asynchronously */
+  f=fopen(path, "rb");
+  if(fail_if((NULL==f), __LINE__, "couldn't open '%s'", path))return 1;
+  buffer=malloc(1<<17);
+  size=fread(buffer, 1, 1<<17, f);
+  fclose(f);
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open_memory(buffer, size, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open in-memory ambix file"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS==ambix_read_submit(ambix, 0, ambidata, otherdata, 10, NULL)), __LINE__, "submitted asynchronous read to in-memory file"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(buffer);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_read_async(path, AMBIX_SAMPLEFORMAT_FLOAT32), __LINE__, "FLOAT32 asynchronous reads failed");
+  fail_if(check_read_async(path, AMBIX_SAMPLEFORMAT_PCM16), __LINE__, "PCM16 asynchronous reads failed");
+  fail_if(check_read_async(path, AMBIX_SAMPLEFORMAT_PCM24), __LINE__, "PCM24 asynchronous reads failed");
+  fail_if(check_read_async(path, AMBIX_SAMPLEFORMAT_PCM32), __LINE__, "PCM32 asynchronous reads failed");
+  fail_if(check_read_async(path, AMBIX_SAMPLEFORMAT_FLOAT64), __LINE__, "FLOAT64 asynchronous reads failed");
+  return pass();
+}
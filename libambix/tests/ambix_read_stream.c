@@ -0,0 +1,158 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/* a read-only virtual file (like a pipe): seeking always fails */
+typedef struct pipebuf_t {
+  unsigned char*data;
+  int64_t size;
+  int64_t pos;
+} pipebuf_t;
+
+static int64_t pipe_get_filelen(void*user) {
+  return -1;
+}
+static int64_t pipe_seek(int64_t offset, int whence, void*user) {
+  return -1;
+}
+static int64_t pipe_read(void*ptr, int64_t count, void*user) {
+  pipebuf_t*buf=(pipebuf_t*)user;
+  if(count>buf->size-buf->pos)
+    count=buf->size-buf->pos;
+  memcpy(ptr, buf->data+buf->pos, count);
+  buf->pos+=count;
+  return count;
+}
+static int64_t pipe_tell(void*user) {
+  return -1;
+}
+
+static int write_with_marker(const char*path, ambix_filemode_t mode, const ambix_matrix_t*mtx, const float32_t*ambidata, const float32_t*otherdata,
+                             uint32_t ambichannels, uint32_t extrachannels, uint32_t framesize) {
+  ambix_t*ambix=NULL;
+  ambix_marker_t marker;
+  int64_t err64;
+  memset(&marker, 0, sizeof(marker));
+  marker.position=framesize/2;
+  snprintf(marker.name, sizeof(marker.name), "middle");
+
+  ambix=ambixtest_create(path, mode, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_add_marker(ambix, &marker)), __LINE__, "failed adding marker"))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  return 0;
+}
+
+static int check_stream(ambix_t*ambix, ambix_info_t*info, int64_t frames, const ambix_matrix_t*mtx, const float32_t*ambidata, const float32_t*otherdata,
+                        uint32_t ambichannels, uint32_t extrachannels, uint32_t framesize) {
+  const uint32_t blocksize=300;
+  float32_t*resultambi=(float32_t*)calloc(ambichannels*(framesize+blocksize), sizeof(float32_t));
+  float32_t*resultother=(float32_t*)calloc(extrachannels*(framesize+blocksize), sizeof(float32_t));
+  uint32_t got=0;
+  int64_t err64;
+  float32_t diff;
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix stream for reading"))return 1;
+  if(fail_if((AMBIX_EXTENDED!=info->fileformat), __LINE__, "got fileformat %d, expected %d", info->fileformat, AMBIX_EXTENDED))return 1;
+  if(fail_if((ambichannels!=info->ambichannels), __LINE__, "got %d ambichannels, expected %d", info->ambichannels, ambichannels))return 1;
+  if(fail_if((extrachannels!=info->extrachannels), __LINE__, "got %d extrachannels, expected %d", info->extrachannels, extrachannels))return 1;
+  if(fail_if((frames!=info->frames), __LINE__, "got %lld frames, expected %lld", (long long)info->frames, (long long)frames))return 1;
+  /* the header chunks are available */
+  if(fail_if((NULL==ambix_get_adaptormatrix(ambix)), __LINE__, "no adaptor matrix"))return 1;
+  diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), mtx, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "adaptor matrix diff %f > %f", diff, 1e-7))return 1;
+  if(fail_if((1!=ambix_get_num_markers(ambix)), __LINE__, "got %d markers, expected 1", ambix_get_num_markers(ambix)))return 1;
+  if(fail_if((strcmp(ambix_get_marker(ambix, 0)->name, "middle")), __LINE__, "got marker '%s'", ambix_get_marker(ambix, 0)->name))return 1;
+  /* streams cannot seek */
+  if(fail_if((ambix_seek(ambix, 0, SEEK_SET)>=0), __LINE__, "could seek in stream"))return 1;
+
+  /* read until the stream ends */
+  do {
+    err64=ambix_readf_float32(ambix, resultambi+got*ambichannels, resultother+got*extrachannels, blocksize);
+    if(fail_if((err64<0), __LINE__, "reading returned %d", (int)err64))return 1;
+    got+=err64;
+  } while(err64==blocksize && got<=framesize);
+  if(fail_if((got!=framesize), __LINE__, "read %d frames, expected %d", (int)got, (int)framesize))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "otherdata diff %f > %f", diff, 1e-7))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+static int check_read_stream(const char*path) {
+  ambix_virtual_io_t vio={pipe_get_filelen, pipe_seek, pipe_read, NULL, pipe_tell};
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  pipebuf_t buf;
+  uint32_t framesize=1000;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata;
+  /* a CAF header, followed by a 'uuid' chunk of almost INT64_MAX bytes */
+  const unsigned char bogus[]={'c', 'a', 'f', 'f', 0, 1, 0, 0,
+                               'u', 'u', 'i', 'd', 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF8,
+                               0, 0, 0, 0, 0, 0, 0, 0};
+  FILE*f;
+
+  STARTTEST("\n");
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  /* a stream of unknown length */
+  if(write_with_marker(path, AMBIX_STREAM, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  if(check_stream(ambix_open(path, AMBIX_READ | AMBIX_STREAM, &info), &info, INT64_MAX, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+
+  /* ...through (non-seekable) virtual I/O */
+  memset(&buf, 0, sizeof(buf));
+  f=fopen(path, "rb");
+  if(fail_if((NULL==f), __LINE__, "couldn't open '%s'", path))return 1;
+  buf.data=(unsigned char*)malloc(1<<16);
+  buf.size=fread(buf.data, 1, 1<<16, f);
+  fclose(f);
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  if(check_stream(ambix_open_virtual(&vio, AMBIX_READ | AMBIX_STREAM, &info, &buf), &info, INT64_MAX, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+  free(buf.data);
+
+  /* an ordinary file can be read as stream (and its length is known) */
+  if(write_with_marker(path, 0, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  if(check_stream(ambix_open(path, AMBIX_READ | AMBIX_STREAM, &info), &info, framesize, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+
+  /* garbage is rejected */
+  f=fopen(path, "wb");
+  if(fail_if((NULL==f), __LINE__, "couldn't open '%s'", path))return 1;
+  fwrite(ambidata, sizeof(float32_t), framesize, f);
+  fclose(f);
+  memset(&info, 0, sizeof(info));
+  if(fail_if((NULL!=ambix_open(path, AMBIX_READ | AMBIX_STREAM, &info)), __LINE__, "opened garbage as ambix stream"))return 1;
+  /* ...and so are bogus chunk sizes */
+  f=fopen(path, "wb");
+  if(fail_if((NULL==f), __LINE__, "couldn't open '%s'", path))return 1;
+  fwrite(bogus, 1, sizeof(bogus), f);
+  fclose(f);
+  memset(&info, 0, sizeof(info));
+  if(fail_if((NULL!=ambix_open(path, AMBIX_READ | AMBIX_STREAM, &info)), __LINE__, "opened stream with a bogus chunk"))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_read_stream(path), __LINE__, "reading streams failed");
+  return pass();
+}
@@ -0,0 +1,106 @@
+#include "common.h"
+
+#include <string.h>
+
+static int check_channels(const char*path, ambix_fileformat_t format,
+                          const uint32_t*chanlist, uint32_t numchannels,
+                          uint32_t framesize, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  float32_t*ambidata, *otherdata, *subdata, *refdata;
+  uint32_t ambichannels, extrachannels;
+  uint32_t f, i;
+  int64_t err64;
+  float32_t diff;
+  uint32_t badchannel[1];
+
+  STARTTEST("format=%d\n", format);
+  memset(&info, 0, sizeof(info));
+  info.fileformat=format;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  ambichannels=info.ambichannels;
+  extrachannels=info.extrachannels;
+  ambidata=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  otherdata=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  err64=ambix_readf_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* assemble the expected data from a full read */
+  refdata=(float32_t*)calloc(numchannels*framesize, sizeof(float32_t));
+  for(f=0; f<framesize; f++) {
+    for(i=0; i<numchannels; i++) {
+      uint32_t chan=chanlist[i];
+      refdata[f*numchannels+i]=(chan<ambichannels)
+        ?ambidata[f*ambichannels+chan]
+        :otherdata[f*extrachannels+chan-ambichannels];
+    }
+  }
+
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't re-open ambix file '%s' for reading", path))return 1;
+  subdata=(float32_t*)calloc(numchannels*framesize, sizeof(float32_t));
+
+  /* out-of-range channels are rejected */
+  badchannel[0]=ambichannels+extrachannels;
+  err64=ambix_readf_float32_channels(ambix, badchannel, 1, subdata, framesize);
+  if(fail_if((err64>=0), __LINE__, "reading invalid channel %d succeeded", (int)badchannel[0]))return 1;
+
+  err64=ambix_readf_float32_channels(ambix, chanlist, numchannels, subdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d channel-frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  diff=data_diff(__LINE__, FLOAT32, refdata, subdata, numchannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "channel data diff %f > %f", diff, eps))return 1;
+
+  free(ambidata);
+  free(otherdata);
+  free(refdata);
+  free(subdata);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=4096;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata;
+  uint32_t f, c;
+  /* W, an extra channel, X, two 2nd order channels and X again */
+  const uint32_t basic_channels[] = {0, 10, 3, 7, 8, 3};
+  const uint32_t extended_channels[] = {5, 0, 2};
+
+  ambidata=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  otherdata=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  for(f=0; f<framesize; f++) {
+    for(c=0; c<ambichannels; c++)
+      ambidata[f*ambichannels+c]=(float32_t)(c+1)/(float32_t)(f+ambichannels+1);
+    for(c=0; c<extrachannels; c++)
+      otherdata[f*extrachannels+c]=-(float32_t)(c+1)/(float32_t)(f+extrachannels+1);
+  }
+
+  /* a 9x4 (2nd order from 1st order) adaptor matrix, so reading as BASIC yields 9+2 channels */
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  fail_if((NULL==mtx), __LINE__, "couldn't create matrix");
+  for(f=0; f<mtx->rows; f++)
+    for(c=0; c<mtx->cols; c++)
+      mtx->data[f][c]=(float32_t)(f+1)/(float32_t)(c+3);
+
+  fail_if(ambixtest_writefile(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambidata, ambichannels, otherdata, extrachannels, framesize),
+          __LINE__, "couldn't write ambix file '%s'", path);
+
+  fail_if(check_channels(path, AMBIX_BASIC,
+                         basic_channels, sizeof(basic_channels)/sizeof(*basic_channels),
+                         framesize, 1e-6), __LINE__, "reading channel subset via BASIC failed");
+  fail_if(check_channels(path, AMBIX_EXTENDED,
+                         extended_channels, sizeof(extended_channels)/sizeof(*extended_channels),
+                         framesize, 1e-6), __LINE__, "reading channel subset via EXTENDED failed");
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  return pass();
+}
@@ -0,0 +1,106 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+static int check_segments(const char*pattern, int64_t maxframes, int64_t maxbytes, uint32_t blocksize) {
+  ambix_segmented_t*seg=NULL;
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=10000, ambichannels=4, extrachannels=2;
+  uint32_t segmentframes=(uint32_t)maxframes, numsegments, f, s;
+  float32_t*ambidata, *otherdata, *resultambi, *resultother;
+  int64_t err64, got=0;
+  char path[1024];
+  float32_t diff;
+
+  STARTTEST("maxframes=%d maxbytes=%d blocksize=%d\n", (int)maxframes, (int)maxbytes, blocksize);
+  if(maxbytes)
+    segmentframes=(uint32_t)(maxbytes/((ambichannels+extrachannels)*sizeof(float32_t)));
+  if(!segmentframes)
+    segmentframes=framesize;
+  numsegments=(framesize+segmentframes-1)/segmentframes;
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  seg=ambix_segmented_open(pattern, AMBIX_WRITE, &info, mtx, maxframes, maxbytes);
+  if(fail_if((NULL==seg), __LINE__, "couldn't create segmented ambix file '%s'", pattern))return 1;
+  for(f=0; f<framesize; f+=blocksize) {
+    const uint32_t frames=(framesize-f<blocksize)?(framesize-f):blocksize;
+    err64=ambix_segmented_writef_float32(seg, ambidata+f*ambichannels, otherdata+f*extrachannels, frames);
+    if(fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames))return 1;
+    if(fail_if((ambix_segmented_get_index(seg)!=(f+frames-1)/segmentframes), __LINE__, "writing frame %d to segment %d",
+               f+frames-1, ambix_segmented_get_index(seg)))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_segmented_close(seg)), __LINE__, "closing segmented ambix file %p", seg))return 1;
+
+  /* each segment is a complete ambix file */
+  for(s=0; s<numsegments; s++) {
+    const int64_t frames=(s+1<numsegments)?segmentframes:(framesize-s*segmentframes);
+    snprintf(path, sizeof(path), pattern, s);
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_EXTENDED;
+    ambix=ambix_open(path, AMBIX_READ, &info);
+    if(fail_if((NULL==ambix), __LINE__, "couldn't open segment '%s'", path))return 1;
+    if(fail_if((frames!=info.frames), __LINE__, "segment %d has %d frames, expected %d", s, (int)info.frames, (int)frames))return 1;
+    diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), mtx, 1e-7);
+    if(fail_if((diff>1e-7), __LINE__, "adaptor matrix of segment %d diff %f > %f", s, diff, 1e-7))return 1;
+    err64=ambix_readf_float32(ambix, resultambi+got*ambichannels, resultother+got*extrachannels, frames);
+    if(fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames))return 1;
+    got+=frames;
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+    ambixtest_rmfile(path);
+  }
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "otherdata diff %f > %f", diff, 1e-7))return 1;
+
+  /* no empty segment is left behind */
+  snprintf(path, sizeof(path), pattern, numsegments);
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL!=ambix), __LINE__, "found unused segment '%s'", path))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*pattern=ambixtest_getfname(alloca(1024), 1024, 0, argv[0], "-%03d.caf");
+  char path[1024];
+  ambix_info_t info;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=4;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  /* the pattern needs exactly one index */
+  fail_if((NULL!=ambix_segmented_open("segment.caf", AMBIX_WRITE, &info, NULL, 1000, 0)), __LINE__, "accepted a pattern without index");
+  fail_if((NULL!=ambix_segmented_open("segment-%d-%d.caf", AMBIX_WRITE, &info, NULL, 1000, 0)), __LINE__, "accepted a pattern with two indices");
+  fail_if((NULL!=ambix_segmented_open("segment-%s.caf", AMBIX_WRITE, &info, NULL, 1000, 0)), __LINE__, "accepted a pattern with a string");
+  fail_if((NULL!=ambix_segmented_open(pattern, AMBIX_READ, &info, NULL, 1000, 0)), __LINE__, "opened a segmented file for reading");
+  fail_if((NULL!=ambix_segmented_open(pattern, AMBIX_WRITE, &info, NULL, 0, 10)), __LINE__, "accepted segments smaller than a frame");
+  snprintf(path, sizeof(path), pattern, 0);
+  fail_if((NULL!=ambix_open(path, AMBIX_READ, &info)), __LINE__, "rejected segmented file left '%s' behind", path);
+
+  fail_if(check_segments(pattern, 3000, 0, 999), __LINE__, "segments of 3000 frames failed");
+  fail_if(check_segments(pattern, 2000, 0, 1000), __LINE__, "segments of 2000 frames (written in aligned blocks) failed");
+  fail_if(check_segments(pattern, 0, 2500*6*4+7, 4096), __LINE__, "segments of 60000 bytes failed");
+  fail_if(check_segments(pattern, 0, 0, 777), __LINE__, "unlimited segment failed");
+  return pass();
+}
@@ -0,0 +1,169 @@
+#include "common.h"
+
+#include <string.h>
+#include <math.h>
+
+static int check_dither(const char*path, ambix_sampleformat_t format, ambix_dither_t dither, float32_t eps) {
+  const float64_t lsb=(AMBIX_SAMPLEFORMAT_PCM16==format)?(1./32768.):(1./8388608.);
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=4096;
+  uint32_t ambichannels=4, extrachannels=1;
+  float32_t*ambidata, *otherdata, *resultambidata, *resultotherdata;
+  uint32_t f, clipped=0;
+  int64_t err64;
+  float32_t diff;
+
+  STARTTEST("format=%d dither=%d\n", format, dither);
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  resultambidata=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultotherdata=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+
+  /* force some samples out of range */
+  for(f=0; f<framesize; f+=64) {
+    ambidata[f*ambichannels]=(f&64)?1.5:-1.5;
+    clipped++;
+  }
+
+  mtx=ambix_matrix_init(ambichannels, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+  ambix=ambixtest_create(path, 0, format, mtx, ambichannels, extrachannels);
+  ambix_matrix_destroy(mtx);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_dither(ambix, dither)), __LINE__, "couldn't set dither %d", dither))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((clipped!=ambix_get_clipcount(ambix)), __LINE__, "clipped %d samples, expected %d", (int)ambix_get_clipcount(ambix), (int)clipped))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* the out-of-range samples will read back clipped */
+  for(f=0; f<framesize; f+=64)
+    ambidata[f*ambichannels]=(f&64)?(1.-lsb):-1.;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((format!=info.sampleformat), __LINE__, "sampleformat mismatch %d!=%d", (int)format, (int)info.sampleformat))return 1;
+  err64=ambix_readf_float32(ambix, resultambidata, resultotherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambidata, ambichannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultotherdata, extrachannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+
+  free(ambidata);
+  free(otherdata);
+  free(resultambidata);
+  free(resultotherdata);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+/* write a mono PCM16 file and get the quantization error (in LSB) of each sample */
+static int get_error(const char*path, ambix_dither_t dither, const float32_t*data, float64_t*error, uint32_t frames) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  float32_t*result=(float32_t*)calloc(frames, sizeof(float32_t));
+  int64_t err64;
+  uint32_t f;
+
+  ambix=ambixtest_create(path, 0, AMBIX_SAMPLEFORMAT_PCM16, NULL, 1, 0);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_dither(ambix, dither)), __LINE__, "couldn't set dither %d", dither))return 1;
+  err64=ambix_writef_float32(ambix, data, NULL, frames);
+  if(fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  err64=ambix_readf_float32(ambix, result, NULL, frames);
+  if(fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  for(f=0; f<frames; f++)
+    error[f]=((float64_t)result[f]-data[f])*32768.;
+  free(result);
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+/* the energy of the error below (lo) and above (hi) half the nyquist frequency,
+ * as seen through a 1st order lowpass (x[n]+x[n-1]) resp. highpass (x[n]-x[n-1]) */
+static void get_tilt(const float64_t*error, uint32_t frames, float64_t*lo, float64_t*hi) {
+  uint32_t f;
+  *lo=*hi=0.;
+  for(f=1; f<frames; f++) {
+    *lo+=(error[f]+error[f-1])*(error[f]+error[f-1]);
+    *hi+=(error[f]-error[f-1])*(error[f]-error[f-1]);
+  }
+}
+
+/* dithering must actually add noise, and noise shaping must move it towards nyquist */
+static int check_noise(const char*path) {
+  const uint32_t frames=16384;
+  float32_t*data=(float32_t*)calloc(frames, sizeof(float32_t));
+  float64_t*plain=(float64_t*)calloc(frames, sizeof(float64_t));
+  float64_t*error=(float64_t*)calloc(frames, sizeof(float64_t));
+  float64_t mean, lo, hi;
+  uint32_t f, differ=0;
+
+  STARTTEST("\n");
+  /* a constant 0.3LSB: rounds to 0 without dither */
+  for(f=0; f<frames; f++)
+    data[f]=0.3/32768.;
+  if(get_error(path, AMBIX_DITHER_NONE, data, plain, frames))return 1;
+  if(get_error(path, AMBIX_DITHER_TPDF, data, error, frames))return 1;
+  for(f=0, mean=0.; f<frames; f++) {
+    differ+=(error[f]!=plain[f]);
+    mean+=error[f];
+  }
+  mean/=frames;
+  if(fail_if((!differ), __LINE__, "TPDF dither didn't change a single sample"))return 1;
+  /* ...but TPDF dither keeps it on average */
+  if(fail_if((fabs(mean)>0.05), __LINE__, "TPDF dither has a mean error of %fLSB", mean))return 1;
+
+  /* a quiet, slow sine */
+  for(f=0; f<frames; f++)
+    data[f]=(float32_t)(100.3*sin(2.*M_PI*f/1000.)/32768.);
+  if(get_error(path, AMBIX_DITHER_TPDF, data, error, frames))return 1;
+  get_tilt(error, frames, &lo, &hi);
+  if(fail_if((lo<0.7*hi || lo>1.4*hi), __LINE__, "TPDF error isn't white (%f/%f)", lo, hi))return 1;
+  if(get_error(path, AMBIX_DITHER_SHAPED, data, error, frames))return 1;
+  get_tilt(error, frames, &lo, &hi);
+  if(fail_if((lo>0.5*hi), __LINE__, "shaped error isn't tilted towards nyquist (%f/%f)", lo, hi))return 1;
+
+  free(data);
+  free(plain);
+  free(error);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  ambix_t*ambix=NULL;
+  const char*path=FILENAME_MAIN;
+
+  fail_if((AMBIX_ERR_INVALID_HANDLE!=ambix_set_dither(NULL, AMBIX_DITHER_TPDF)), __LINE__, "could set dither without a handle");
+
+  /* dithering is only possible for integer formats */
+  ambix=ambixtest_create(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, NULL, 4, 0);
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_dither(ambix, AMBIX_DITHER_TPDF)), __LINE__, "could set dither on float file");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  ambixtest_rmfile(path);
+
+  /* rounding error is 0.5LSB, TPDF adds up to 1LSB, noise shaping up to another 2LSB */
+  fail_if(check_dither(path, AMBIX_SAMPLEFORMAT_PCM16, AMBIX_DITHER_NONE  , 0.6/32768.), __LINE__, "PCM16 without dither failed");
+  fail_if(check_dither(path, AMBIX_SAMPLEFORMAT_PCM16, AMBIX_DITHER_TPDF  , 1.6/32768.), __LINE__, "PCM16 with TPDF dither failed");
+  fail_if(check_dither(path, AMBIX_SAMPLEFORMAT_PCM16, AMBIX_DITHER_SHAPED, 3.6/32768.), __LINE__, "PCM16 with shaped dither failed");
+  fail_if(check_dither(path, AMBIX_SAMPLEFORMAT_PCM24, AMBIX_DITHER_NONE  , 0.6/8388608.), __LINE__, "PCM24 without dither failed");
+  fail_if(check_dither(path, AMBIX_SAMPLEFORMAT_PCM24, AMBIX_DITHER_TPDF  , 1.6/8388608.), __LINE__, "PCM24 with TPDF dither failed");
+  fail_if(check_dither(path, AMBIX_SAMPLEFORMAT_PCM24, AMBIX_DITHER_SHAPED, 3.6/8388608.), __LINE__, "PCM24 with shaped dither failed");
+  fail_if(check_noise(path), __LINE__, "dither noise failed");
+
+  return pass();
+}
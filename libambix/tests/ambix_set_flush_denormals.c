@@ -0,0 +1,55 @@
+#include "common.h"
+
+#include <float.h>
+
+/* FTZ/DAZ is known to be supported on these architectures */
+#if defined(__SSE2__) || defined(_M_X64) || defined(__aarch64__)
+# define HAVE_FLUSH_DENORMALS 1
+#endif
+
+static int is_denormal(float32_t f) {
+  return (f != 0.f) && (f < FLT_MIN) && (f > -FLT_MIN);
+}
+
+int main(int argc, char**argv) {
+  const uint32_t channels=4;
+  const int64_t frames=64;
+  float32_t*source=(float32_t*)calloc(channels*frames, sizeof(float32_t));
+  float32_t*dest=(float32_t*)calloc(channels*frames, sizeof(float32_t));
+  ambix_matrix_t*eye=NULL;
+  volatile float32_t tiny=FLT_MIN, scale=0.25f;
+  int64_t i;
+
+  eye=ambix_matrix_init(channels, channels, eye);
+  ambix_matrix_fill(eye, AMBIX_MATRIX_IDENTITY);
+  for(i=0; i<channels*frames; i++)
+    source[i]=FLT_MIN/(float32_t)(2+(i%7));
+  fail_if(!is_denormal(source[0]), __LINE__, "couldn't create denormal test data");
+
+  /* without protection, denormals pass through */
+  ambix_set_flush_denormals(0);
+  fail_if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_interleaved(dest, eye, source, frames), __LINE__, "multiplication failed");
+  for(i=0; i<channels*frames; i++)
+    fail_if(dest[i]!=source[i], __LINE__, "unprotected denormal @ %d changed: %g!=%g", (int)i, dest[i], source[i]);
+
+  /* with protection, denormals are flushed to zero */
+  ambix_set_flush_denormals(1);
+  fail_if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_interleaved(dest, eye, source, frames), __LINE__, "multiplication failed");
+#ifdef HAVE_FLUSH_DENORMALS
+  for(i=0; i<channels*frames; i++)
+    fail_if(dest[i]!=0.f, __LINE__, "protected denormal @ %d not flushed: %g", (int)i, dest[i]);
+#endif
+  fail_if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_planar(dest, eye, source, frames), __LINE__, "multiplication failed");
+#ifdef HAVE_FLUSH_DENORMALS
+  for(i=0; i<channels*frames; i++)
+    fail_if(dest[i]!=0.f, __LINE__, "protected (planar) denormal @ %d not flushed: %g", (int)i, dest[i]);
+#endif
+
+  /* the caller's floating point state must have been restored */
+  fail_if(!is_denormal(tiny*scale), __LINE__, "denormal handling of the caller has been changed");
+
+  ambix_matrix_destroy(eye);
+  free(source);
+  free(dest);
+  return pass();
+}
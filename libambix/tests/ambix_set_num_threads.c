@@ -0,0 +1,128 @@
+#include "common.h"
+
+#include <string.h>
+#include <math.h>
+
+static int check_readwrite(const char*path, ambix_sampleformat_t format, uint32_t framesize) {
+  /* 3rd order with a 2nd order adaptor matrix, so the matrix is non-trivial */
+  const uint32_t ambichannels=9, fullambichannels=16, extrachannels=2;
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  float32_t*ambidata, *otherdata, *resultambi[2], *resultother[2];
+  uint32_t f, c, t;
+  int64_t err64;
+
+  STARTTEST("format=%d\n", format);
+  ambidata=(float32_t*)calloc(fullambichannels*framesize, sizeof(float32_t));
+  otherdata=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  for(t=0; t<2; t++) {
+    resultambi[t]=(float32_t*)calloc(fullambichannels*framesize, sizeof(float32_t));
+    resultother[t]=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  }
+  for(f=0; f<framesize; f++) {
+    for(c=0; c<fullambichannels; c++)
+      ambidata[f*fullambichannels+c]=0.05*sin(f*0.01*(c+1));
+    for(c=0; c<extrachannels; c++)
+      otherdata[f*extrachannels+c]=0.5*cos(f*0.02*(c+1));
+  }
+  mtx=ambix_matrix_init(fullambichannels, ambichannels, mtx);
+  for(f=0; f<mtx->rows; f++)
+    for(c=0; c<mtx->cols; c++)
+      mtx->data[f][c]=(f==c)?1.:0.1/(1.+f+c);
+
+  /* write with multiple threads */
+  ambix_set_num_threads(4);
+  if(ambixtest_writefile(path, 0, format, mtx, ambidata, ambichannels, otherdata, extrachannels, framesize))return 1;
+
+  /* reading with a single thread and with multiple threads must yield the same data */
+  for(t=0; t<2; t++) {
+    ambix_set_num_threads(t?4:1);
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    ambix=ambix_open(path, AMBIX_READ, &info);
+    if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+    if(fail_if((info.ambichannels!=fullambichannels), __LINE__, "got %d ambichannels, expected %d", info.ambichannels, fullambichannels))return 1;
+    err64=ambix_readf_float32(ambix, resultambi[t], resultother[t], framesize);
+    if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  }
+  if(fail_if(memcmp(resultambi[0], resultambi[1], fullambichannels*framesize*sizeof(float32_t)), __LINE__, "multi-threaded ambisonics data differs"))return 1;
+  if(fail_if(memcmp(resultother[0], resultother[1], extrachannels*framesize*sizeof(float32_t)), __LINE__, "multi-threaded non-ambisonics data differs"))return 1;
+
+  ambix_set_num_threads(1);
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  for(t=0; t<2; t++) {
+    free(resultambi[t]);
+    free(resultother[t]);
+  }
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  const uint32_t rows=16, cols=25;
+  const int64_t frames=10007;
+  ambix_matrix_t*mtx=NULL, *left=NULL, *right=NULL, *result1=NULL, *result4=NULL;
+  float32_t*source=(float32_t*)calloc(cols*frames, sizeof(float32_t));
+  float32_t*dest1=(float32_t*)calloc(rows*frames, sizeof(float32_t));
+  float32_t*dest4=(float32_t*)calloc(rows*frames, sizeof(float32_t));
+  uint32_t r, c;
+  int64_t f;
+  float32_t errf;
+
+  fail_if((ambix_get_num_threads()!=1), __LINE__, "multi-threading is enabled by default");
+  ambix_set_num_threads(0);
+  fail_if((ambix_get_num_threads()<1), __LINE__, "invalid number of threads %d", ambix_get_num_threads());
+
+  /* matrix*data */
+  mtx=ambix_matrix_init(rows, cols, mtx);
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=(float32_t)(r+1)/(float32_t)(c+2);
+  for(f=0; f<cols*frames; f++)
+    source[f]=(float32_t)sin(f*0.001);
+  ambix_set_num_threads(1);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32(dest1, mtx, source, frames)), __LINE__, "single-threaded multiplication failed");
+  ambix_set_num_threads(4);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_mt(dest4, mtx, source, frames)), __LINE__, "multi-threaded multiplication failed");
+  fail_if(memcmp(dest1, dest4, rows*frames*sizeof(float32_t)), __LINE__, "multi-threaded multiplication differs");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_matrix_multiply_float32_mt(NULL, mtx, source, frames)), __LINE__, "multi-threaded multiplication without destination succeeded");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_matrix_multiply_float32_mt(dest4, NULL, source, frames)), __LINE__, "multi-threaded multiplication without matrix succeeded");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_matrix_multiply_float32_mt(dest4, mtx, source, -1)), __LINE__, "multi-threaded multiplication of negative frames succeeded");
+
+  /* matrix*matrix */
+  left=ambix_matrix_init(256, 64, left);
+  right=ambix_matrix_init(64, 81, right);
+  for(r=0; r<left->rows; r++)
+    for(c=0; c<left->cols; c++)
+      left->data[r][c]=(float32_t)cos(r*0.3+c*0.7);
+  for(r=0; r<right->rows; r++)
+    for(c=0; c<right->cols; c++)
+      right->data[r][c]=(float32_t)sin(r*0.2+c*0.9);
+  ambix_set_num_threads(1);
+  result1=ambix_matrix_multiply(left, right, result1);
+  ambix_set_num_threads(4);
+  result4=ambix_matrix_multiply(left, right, result4);
+  fail_if((NULL==result1 || NULL==result4), __LINE__, "matrix multiplication failed");
+  errf=matrix_diff(__LINE__, result1, result4, 0);
+  fail_if((errf>0), __LINE__, "multi-threaded matrix multiplication differs by %g", errf);
+  ambix_set_num_threads(1);
+
+  /* reading/writing */
+  fail_if(check_readwrite(path, AMBIX_SAMPLEFORMAT_FLOAT32, 44100), __LINE__, "multi-threaded FLOAT32 I/O failed");
+  fail_if(check_readwrite(path, AMBIX_SAMPLEFORMAT_PCM24, 44100), __LINE__, "multi-threaded PCM24 I/O failed");
+
+  ambix_matrix_destroy(mtx);
+  ambix_matrix_destroy(left);
+  ambix_matrix_destroy(right);
+  ambix_matrix_destroy(result1);
+  ambix_matrix_destroy(result4);
+  free(source);
+  free(dest1);
+  free(dest4);
+  return pass();
+}
@@ -0,0 +1,111 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+static int write_blocks(const char*path, ambix_filemode_t mode, ambix_sampleformat_t format, const ambix_matrix_t*mtx, const float32_t*ambidata, const float32_t*otherdata,
+                        uint32_t ambichannels, uint32_t extrachannels, uint32_t framesize, uint32_t blocksize) {
+  ambix_t*ambix=NULL;
+  ambix_marker_t marker;
+  int64_t err64;
+  uint32_t f;
+  memset(&marker, 0, sizeof(marker));
+  marker.position=framesize/2;
+  snprintf(marker.name, sizeof(marker.name), "middle");
+
+  ambix=ambixtest_create(path, mode, format, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_add_marker(ambix, &marker)), __LINE__, "failed adding marker"))return 1;
+  if(AMBIX_SAMPLEFORMAT_PCM16==format || AMBIX_SAMPLEFORMAT_PCM24==format)
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_dither(ambix, AMBIX_DITHER_NONE)), __LINE__, "couldn't set dither"))return 1;
+  /* unaligned blocks, so the unbuffered writer has to keep a remainder */
+  for(f=0; f<framesize; f+=blocksize) {
+    const uint32_t frames=(framesize-f<blocksize)?(framesize-f):blocksize;
+    err64=ambix_writef_float32(ambix, ambidata+f*ambichannels, otherdata+f*extrachannels, frames);
+    if(fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  return 0;
+}
+
+static unsigned char*read_bytes(const char*path, long*size) {
+  unsigned char*data=NULL;
+  FILE*f=fopen(path, "rb");
+  if(!f)
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  *size=ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data=(unsigned char*)malloc(*size+1);
+  if(data && *size!=(long)fread(data, 1, *size, f)) {
+    free(data);
+    data=NULL;
+  }
+  fclose(f);
+  return data;
+}
+
+static int check_direct(const char*path, const char*refpath, ambix_sampleformat_t format, uint32_t framesize, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata, *resultambi, *resultother;
+  unsigned char*data, *refdata;
+  long size=0, refsize=0;
+  int64_t err64;
+  float32_t diff;
+
+  STARTTEST("format=%d frames=%d\n", format, framesize);
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  /* an unbuffered file is the same as a buffered one */
+  if(write_blocks(path, AMBIX_DIRECT, format, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize, 999))return 1;
+  if(write_blocks(refpath, 0, format, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize, 999))return 1;
+  data=read_bytes(path, &size);
+  refdata=read_bytes(refpath, &refsize);
+  if(fail_if((NULL==data || NULL==refdata), __LINE__, "couldn't read back files"))return 1;
+  if(fail_if((size!=refsize), __LINE__, "unbuffered file has %ld bytes, expected %ld", size, refsize))return 1;
+  if(fail_if((memcmp(data, refdata, size)), __LINE__, "unbuffered file differs"))return 1;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((framesize!=info.frames), __LINE__, "got %d frames, expected %d", (int)info.frames, (int)framesize))return 1;
+  if(fail_if((1!=ambix_get_num_markers(ambix)), __LINE__, "got %d markers, expected 1", ambix_get_num_markers(ambix)))return 1;
+  diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), mtx, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "adaptor matrix diff %f > %f", diff, 1e-7))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  free(data);
+  free(refdata);
+  ambixtest_rmfile(path);
+  ambixtest_rmfile(refpath);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  const char*refpath=FILENAME_MAIN;
+  fail_if(check_direct(path, refpath, AMBIX_SAMPLEFORMAT_FLOAT32, 100000, 1e-7), __LINE__, "FLOAT32 unbuffered file failed");
+  fail_if(check_direct(path, refpath, AMBIX_SAMPLEFORMAT_PCM16, 1000, 1./32768.), __LINE__, "PCM16 unbuffered file failed");
+  fail_if(check_direct(path, refpath, AMBIX_SAMPLEFORMAT_PCM24, 50000, 1./8388608.), __LINE__, "PCM24 unbuffered file failed");
+  return pass();
+}
@@ -0,0 +1,105 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+static int64_t allocated(const char*path, int64_t*size) {
+  struct stat st;
+  if(stat(path, &st))
+    return -1;
+  if(size)
+    *size=st.st_size;
+  return (int64_t)st.st_blocks*512;
+}
+
+static int write_reserved(const char*path, ambix_filemode_t mode, int64_t reserve, const ambix_matrix_t*mtx,
+                          const float32_t*ambidata, const float32_t*otherdata, uint32_t ambichannels, uint32_t extrachannels, uint32_t framesize) {
+  ambix_t*ambix=NULL;
+  ambix_err_t err;
+  int64_t err64;
+
+  ambix=ambixtest_create(path, mode, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  err=ambix_reserve(ambix, reserve);
+  if(skip_if((AMBIX_ERR_UNKNOWN==err), __LINE__, "cannot preallocate on this system"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=err), __LINE__, "reserving %d frames failed with %d", (int)reserve, err))return 1;
+  /* the space is reserved, but the file doesn't grow */
+  if(fail_if((allocated(path, NULL)<reserve*(ambichannels+extrachannels)*4), __LINE__, "only %d bytes allocated after reserving %d frames",
+             (int)allocated(path, NULL), (int)reserve))return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)framesize))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  return 0;
+}
+
+static int check_reserve(const char*path, const char*refpath, ambix_filemode_t mode) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  uint32_t framesize=10000, reserve=1000000;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata, *resultambi, *resultother;
+  int64_t size=0, refsize=0, err64;
+  float32_t diff;
+
+  STARTTEST("mode=%d\n", mode);
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  if(ambixtest_writefile(refpath, mode, AMBIX_SAMPLEFORMAT_FLOAT32, mtx, ambidata, ambichannels, otherdata, extrachannels, framesize))return 1;
+  if(write_reserved(path, mode, reserve, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize))return 1;
+
+  /* the unused space is released when closing */
+  allocated(refpath, &refsize);
+  if(fail_if((allocated(path, &size)>refsize+(1<<20)), __LINE__, "%d bytes still allocated for a %d bytes file", (int)allocated(path, NULL), (int)size))return 1;
+  if(fail_if((size!=refsize), __LINE__, "file has %d bytes, expected %d", (int)size, (int)refsize))return 1;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path))return 1;
+  if(fail_if((framesize!=info.frames), __LINE__, "got %d frames, expected %d", (int)info.frames, (int)framesize))return 1;
+  /* only files opened for writing can be reserved */
+  if(fail_if((AMBIX_ERR_SUCCESS==ambix_reserve(ambix, reserve)), __LINE__, "reserved space in a file opened for reading"))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "ambidata diff %f > %f", diff, 1e-7))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "otherdata diff %f > %f", diff, 1e-7))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  ambixtest_rmfile(path);
+  ambixtest_rmfile(refpath);
+  return 0;
+}
+
+static int check_stream(const char*path) {
+  ambix_t*ambix=NULL;
+  STARTTEST("\n");
+  ambix=ambixtest_create(path, AMBIX_STREAM, AMBIX_SAMPLEFORMAT_FLOAT32, NULL, 4, 0);
+  if(!ambix)return 1;
+  if(fail_if((AMBIX_ERR_INVALID_FILE!=ambix_reserve(ambix, 1000)), __LINE__, "reserved space in a stream"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix stream %p", ambix))return 1;
+  ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  const char*refpath=FILENAME_MAIN;
+  fail_if(check_stream(path), __LINE__, "reserving space in a stream failed");
+  fail_if(check_reserve(path, refpath, 0), __LINE__, "reserving space failed");
+  fail_if(check_reserve(path, refpath, AMBIX_DIRECT), __LINE__, "reserving space in an unbuffered file failed");
+  return pass();
+}
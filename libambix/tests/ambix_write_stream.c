@@ -0,0 +1,149 @@
+#include "common.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/* an append-only virtual file (like a pipe): seeking always fails */
+typedef struct pipebuf_t {
+  unsigned char*data;
+  int64_t size;
+} pipebuf_t;
+
+static int64_t pipe_get_filelen(void*user) {
+  return -1;
+}
+static int64_t pipe_seek(int64_t offset, int whence, void*user) {
+  return -1;
+}
+static int64_t pipe_write(const void*ptr, int64_t count, void*user) {
+  pipebuf_t*buf=(pipebuf_t*)user;
+  unsigned char*data=(unsigned char*)realloc(buf->data, buf->size+count);
+  if(!data)
+    return 0;
+  memcpy(data+buf->size, ptr, count);
+  buf->data=data;
+  buf->size+=count;
+  return count;
+}
+static int64_t pipe_tell(void*user) {
+  return ((pipebuf_t*)user)->size;
+}
+
+static ambix_t*open_stream(const char*path, pipebuf_t*buf, ambix_sampleformat_t format, uint32_t ambichannels, uint32_t extrachannels) {
+  ambix_virtual_io_t vio={pipe_get_filelen, pipe_seek, NULL, pipe_write, pipe_tell};
+  ambix_info_t info;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  if(buf)
+    return ambix_open_virtual(&vio, AMBIX_WRITE | AMBIX_STREAM, &info, buf);
+  return ambix_open(path, AMBIX_WRITE | AMBIX_STREAM, &info);
+}
+
+static int check_read(ambix_t*ambix, ambix_info_t*info, const ambix_matrix_t*mtx, const float32_t*ambidata, const float32_t*otherdata,
+                      uint32_t ambichannels, uint32_t extrachannels, uint32_t framesize, float32_t eps) {
+  float32_t*resultambi=(float32_t*)calloc(ambichannels*framesize, sizeof(float32_t));
+  float32_t*resultother=(float32_t*)calloc(extrachannels*framesize, sizeof(float32_t));
+  int64_t err64;
+  float32_t diff;
+  if(fail_if((AMBIX_EXTENDED!=info->fileformat), __LINE__, "got fileformat %d, expected %d", info->fileformat, AMBIX_EXTENDED))return 1;
+  if(fail_if((ambichannels!=info->ambichannels), __LINE__, "got %d ambichannels, expected %d", info->ambichannels, ambichannels))return 1;
+  if(fail_if((extrachannels!=info->extrachannels), __LINE__, "got %d extrachannels, expected %d", info->extrachannels, extrachannels))return 1;
+  if(fail_if((framesize!=info->frames), __LINE__, "got %d frames, expected %d", (int)info->frames, (int)framesize))return 1;
+  if(fail_if((NULL==ambix_get_adaptormatrix(ambix)), __LINE__, "no adaptor matrix"))return 1;
+  diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), mtx, 1e-7);
+  if(fail_if((diff>1e-7), __LINE__, "adaptor matrix diff %f > %f", diff, 1e-7))return 1;
+  err64=ambix_readf_float32(ambix, resultambi, resultother, framesize);
+  if(fail_if((err64!=framesize), __LINE__, "read only %d frames of %d", (int)err64, (int)framesize))return 1;
+  diff=data_diff(__LINE__, FLOAT32, ambidata, resultambi, ambichannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "ambidata diff %f > %f", diff, eps))return 1;
+  diff=data_diff(__LINE__, FLOAT32, otherdata, resultother, extrachannels*framesize, eps);
+  if(fail_if((diff>eps), __LINE__, "otherdata diff %f > %f", diff, eps))return 1;
+  free(resultambi);
+  free(resultother);
+  return 0;
+}
+
+static int check_stream(const char*path, int virtual, ambix_sampleformat_t format, float32_t eps) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  ambix_matrix_t*mtx=NULL;
+  pipebuf_t buf;
+  uint32_t framesize=4000, blocksize=1000, f;
+  uint32_t ambichannels=4, extrachannels=2;
+  float32_t*ambidata, *otherdata;
+  int64_t err64;
+
+  STARTTEST("virtual=%d format=%d\n", virtual, format);
+  memset(&buf, 0, sizeof(buf));
+  ambidata=data_sine(FLOAT32, framesize, ambichannels, 500);
+  otherdata=data_ramp(FLOAT32, framesize, extrachannels);
+  mtx=ambix_matrix_init(9, ambichannels, mtx);
+  ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY);
+
+  ambix=open_stream(path, virtual?&buf:NULL, format, ambichannels, extrachannels);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't create ambix stream"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)), __LINE__, "failed setting adaptor matrix"))return 1;
+  if(AMBIX_SAMPLEFORMAT_FLOAT32!=format)
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_dither(ambix, AMBIX_DITHER_NONE)), __LINE__, "couldn't set dither"))return 1;
+  /* nothing is written before the first frame */
+  if(fail_if((0!=buf.size), __LINE__, "wrote %d bytes before the first frame", (int)buf.size))return 1;
+  /* append the audio block by block */
+  for(f=0; f<framesize; f+=blocksize) {
+    err64=ambix_writef_float32(ambix, ambidata+f*ambichannels, otherdata+f*extrachannels, blocksize);
+    if(fail_if((err64!=blocksize), __LINE__, "wrote only %d frames of %d", (int)err64, (int)blocksize))return 1;
+    if(virtual && fail_if((buf.size<f*(ambichannels+extrachannels)), __LINE__, "stream has only %d bytes after %d frames", (int)buf.size, f))return 1;
+  }
+  if(fail_if((AMBIX_ERR_SUCCESS==ambix_set_adaptormatrix(ambix, mtx)), __LINE__, "could set adaptor matrix after writing"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix stream %p", ambix))return 1;
+
+  /* the stream is an ordinary ambix file */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  if(virtual) {
+    if(fail_if((buf.size<4 || memcmp(buf.data, "caff", 4)), __LINE__, "stream doesn't start with a CAF header"))return 1;
+    ambix=ambix_open_memory(buf.data, buf.size, &info);
+  } else
+    ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open ambix stream for reading"))return 1;
+  if(check_read(ambix, &info, mtx, ambidata, otherdata, ambichannels, extrachannels, framesize, eps))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  /* a stream without any frames still has a header */
+  free(buf.data);
+  memset(&buf, 0, sizeof(buf));
+  ambix=open_stream(path, virtual?&buf:NULL, format, ambichannels, extrachannels);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't create ambix stream"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)), __LINE__, "failed setting adaptor matrix"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix stream %p", ambix))return 1;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  if(virtual)
+    ambix=ambix_open_memory(buf.data, buf.size, &info);
+  else
+    ambix=ambix_open(path, AMBIX_READ, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't open empty ambix stream for reading"))return 1;
+  if(fail_if((0!=info.frames), __LINE__, "empty stream has %d frames", (int)info.frames))return 1;
+  if(fail_if((NULL==ambix_get_adaptormatrix(ambix)), __LINE__, "empty stream has no adaptor matrix"))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+
+  ambix_matrix_destroy(mtx);
+  free(ambidata);
+  free(otherdata);
+  free(buf.data);
+  if(!virtual)
+    ambixtest_rmfile(path);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  fail_if(check_stream(path, 0, AMBIX_SAMPLEFORMAT_FLOAT32, 1e-7), __LINE__, "FLOAT32 stream failed");
+  fail_if(check_stream(path, 0, AMBIX_SAMPLEFORMAT_PCM16, 1./32768.), __LINE__, "PCM16 stream failed");
+  fail_if(check_stream(path, 1, AMBIX_SAMPLEFORMAT_FLOAT32, 1e-7), __LINE__, "FLOAT32 virtual stream failed");
+  fail_if(check_stream(path, 1, AMBIX_SAMPLEFORMAT_PCM24, 1./8388608.), __LINE__, "PCM24 virtual stream failed");
+  return pass();
+}
@@ -288,6 +288,37 @@ int64_t ambixtest_writef (ambix_t *ambix, ambixtest_presentationformat_t fmt,
 }
 
 
+ambix_t*ambixtest_create(const char*path, ambix_filemode_t mode, ambix_sampleformat_t format, const ambix_matrix_t*mtx,
+                         uint32_t ambichannels, uint32_t extrachannels) {
+  ambix_t*ambix=NULL;
+  ambix_info_t info;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=(mtx)?AMBIX_EXTENDED:AMBIX_BASIC;
+  info.ambichannels=ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+
+  ambix=ambix_open(path, AMBIX_WRITE | mode, &info);
+  if(fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path))return NULL;
+  if(mtx)
+    if(fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)), __LINE__, "failed setting adaptor matrix"))return NULL;
+  return ambix;
+}
+
+int ambixtest_writefile(const char*path, ambix_filemode_t mode, ambix_sampleformat_t format, const ambix_matrix_t*mtx,
+                        const float32_t*ambidata, uint32_t ambichannels,
+                        const float32_t*otherdata, uint32_t extrachannels,
+                        int64_t frames) {
+  int64_t err64;
+  ambix_t*ambix=ambixtest_create(path, mode, format, mtx, ambichannels, extrachannels);
+  if(!ambix)return 1;
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, frames);
+  if(fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames))return 1;
+  if(fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix))return 1;
+  return 0;
+}
+
 int ambixtest_rmfile(const char*path) {
   /* only remove if AMBIXTEST_KEEPFILES is not set */
   if(NULL==getenv("AMBIXTEST_KEEPFILES"))return unlink(path);
@@ -120,6 +120,16 @@ int64_t ambixtest_writef (ambix_t *ambix, ambixtest_presentationformat_t fmt,
                           const void*ambidata , const uint64_t ambioffset,
                           const void*otherdata, const uint64_t otheroffset,
                           int64_t frames);
+/* create an ambix file for writing (the AMBIX_WRITE flag is implied in 'mode'):
+ * EXTENDED with the given adaptor matrix, or BASIC if 'mtx' is NULL */
+ambix_t*ambixtest_create(const char*path, ambix_filemode_t mode, ambix_sampleformat_t format, const ambix_matrix_t*mtx,
+                         uint32_t ambichannels, uint32_t extrachannels);
+/* create an ambix file (see ambixtest_create()), write 'frames' frames and close it
+ * returns 0 on success */
+int ambixtest_writefile(const char*path, ambix_filemode_t mode, ambix_sampleformat_t format, const ambix_matrix_t*mtx,
+                        const float32_t*ambidata, uint32_t ambichannels,
+                        const float32_t*otherdata, uint32_t extrachannels,
+                        int64_t frames);
 int ambixtest_rmfile(const char*path);
 int ambixtest_uniquenumber(void);
 /* write uniquish filename into 'inbuf' and return a pointer to it
@@ -24,6 +24,7 @@
 #include "common.h"
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 static float32_t leftdata_4_3[]= {
    0.19, 0.06, 0.14,
@@ -184,6 +185,79 @@ void mtxinverse_tests(float32_t eps) {
   free(transposedata);
   STOPTEST("\n");
 }
+void mtxinverse_large_tests(uint32_t rows, uint32_t cols, float32_t eps) {
+  ambix_matrix_t *mtx=0, *pinv=0, *pinv2=0, *mul=0, *eye=0;
+  const uint32_t min_rowcol=(cols<rows)?cols:rows;
+  float32_t errf;
+  uint32_t r, c;
+
+  STARTTEST("[%dx%d]\n", rows, cols);
+  /* some well-conditioned but non-trivial matrix */
+  mtx=ambix_matrix_init(rows, cols, mtx);
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=(float32_t)sin(1.+r*0.7+c*1.3+r*c*0.11) + ((r==c)?2.:0.);
+  eye=ambix_matrix_init(min_rowcol, min_rowcol, eye);
+  eye=ambix_matrix_fill(eye, AMBIX_MATRIX_IDENTITY);
+
+  pinv=ambix_matrix_pinv(mtx, pinv);
+  fail_if((NULL==pinv), __LINE__, "could not invert matrix");
+  fail_if((pinv->rows!=cols || pinv->cols!=rows), __LINE__, "pinv has wrong dimensions [%dx%d]", pinv->rows, pinv->cols);
+  if(cols < rows)
+    mul=ambix_matrix_multiply(pinv, mtx, 0);
+  else
+    mul=ambix_matrix_multiply(mtx, pinv, 0);
+  errf=matrix_diff(__LINE__, mul, eye, eps);
+  fail_if((errf>eps), __LINE__, "diffing mtx*pinv(mtx) returned %g (>%g)", errf, eps);
+
+  /* inverting the same matrix again must give the same result */
+  pinv2=ambix_matrix_pinv(mtx, pinv2);
+  fail_if((NULL==pinv2), __LINE__, "could not re-invert matrix");
+  errf=matrix_diff(__LINE__, pinv, pinv2, 0);
+  fail_if((errf>0), __LINE__, "re-inverted matrix differs by %g", errf);
+
+  ambix_matrix_destroy(mtx);
+  ambix_matrix_destroy(pinv);
+  ambix_matrix_destroy(pinv2);
+  ambix_matrix_destroy(mul);
+  ambix_matrix_destroy(eye);
+  STOPTEST("\n");
+}
+void mtxmul_large_tests(uint32_t rows, uint32_t common, uint32_t cols, float32_t eps) {
+  ambix_matrix_t *left=NULL, *right=NULL, *result=NULL, *testresult=NULL;
+  float32_t errf;
+  uint32_t r, c, i;
+
+  STARTTEST("[%dx%d]*[%dx%d]\n", rows, common, common, cols);
+  left=ambix_matrix_init(rows, common, left);
+  right=ambix_matrix_init(common, cols, right);
+  testresult=ambix_matrix_init(rows, cols, testresult);
+  for(r=0; r<rows; r++)
+    for(i=0; i<common; i++)
+      left->data[r][i]=(float32_t)sin(r*0.37+i*1.1);
+  for(i=0; i<common; i++)
+    for(c=0; c<cols; c++)
+      right->data[i][c]=((i+c)%3)?(float32_t)cos(i*0.53+c*0.29):0.;
+  /* naive reference */
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++) {
+      double sum=0.;
+      for(i=0; i<common; i++)
+        sum+=(double)left->data[r][i]*(double)right->data[i][c];
+      testresult->data[r][c]=(float32_t)sum;
+    }
+
+  result=ambix_matrix_multiply(left, right, result);
+  fail_if((NULL==result), __LINE__, "multiplication failed");
+  errf=matrix_diff(__LINE__, result, testresult, eps);
+  fail_if((errf>eps), __LINE__, "diffing matrix multiplication returned %g (>%g)", errf, eps);
+
+  ambix_matrix_destroy(left);
+  ambix_matrix_destroy(right);
+  ambix_matrix_destroy(result);
+  ambix_matrix_destroy(testresult);
+  STOPTEST("\n");
+}
 void mtxmul_tests(float32_t eps) {
   float32_t errf;
   ambix_matrix_t *left=NULL, *right=NULL, *result, *testresult;
@@ -347,6 +421,67 @@ void datamul_eye_tests(float32_t eps) {
   STOPTEST("\n");
 }
 
+#define DATAMUL_LAYOUT_TEST(typ, scale)                                 \
+  static void datamul_layout_##typ(const ambix_matrix_t*mtx, const float64_t*input, \
+                                   const float64_t*expected, uint32_t frames, float64_t eps) { \
+    const uint32_t rows=mtx->rows, cols=mtx->cols;                      \
+    typ##_t*source=(typ##_t*)calloc(cols*frames, sizeof(typ##_t));     \
+    typ##_t*splanar=(typ##_t*)calloc(cols*frames, sizeof(typ##_t));    \
+    typ##_t*dest=(typ##_t*)calloc(rows*frames, sizeof(typ##_t));       \
+    typ##_t*dplanar=(typ##_t*)calloc(rows*frames, sizeof(typ##_t));    \
+    uint32_t f, c;                                                      \
+    STARTTEST("%s\n", #typ);                                            \
+    for(f=0; f<frames; f++)                                             \
+      for(c=0; c<cols; c++)                                             \
+        splanar[c*frames+f]=source[f*cols+c]=(typ##_t)(input[f*cols+c]*scale); \
+    fail_if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_##typ##_interleaved(dest, mtx, source, frames), __LINE__, "interleaved multiplication failed"); \
+    fail_if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_##typ##_planar(dplanar, mtx, splanar, frames), __LINE__, "planar multiplication failed"); \
+    for(f=0; f<frames; f++)                                             \
+      for(c=0; c<rows; c++) {                                           \
+        float64_t want=expected[f*rows+c]*scale;                        \
+        /* integers saturate */                                         \
+        if(scale>1. && want>scale-1.)want=scale-1.;                     \
+        if(scale>1. && want<-scale)want=-scale;                         \
+        fail_if(fabs(dest[f*rows+c]-want)>eps*scale, __LINE__, "interleaved result mismatch @ %d/%d: %g!=%g", f, c, (double)dest[f*rows+c], want); \
+        fail_if(dest[f*rows+c]!=dplanar[c*frames+f], __LINE__, "planar result mismatch @ %d/%d", f, c); \
+      }                                                                 \
+    free(source);                                                       \
+    free(splanar);                                                      \
+    free(dest);                                                         \
+    free(dplanar);                                                      \
+    STOPTEST("\n");                                                     \
+  }
+DATAMUL_LAYOUT_TEST(float32, 1.);
+DATAMUL_LAYOUT_TEST(float64, 1.);
+DATAMUL_LAYOUT_TEST(int32, 2147483648.);
+DATAMUL_LAYOUT_TEST(int16, 32768.);
+
+void datamul_layout_tests(uint32_t rows, uint32_t cols, uint32_t frames) {
+  ambix_matrix_t*mtx=ambix_matrix_init(rows, cols, NULL);
+  float64_t*input=(float64_t*)calloc(cols*frames, sizeof(float64_t));
+  float64_t*expected=(float64_t*)calloc(rows*frames, sizeof(float64_t));
+  uint32_t f, r, c;
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=(float32_t)(((r+c)%4)?(0.25+0.5*sin(r+2.*c)):0.);
+  /* the input is in the range [-0.9..+0.9], so some outputs are out of range */
+  for(f=0; f<frames*cols; f++)
+    input[f]=0.9*sin(f*0.123);
+  for(f=0; f<frames; f++)
+    for(r=0; r<rows; r++) {
+      float64_t sum=0.;
+      for(c=0; c<cols; c++)
+        sum+=(float64_t)mtx->data[r][c]*input[f*cols+c];
+      expected[f*rows+r]=sum;
+    }
+  datamul_layout_float32(mtx, input, expected, frames, 1e-6);
+  datamul_layout_float64(mtx, input, expected, frames, 1e-6);
+  datamul_layout_int32(mtx, input, expected, frames, 1e-6);
+  datamul_layout_int16(mtx, input, expected, frames, (cols+1.)/32768.);
+  ambix_matrix_destroy(mtx);
+  free(input);
+  free(expected);
+}
 void datamul_4_2_tests(uint32_t chunksize, float32_t eps) {
   uint32_t r, c, rows, cols;
   float32_t errf;
@@ -590,11 +725,27 @@ int main(int argc, char**argv) {
   mtx_diff(1e-7);
   mtxmul_tests(1e-7);
   mtxmul_eye_tests(1e-7);
+  mtxmul_large_tests(37, 129, 53, 1e-5);
+  mtxmul_large_tests(256, 64, 64, 1e-5);
+  mtxmul_large_tests(64, 256, 400, 1e-5);
   datamul_tests(1e-7);
   datamul_eye_tests(1e-7);
 #endif
   datamul_4_2_tests(1024, 1e-7);
+  datamul_layout_tests(9, 4, 1000);
+  datamul_layout_tests(4, 16, 257);
+  do {
+    /* all channel counts with specialized kernels (and some without) */
+    const uint32_t channels[]={1, 3, 4, 5, 6, 7, 8, 9, 11, 16, 25, 36, 49, 64, 65};
+    uint32_t i;
+    for(i=0; i<sizeof(channels)/sizeof(*channels); i++) {
+      datamul_layout_tests(channels[i], 4, 37);
+      datamul_layout_tests(4, channels[i], 37);
+    }
+  } while(0);
   mtxinverse_tests(1e-5);
+  mtxinverse_large_tests(64, 36, 1e-5);
+  mtxinverse_large_tests(16, 64, 1e-5);
 
   return pass();
 }
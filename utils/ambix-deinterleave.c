@@ -69,6 +69,8 @@ typedef struct ai_t {
   ambix_matrix_t matrix;
 
   uint32_t blocksize;
+  /* reached the end of a stream */
+  int eof;
 #define DEFAULT_BLOCKSIZE 1024
 #define MAX_FILENAMESIZE 1024
 } ai_t;
@@ -213,7 +215,8 @@ static ai_t*ai_open_input(ai_t*ai) {
   if(!ai->inhandle) {
     ai->info.fileformat=AMBIX_EXTENDED;
 
-    ai->inhandle=ambix_open(ai->infilename, AMBIX_READ, &ai->info);
+    /* '-' reads a stream from stdin */
+    ai->inhandle=ambix_open(ai->infilename, strcmp(ai->infilename, "-")?AMBIX_READ:(AMBIX_READ|AMBIX_STREAM), &ai->info);
   }
   if(!ai->inhandle) {
     return ai_close(ai);
@@ -361,10 +364,15 @@ static ai_t*ai_copy_block(ai_t*ai,
                              extradata,
                              frames);
 
-  if(frames!=framed) {
+  if(framed<0 || (frames!=framed && INT64_MAX!=ai->info.frames)) {
     printf("failed reading %d frames (got %d)\n", (int)frames, (int)framed);
     return ai_close(ai);
   }
+  /* a stream of unknown length just ends */
+  if(frames!=framed) {
+    frames=framed;
+    ai->eof=1;
+  }
 
   /* decode the ambisonics data */
   //  printf("reading ambidata %p & %p\n", rawdata, cookeddata);
@@ -445,7 +453,7 @@ static ai_t*ai_copy(ai_t*ai) {
     return ai_close(ai);
   }
 
-  while(frames>blocksize) {
+  while(frames>blocksize && !ai->eof) {
     blocks++;
     if(!ai_copy_block(ai, rawdata, cookeddata, extradata, deinterleavebuf, blocksize)) {
       return ai_close(ai);
@@ -453,7 +461,7 @@ static ai_t*ai_copy(ai_t*ai) {
     frames-=blocksize;
   }
 
-  if(!ai_copy_block(ai, rawdata, cookeddata, extradata, deinterleavebuf, frames)) {
+  if(!ai->eof && !ai_copy_block(ai, rawdata, cookeddata, extradata, deinterleavebuf, frames)) {
     return ai_close(ai);
   }
 
@@ -502,6 +510,7 @@ void print_usage(const char*name) {
   printf("\n");
   printf("Usage: %s [options] infile\n", name);
   printf("Split an ambix file into several mono files\n");
+  printf("('-' reads the ambix file from stdin)\n");
 
   printf("\n");
   printf("Options:\n");
@@ -65,6 +65,8 @@ typedef struct ai_t {
   int dumpXtra;
 
   uint32_t blocksize;
+  /* reached the end of a stream */
+  int eof;
 #define DEFAULT_BLOCKSIZE 1024
 #define MAX_FILENAMESIZE 1024
 } ai_t;
@@ -178,7 +180,8 @@ static ai_t*ai_open_input(ai_t*ai) {
   if(!ai->ambix) {
     ai->info.fileformat=ai->format;
 
-    ai->ambix=ambix_open(ai->filename, AMBIX_READ, &ai->info);
+    /* '-' reads a stream from stdin */
+    ai->ambix=ambix_open(ai->filename, strcmp(ai->filename, "-")?AMBIX_READ:(AMBIX_READ|AMBIX_STREAM), &ai->info);
   }
   if(!ai->ambix) {
     return ai_close(ai);
@@ -215,6 +218,7 @@ static ai_t*ai_dump_block(ai_t*ai,
                           float*dumpbuffer,
                           uint64_t frames) {
   uint32_t ambichannels, fullambichannels, extrachannels;
+  int64_t got;
 
   const ambix_matrix_t*matrix;
   //printf("rawdata=%p\tcookeddata=%p\textradata=%p\n", rawdata, cookeddata, extradata);
@@ -237,12 +241,18 @@ static ai_t*ai_dump_block(ai_t*ai,
   }
 
   /* read the raw data */
-  if(frames!=ambix_readf_float32(ai->ambix,
-                                 rawdata,
-                                 extradata,
-                                 frames)) {
+  got=ambix_readf_float32(ai->ambix,
+                          rawdata,
+                          extradata,
+                          frames);
+  if(got<0 || (frames!=got && INT64_MAX!=ai->info.frames)) {
     return ai_close(ai);
   }
+  /* a stream of unknown length just ends */
+  if(frames!=got) {
+    frames=got;
+    ai->eof=1;
+  }
 
   if(ai->dumpRaw) {
     printf_block("RAW", rawdata, ambichannels, frames);
@@ -305,7 +315,7 @@ static ai_t*ai_dodump(ai_t*ai) {
   }
   dumpbuf=(float32_t*)malloc(sizeof(float32_t)*size);
 
-  while(frames>blocksize) {
+  while(frames>blocksize && !ai->eof) {
     blocks++;
     if(!ai_dump_block(ai, rawdata, cookeddata, extradata, dumpbuf, blocksize)) {
       ai=NULL;
@@ -313,7 +323,7 @@ static ai_t*ai_dodump(ai_t*ai) {
     }
     frames-=blocksize;
   }
-  if(ai && !ai_dump_block(ai, rawdata, cookeddata, extradata, dumpbuf, frames)) {
+  if(ai && !ai->eof && !ai_dump_block(ai, rawdata, cookeddata, extradata, dumpbuf, frames)) {
     ai=NULL;
   }
 
@@ -356,6 +366,7 @@ int main(int argc, char**argv) {
 void print_usage(const char*name) {
   printf("\n");
   printf("Usage: %s [options] infile\n", name);
+  printf("('-' reads the ambix file from stdin)\n");
   printf("Print sample values of an ambix file to the stdout\n");
 
   printf("\n");
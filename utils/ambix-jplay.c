@@ -356,6 +356,9 @@ int jackplay(const char *file_name,
   ambixinfo.fileformat=AMBIX_BASIC;
   d.sound_file = ambix_open(file_name, AMBIX_READ, &ambixinfo);
 
+  /* load the first second (from the initial seek position), so playback starts instantly */
+  ambix_advise(d.sound_file, AMBIX_ADVISE_WILLNEED, (d.o.seek_request > 0)?d.o.seek_request:0, (int64_t)ambixinfo.samplerate);
+
   d.a_channels = ambixinfo.ambichannels;
   d.e_channels = ambixinfo.extrachannels;
 
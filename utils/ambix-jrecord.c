@@ -54,6 +54,9 @@ struct recorder
   ambix_fileformat_t file_format;
   ambix_sampleformat_t sample_format;
   ambix_t *sound_file;
+  ambix_segmented_t *segments;
+  float segment_seconds;
+  float checkpoint_seconds;
   int channels;
   uint32_t a_channels, e_channels;
   jack_port_t **input_port;
@@ -140,10 +143,16 @@ void interleave_split(float32_t*source, uint32_t sourcechannels,
 void write_to_disk(struct recorder *d, int nframes)
 {
   int nsamples = nframes;
-  ambix_writef_float32(d->sound_file,
-                       d->a_buffer,
-                       d->e_buffer,
-                       nsamples);
+  if(d->segments)
+    ambix_segmented_writef_float32(d->segments,
+                                   d->a_buffer,
+                                   d->e_buffer,
+                                   nsamples);
+  else
+    ambix_writef_float32(d->sound_file,
+                         d->a_buffer,
+                         d->e_buffer,
+                         nsamples);
 }
 
 void *disk_thread_procedure(void *PTR)
@@ -264,7 +273,11 @@ void usage(const char*name)
   // LATER: allow user to specify the sample-format
   //  eprintf("    -f N : File format (default=0x10006).\n");
   eprintf("    -m N : Minimal disk read size in frames (default=32).\n");
-  eprintf("    -t N : Set a timer to record for N seconds (default=-1).\n");
+  eprintf("    -t N : Set a timer to record for N seconds, reserving the disk space upfront (default=-1).\n");
+  eprintf("    -s : Write a stream that never seeks (so sound-file can be a pipe, or '-' for stdout).\n");
+  eprintf("    -d : Write unbuffered (bypassing the page cache), for long recordings.\n");
+  eprintf("    -S N : Split the recording into files of N seconds (sound-file must contain a '%%d' for the file number).\n");
+  eprintf("    -c N : Update the header every N seconds, so an interrupted recording remains readable (default=-1).\n");
   eprintf("    -V : Print version information.\n");
   eprintf("    -h : Print this help.\n");
   eprintf("\n");
@@ -305,16 +318,21 @@ int main(int argc, char *argv[])
 
   ambix_matrix_t*matrix=NULL;
   int32_t order = -1;
+  ambix_filemode_t filemode = AMBIX_WRITE;
 
   d.buffer_frames = 4096;
   d.minimal_frames = 32;
   d.channels = 2;
   d.timer_seconds = -1.0;
+  d.segment_seconds = -1.0;
+  d.checkpoint_seconds = -1.0;
+  d.segments = NULL;
+  d.sound_file = NULL;
   d.timer_counter = 0;
   d.sample_format = AMBIX_SAMPLEFORMAT_FLOAT32;
   d.file_format   = AMBIX_BASIC;
   int c;
-  while((c = getopt(argc, argv, "hVx:X:O:b:fhm:n:t:")) != -1) {
+  while((c = getopt(argc, argv, "hVx:X:O:b:fhm:n:t:sdS:c:")) != -1) {
     switch(c) {
     case 'x':
       d.e_channels = (int) strtol(optarg, NULL, 0);
@@ -352,6 +370,18 @@ int main(int argc, char *argv[])
     case 't':
       d.timer_seconds = (float) strtod(optarg, NULL);
       break;
+    case 's':
+      filemode |= AMBIX_STREAM;
+      break;
+    case 'd':
+      filemode |= AMBIX_DIRECT;
+      break;
+    case 'S':
+      d.segment_seconds = (float) strtod(optarg, NULL);
+      break;
+    case 'c':
+      d.checkpoint_seconds = (float) strtod(optarg, NULL);
+      break;
     default:
       eprintf("%s: illegal option, %c\n", myname, c);
       usage (myname);
@@ -434,9 +464,24 @@ int main(int argc, char *argv[])
   sfinfo.ambichannels  = d.a_channels;
   sfinfo.extrachannels = d.e_channels;
 
-  d.sound_file = ambix_open(filename, AMBIX_WRITE, &sfinfo);
+  if(d.segment_seconds > 0.0) {
+    /* the matrix is written into every segment */
+    d.segments = ambix_segmented_open(filename, filemode, &sfinfo, matrix,
+                                      (int64_t)(d.segment_seconds * d.sample_rate), 0);
+    if(!d.segments) {
+      eprintf("%s: couldn't create segmented file '%s'\n", myname, filename);
+      FAILURE;
+    }
+  } else
+    d.sound_file = ambix_open(filename, filemode, &sfinfo);
 
-  if(matrix) {
+  /* make room for the entire recording upfront (if the filesystem allows) */
+  if(d.sound_file && d.timer_frames > 0)
+    ambix_reserve(d.sound_file, d.timer_frames);
+  if(d.sound_file && d.checkpoint_seconds > 0.0)
+    ambix_set_checkpoint(d.sound_file, d.checkpoint_seconds);
+
+  if(matrix && d.sound_file) {
     ambix_err_t aerr = ambix_set_adaptormatrix(d.sound_file, matrix);
     if(AMBIX_ERR_SUCCESS != aerr) {
       eprintf("setting [%dx%d] matrix returned %d.\n", matrix->rows, matrix->cols, aerr);
@@ -503,7 +548,10 @@ int main(int argc, char *argv[])
      pipe, free data buffers, indicate success. */
 
   jack_client_close(client);
-  ambix_close(d.sound_file);
+  if(d.segments)
+    ambix_segmented_close(d.segments);
+  else
+    ambix_close(d.sound_file);
   jack_ringbuffer_free(d.ring_buffer);
   close(d.pipe[0]);
   close(d.pipe[1]);